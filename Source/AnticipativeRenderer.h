@@ -0,0 +1,262 @@
+/*
+  ==============================================================================
+
+    AnticipativeRenderer.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "RealtimeSafetyChecker.h"
+
+//==============================================================================
+/**
+    Renders audio a few blocks ahead on its own thread.
+
+    Each callback, the audio thread collect()s the audio rendered from the MIDI
+    it submitted numBlocksAhead blocks earlier, then submit()s this block's
+    MIDI. That is rendered in the background while the host gets on with other
+    work. The output is delayed by exactly getLatencySamples(), numBlocksAhead
+    times the block size given to prepare(), which must be at least the largest
+    block submitted.
+
+    The audio thread never waits for a render. Audio that isn't rendered by the time it is
+    due goes out as silence and counts as an underrun; when it does arrive it
+    is skipped, so the latency never changes. If the render thread is so far
+    behind that every slot still holds MIDI waiting to be rendered, the new
+    block's MIDI is dropped as well. Frequent underruns mean more blocks ahead
+    are needed.
+
+    Each block's Settings are copied in with its MIDI and handed back with it,
+    so the render thread never reads the caller's state, and a block renders
+    with the settings that were current when its MIDI came in.
+*/
+template <typename Settings>
+class AnticipativeRenderer  : private juce::Thread
+{
+public:
+    /** Called on the render thread: adds numSamples of audio for the MIDI, with the settings
+        submitted alongside it, to the start of the (cleared) buffer.
+    */
+    using RenderCallback = std::function<void(juce::AudioBuffer<float>&, const juce::MidiBuffer&, int, const Settings&)>;
+
+    AnticipativeRenderer()
+        : juce::Thread("Anticipative renderer")
+    {
+    }
+
+    ~AnticipativeRenderer() override
+    {
+        release();
+    }
+
+    /** Starts the render thread, with the latency's worth of silence ahead of the first rendered block. */
+    void prepare(int numChannels, int maximumBlockSize, int numBlocksAhead, RenderCallback callback)
+    {
+        release();
+
+        render = std::move(callback);
+        blockSize = juce::jmax(1, maximumBlockSize);
+        latency = blockSize * juce::jmax(1, numBlocksAhead);
+
+        fifo.setSize(numChannels, latency + 2 * blockSize);
+        fifo.clear();
+        scratch.setSize(numChannels, blockSize);
+
+        // A few spare slots, so a render thread that falls behind can catch up without losing MIDI
+        slots.clear();
+
+        for (int i = 0; i < juce::jmax(1, numBlocksAhead) + 4; ++i)
+        {
+            slots.push_back(std::make_unique<Slot>());
+            slots.back()->midi.ensureSize(4096 * 16);
+        }
+
+        // The stream starts with the latency's worth of silence already rendered
+        collectPosition = 0;
+        submitPosition = renderedEnd = latency;
+        renderedPosition = latency;
+        writeSlot = readSlot = 0;
+        numUnderruns = 0;
+
+        startThread(juce::Thread::Priority::highest);
+    }
+
+    /** Stops the render thread. Audio that was still to come out is dropped. */
+    void release()
+    {
+        stopThread(2000);
+    }
+
+    bool isActive() const noexcept              { return isThreadRunning(); }
+    int getBlockSize() const noexcept           { return blockSize; }
+    int getLatencySamples() const noexcept      { return latency; }
+
+    /** Collects that came up short, and blocks whose MIDI had to be dropped, since prepare(). */
+    int getNumUnderruns() const noexcept        { return numUnderruns.load(); }
+
+    /** Audio thread: copies the next numSamples of rendered audio into the buffer, and
+        silence for any that isn't ready. numSamples must not exceed the block size.
+    */
+    void collect(juce::AudioBuffer<float>& buffer, int startSample, int numSamples) noexcept
+    {
+        jassert(numSamples <= blockSize);
+
+        auto numReady = (int) juce::jlimit((juce::int64) 0, (juce::int64) numSamples,
+                                           renderedPosition.load(std::memory_order_acquire) - collectPosition);
+        auto numChannels = juce::jmin(buffer.getNumChannels(), fifo.getNumChannels());
+        auto readPosition = (int) (collectPosition % fifo.getNumSamples());
+        auto firstPart = juce::jmin(numReady, fifo.getNumSamples() - readPosition);
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            buffer.copyFrom(ch, startSample, fifo, ch, readPosition, firstPart);
+
+            if (firstPart < numReady)
+                buffer.copyFrom(ch, startSample + firstPart, fifo, ch, 0, numReady - firstPart);
+        }
+
+        // Never wait for the render thread: whatever isn't there yet goes out as silence
+        if (numReady < numSamples)
+        {
+            for (int ch = 0; ch < numChannels; ++ch)
+                buffer.clear(ch, startSample + numReady, numSamples - numReady);
+
+            numUnderruns.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        collectPosition += numSamples;
+    }
+
+    /** Audio thread, after collect(): queues the same stretch of MIDI, and a copy of the
+        settings to render it with, to be rendered in the background.
+    */
+    void submit(const juce::MidiBuffer& midi, int startSample, int numSamples, const Settings& settings) noexcept
+    {
+        jassert(numSamples <= blockSize);
+
+        auto& slot = *slots[(size_t) writeSlot];
+
+        // Every slot is still waiting to be rendered, so this block's MIDI is lost; the
+        // render thread fills the gap it leaves in the stream with silence
+        if (slot.pending.load(std::memory_order_acquire))
+        {
+            numUnderruns.fetch_add(1, std::memory_order_relaxed);
+            submitPosition += numSamples;
+            return;
+        }
+
+        slot.midi.clear();
+        slot.midi.addEvents(midi, startSample, numSamples, -startSample);
+        slot.settings = settings;
+        slot.numSamples = numSamples;
+        slot.streamStart = submitPosition;
+        slot.pending.store(true, std::memory_order_release);
+
+        writeSlot = (writeSlot + 1) % (int) slots.size();
+        submitPosition += numSamples;
+
+        // Signalling the event briefly takes the mutex the render thread sleeps on. It is never
+        // held across a render, so the wait is bounded and the real-time checker allows it
+        RealtimeSafetyChecker::ScopedPermit briefLock;
+        notify();
+    }
+
+private:
+    struct Slot
+    {
+        juce::MidiBuffer midi;
+        Settings settings {};
+        int numSamples = 0;
+        juce::int64 streamStart = 0;
+        std::atomic<bool> pending { false };
+    };
+
+    void run() override
+    {
+        while (! threadShouldExit())
+        {
+            auto& slot = *slots[(size_t) readSlot];
+
+            if (! slot.pending.load(std::memory_order_acquire))
+            {
+                wait(-1);
+                continue;
+            }
+
+            renderSlot(slot);
+            slot.pending.store(false, std::memory_order_release);
+            readSlot = (readSlot + 1) % (int) slots.size();
+        }
+    }
+
+    void renderSlot(Slot& slot) noexcept
+    {
+        juce::ScopedNoDenormals noDenormals;
+        RealtimeSafetyChecker::ScopedRealtimeSection realtimeSection;
+
+        const auto numSamples = slot.numSamples;
+
+        if (slot.streamStart > renderedEnd)
+            clearFifo(renderedEnd, slot.streamStart);
+
+        scratch.clear(0, numSamples);
+        render(scratch, slot.midi, numSamples, slot.settings);
+
+        // Audio that has already been collected as silence is still written, so the render
+        // stays in order, but it lands where nothing reads it again
+        auto writePosition = (int) (slot.streamStart % fifo.getNumSamples());
+        auto firstPart = juce::jmin(numSamples, fifo.getNumSamples() - writePosition);
+
+        for (int ch = 0; ch < fifo.getNumChannels(); ++ch)
+        {
+            fifo.copyFrom(ch, writePosition, scratch, ch, 0, firstPart);
+
+            if (firstPart < numSamples)
+                fifo.copyFrom(ch, 0, scratch, ch, firstPart, numSamples - firstPart);
+        }
+
+        renderedEnd = slot.streamStart + numSamples;
+        renderedPosition.store(renderedEnd, std::memory_order_release);
+    }
+
+    void clearFifo(juce::int64 start, juce::int64 end) noexcept
+    {
+        auto numSamples = (int) juce::jmin((juce::int64) fifo.getNumSamples(), end - start);
+        auto position = (int) (start % fifo.getNumSamples());
+        auto firstPart = juce::jmin(numSamples, fifo.getNumSamples() - position);
+
+        for (int ch = 0; ch < fifo.getNumChannels(); ++ch)
+        {
+            fifo.clear(ch, position, firstPart);
+
+            if (firstPart < numSamples)
+                fifo.clear(ch, 0, numSamples - firstPart);
+        }
+    }
+
+    RenderCallback render;
+    int blockSize = 0, latency = 0;
+
+    // Rendered audio, indexed by position in the output stream modulo its size. It only has
+    // to hold the latency plus the block being written, as nothing is read before it's rendered
+    juce::AudioBuffer<float> fifo, scratch;
+
+    // Blocks of MIDI and their settings waiting to be rendered, filled and emptied in order
+    std::vector<std::unique_ptr<Slot>> slots;
+
+    // Audio thread
+    juce::int64 collectPosition = 0, submitPosition = 0;
+    int writeSlot = 0;
+
+    // Render thread
+    juce::int64 renderedEnd = 0;
+    int readSlot = 0;
+
+    std::atomic<juce::int64> renderedPosition { 0 };
+    std::atomic<int> numUnderruns { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AnticipativeRenderer)
+};
@@ -0,0 +1,294 @@
+/*
+  ==============================================================================
+
+    Arpeggiator.cpp
+
+  ==============================================================================
+*/
+
+#include "Arpeggiator.h"
+
+namespace
+{
+    constexpr double stepBeats[] = { 1.0, 0.5, 0.25, 0.125, 1.0 / 3.0, 1.0 / 6.0 };
+}
+
+void Arpeggiator::prepare(double newSampleRate)
+{
+    sampleRate = newSampleRate;
+
+    // Room for a dense block of passed-through controllers as well as the arp's own notes
+    output.ensureSize(4096 * 16);
+
+    reset();
+}
+
+void Arpeggiator::reset() noexcept
+{
+    numHeld = 0;
+    wasEnabled = hostWasPlaying = false;
+    nextStepSample = noteOffSample = 0.0;
+    stepIndex = 0;
+    arpCounter = 0;
+    playingNote = -1;
+}
+
+void Arpeggiator::setPattern(const ArpPattern& newPattern)
+{
+    const juce::SpinLock::ScopedLockType sl(writerLock);
+    lastPattern = newPattern;
+    patterns.write(newPattern);
+}
+
+ArpPattern Arpeggiator::getPattern() const
+{
+    const juce::SpinLock::ScopedLockType sl(writerLock);
+    return lastPattern;
+}
+
+juce::String Arpeggiator::patternToString(const ArpPattern& pattern)
+{
+    juce::StringArray steps;
+
+    for (int i = 0; i < pattern.numSteps; ++i)
+    {
+        auto& step = pattern.steps[(size_t) i];
+        steps.add(juce::String(step.active ? 1 : 0) + ":" + juce::String(step.velocity, 3) + ":" + juce::String(step.transpose));
+    }
+
+    return steps.joinIntoString(";");
+}
+
+ArpPattern Arpeggiator::patternFromString(const juce::String& text)
+{
+    ArpPattern pattern;
+    auto steps = juce::StringArray::fromTokens(text, ";", {});
+
+    if (steps.isEmpty())
+        return pattern;
+
+    pattern.numSteps = juce::jmin(steps.size(), ArpPattern::maxSteps);
+
+    for (int i = 0; i < pattern.numSteps; ++i)
+    {
+        auto fields = juce::StringArray::fromTokens(steps[i], ":", {});
+        auto& step = pattern.steps[(size_t) i];
+
+        step.active = fields[0].getIntValue() != 0;
+        step.velocity = juce::jlimit(0.0f, 1.0f, fields[1].getFloatValue());
+        step.transpose = juce::jlimit(-24, 24, fields[2].getIntValue());
+    }
+
+    return pattern;
+}
+
+//==============================================================================
+void Arpeggiator::process(juce::MidiBuffer& midi, int numSamples, const Settings& settings, const Transport& transport) noexcept
+{
+    if (!settings.enabled)
+    {
+        // Just switched off: release the arp's note and go back to passing MIDI through
+        if (wasEnabled && playingNote >= 0)
+            midi.addEvent(juce::MidiMessage::noteOff(playingChannel, playingNote), 0);
+
+        if (wasEnabled)
+            reset();
+
+        return;
+    }
+
+    wasEnabled = true;
+
+    const auto& pattern = patterns.read();
+    const auto samplesPerBeat = sampleRate * 60.0 / juce::jmax(1.0, transport.bpm);
+    const auto beatsPerStep = stepBeats[juce::jlimit(0, (int) std::size(stepBeats) - 1, settings.rate)];
+    const auto stepSamples = beatsPerStep * samplesPerBeat;
+
+    output.clear();
+
+    if (transport.isPlaying)
+    {
+        // Lock the step grid to the host's beat position every block, so it never drifts.
+        // A step plays at the sample its position rounds up to, so one less than a sample
+        // before this block was left for it by the last one
+        auto stepNumber = std::floor((transport.ppqPosition - 1.0 / samplesPerBeat) / beatsPerStep) + 1.0;
+        nextStepSample = (stepNumber * beatsPerStep - transport.ppqPosition) * samplesPerBeat;
+        stepIndex = (juce::int64) stepNumber;
+
+        auto jumped = !hostWasPlaying || std::abs(transport.ppqPosition - expectedBeat) > 1.0e-3;
+
+        if (jumped && playingNote >= 0)
+            stopPlayingNote(0);
+
+        expectedBeat = transport.ppqPosition + numSamples / samplesPerBeat;
+    }
+    else if (hostWasPlaying && playingNote >= 0)
+    {
+        stopPlayingNote(0);
+    }
+
+    hostWasPlaying = transport.isPlaying;
+
+    // Merge incoming events, gate ends and step starts in time order
+    auto event = midi.begin();
+
+    for (;;)
+    {
+        const auto eventPosition = event != midi.end() ? (*event).samplePosition : numSamples;
+        const auto offPosition = playingNote >= 0 ? juce::jmax(0, juce::roundToInt(noteOffSample)) : numSamples;
+        const auto stepPosition = juce::jmax(0, (int) std::ceil(nextStepSample));
+
+        if (offPosition < numSamples && offPosition <= eventPosition && offPosition <= stepPosition)
+        {
+            stopPlayingNote(offPosition);
+        }
+        else if (eventPosition < numSamples && eventPosition <= stepPosition)
+        {
+            const auto metadata = *event;
+            const auto message = metadata.getMessage();
+
+            if (message.isNoteOn())
+                noteHeld(message.getNoteNumber(), message.getFloatVelocity(), message.getChannel(), eventPosition, transport.isPlaying);
+            else if (message.isNoteOff())
+            {
+                // A key that went down before the arp was switched on is still sounding through, so it needs its note-off
+                if (! noteReleased(message.getNoteNumber()))
+                    output.addEvent(message, eventPosition);
+            }
+            else
+            {
+                // All-notes-off also empties the held list, and still reaches any voices sounding through
+                if (message.isAllNotesOff() || message.isAllSoundOff())
+                    numHeld = 0;
+
+                output.addEvent(message, eventPosition);
+            }
+
+            ++event;
+        }
+        else if (stepPosition < numSamples)
+        {
+            triggerStep(stepPosition, pattern, settings, stepSamples);
+            nextStepSample += stepSamples;
+            ++stepIndex;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    nextStepSample -= numSamples;
+    noteOffSample -= numSamples;
+
+    // Copied back rather than swapped, so output keeps the space reserved in prepare()
+    midi.clear();
+    midi.addEvents(output, 0, -1, 0);
+}
+
+//==============================================================================
+void Arpeggiator::noteHeld(int note, float velocity, int channel, int samplePosition, bool followingHost) noexcept
+{
+    juce::ignoreUnused(velocity);
+    noteReleased(note);
+
+    // With nothing held and no host grid, the pattern restarts on this key
+    if (numHeld == 0)
+    {
+        arpCounter = 0;
+
+        if (!followingHost)
+        {
+            nextStepSample = samplePosition;
+            stepIndex = 0;
+        }
+    }
+
+    heldInOrder[(size_t) numHeld] = note;
+
+    auto position = numHeld;
+    while (position > 0 && heldSorted[(size_t) position - 1] > note)
+    {
+        heldSorted[(size_t) position] = heldSorted[(size_t) position - 1];
+        --position;
+    }
+
+    heldSorted[(size_t) position] = note;
+    ++numHeld;
+    heldChannel = channel;
+}
+
+bool Arpeggiator::noteReleased(int note) noexcept
+{
+    auto removeFrom = [this, note](std::array<int, 128>& notes)
+    {
+        auto end = std::remove(notes.begin(), notes.begin() + numHeld, note);
+        return (int) (end - notes.begin());
+    };
+
+    removeFrom(heldSorted);
+    auto numLeft = removeFrom(heldInOrder);
+    auto wasHeld = numLeft < numHeld;
+    numHeld = numLeft;
+    return wasHeld;
+}
+
+void Arpeggiator::stopPlayingNote(int samplePosition) noexcept
+{
+    output.addEvent(juce::MidiMessage::noteOff(playingChannel, playingNote), samplePosition);
+    playingNote = -1;
+}
+
+void Arpeggiator::triggerStep(int samplePosition, const ArpPattern& pattern, const Settings& settings, double stepSamples) noexcept
+{
+    if (playingNote >= 0)
+        stopPlayingNote(samplePosition);
+
+    if (numHeld == 0)
+        return;
+
+    const auto& step = pattern.steps[(size_t) (stepIndex % juce::jlimit(1, ArpPattern::maxSteps, pattern.numSteps))];
+
+    if (!step.active)
+        return;
+
+    auto note = juce::jlimit(0, 127, getNextArpNote(settings) + step.transpose);
+
+    output.addEvent(juce::MidiMessage::noteOn(heldChannel, note, juce::jlimit(0.01f, 1.0f, step.velocity)), samplePosition);
+    playingNote = note;
+    playingChannel = heldChannel;
+    noteOffSample = samplePosition + juce::jmax(1.0, stepSamples * settings.gate);
+}
+
+int Arpeggiator::getNextArpNote(const Settings& settings) noexcept
+{
+    if (settings.mode == SEQUENCE)
+        return heldSorted[0];
+
+    const auto octaves = juce::jlimit(1, 4, settings.octaves);
+    const auto length = numHeld * octaves;
+    auto index = 0;
+
+    switch (settings.mode)
+    {
+        case DOWN:      index = length - 1 - arpCounter % length; break;
+        case RANDOM:    index = random.nextInt(length); break;
+        case UPDOWN:
+        {
+            // Don't repeat the top and bottom notes when turning around
+            auto period = juce::jmax(1, 2 * length - 2);
+            auto position = arpCounter % period;
+            index = position < length ? position : period - position;
+            break;
+        }
+        case UP:
+        case ASPLAYED:
+        case SEQUENCE:
+        default:        index = arpCounter % length; break;
+    }
+
+    ++arpCounter;
+
+    const auto& notes = settings.mode == ASPLAYED ? heldInOrder : heldSorted;
+    return notes[(size_t) (index % numHeld)] + 12 * (index / numHeld);
+}
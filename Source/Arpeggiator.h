@@ -0,0 +1,114 @@
+/*
+  ==============================================================================
+
+    Arpeggiator.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "TripleBuffer.h"
+
+//==============================================================================
+struct ArpStep
+{
+    bool active = true;
+    float velocity = 0.8f;
+    int transpose = 0;
+};
+
+struct ArpPattern
+{
+    static constexpr int maxSteps = 16;
+
+    int numSteps = maxSteps;
+    std::array<ArpStep, maxSteps> steps {};
+};
+
+//==============================================================================
+/**
+    Arpeggiator and step sequencer that runs at the start of processBlock.
+
+    Held notes are taken out of the incoming MIDI and replaced by the pattern's
+    notes, with sample-accurate timestamps, so the same buffer drives the
+    voices and goes out as the plugin's MIDI output. Steps follow the host's
+    beat grid while its transport plays, and otherwise run freely from the
+    first key pressed.
+
+    Each step can be muted and has its own velocity and transpose. In the arp
+    modes the transpose is added to the arpeggiated note; in SEQUENCE mode the
+    steps play transposes of the lowest held note.
+*/
+class Arpeggiator
+{
+public:
+    enum Mode {
+        UP = 0,
+        DOWN,
+        UPDOWN,
+        ASPLAYED,
+        RANDOM,
+        SEQUENCE
+    };
+
+    struct Settings
+    {
+        bool enabled = false;
+        Mode mode = UP;
+        int rate = 2;           // index into getRateNames()
+        float gate = 0.5f;      // fraction of a step
+        int octaves = 1;
+    };
+
+    struct Transport
+    {
+        bool isPlaying = false;
+        double ppqPosition = 0.0;
+        double bpm = 120.0;
+    };
+
+    static juce::StringArray getModeNames()    { return { "UP", "DOWN", "UPDOWN", "ASPLAYED", "RANDOM", "SEQUENCE" }; }
+    static juce::StringArray getRateNames()    { return { "1/4", "1/8", "1/16", "1/32", "1/8T", "1/16T" }; }
+
+    void prepare(double newSampleRate);
+    void reset() noexcept;
+
+    /** Can be called from any thread except the audio thread. */
+    void setPattern(const ArpPattern& newPattern);
+    ArpPattern getPattern() const;
+
+    /** "active:velocity:transpose" per step, separated by semicolons, for saving with the plugin state. */
+    static juce::String patternToString(const ArpPattern& pattern);
+    static ArpPattern patternFromString(const juce::String& text);
+
+    void process(juce::MidiBuffer& midi, int numSamples, const Settings& settings, const Transport& transport) noexcept;
+
+private:
+    void noteHeld(int note, float velocity, int channel, int samplePosition, bool followingHost) noexcept;
+    bool noteReleased(int note) noexcept;     // false if the note wasn't held
+    void triggerStep(int samplePosition, const ArpPattern& pattern, const Settings& settings, double stepSamples) noexcept;
+    void stopPlayingNote(int samplePosition) noexcept;
+    int getNextArpNote(const Settings& settings) noexcept;
+
+    TripleBuffer<ArpPattern> patterns;
+    juce::SpinLock writerLock;
+    ArpPattern lastPattern;
+
+    double sampleRate = 44100.0;
+    juce::MidiBuffer output;
+    juce::Random random;
+
+    // Held keys in the order they were pressed, and sorted by pitch
+    std::array<int, 128> heldInOrder {}, heldSorted {};
+    int numHeld = 0;
+    int heldChannel = 1;
+
+    bool wasEnabled = false, hostWasPlaying = false;
+    double expectedBeat = 0.0;
+    double nextStepSample = 0.0, noteOffSample = 0.0;
+    juce::int64 stepIndex = 0;
+    int arpCounter = 0;
+    int playingNote = -1, playingChannel = 1;
+};
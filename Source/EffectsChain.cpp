@@ -0,0 +1,189 @@
+/*
+  ==============================================================================
+
+    EffectsChain.cpp
+
+  ==============================================================================
+*/
+
+#include "EffectsChain.h"
+
+void EffectsChain::prepare(const juce::dsp::ProcessSpec& spec)
+{
+    sampleRate = spec.sampleRate;
+    numChannels = (int) spec.numChannels;
+
+    chorus.prepare(spec);
+    reverb.prepare(spec);
+    convolver.prepare(spec);
+
+    delayLine.setMaximumDelayInSamples((int) std::ceil(maxDelaySeconds * sampleRate) + 1);
+    delayLine.prepare(spec);
+    delaySamples.reset(sampleRate, 0.05);
+
+    // Push the current settings through again, now that the sample rate is known
+    firstSettings = true;
+    setSettings(settings);
+
+    reset();
+}
+
+void EffectsChain::reset()
+{
+    chorus.reset();
+    delayLine.reset();
+    reverb.reset();
+    convolver.restart();
+
+    delaySamples.setCurrentAndTargetValue(delaySamples.getTargetValue());
+    silentSamples = tailSamples;
+    idle = true;
+}
+
+void EffectsChain::setSettings(const EffectsSettings& newSettings)
+{
+    auto old = settings;
+    settings = newSettings;
+
+    auto changed = [this](float oldValue, float newValue) { return firstSettings || oldValue != newValue; };
+
+    if (changed(old.chorusRate, settings.chorusRate))      chorus.setRate(settings.chorusRate);
+    if (changed(old.chorusDepth, settings.chorusDepth))    chorus.setDepth(settings.chorusDepth);
+    if (changed(old.chorusMix, settings.chorusMix))        chorus.setMix(settings.chorusMix);
+
+    if (firstSettings)
+    {
+        chorus.setCentreDelay(7.0f);
+        chorus.setFeedback(0.0f);
+    }
+
+    if (changed(old.delayTimeMs, settings.delayTimeMs))
+    {
+        auto samples = juce::jlimit(1.0f, (float) (maxDelaySeconds * sampleRate), settings.delayTimeMs * 0.001f * (float) sampleRate);
+
+        if (firstSettings)
+            delaySamples.setCurrentAndTargetValue(samples);
+        else
+            delaySamples.setTargetValue(samples);
+    }
+
+    if (changed(old.reverbSize, settings.reverbSize) || changed(old.reverbDamping, settings.reverbDamping)
+        || changed(old.reverbWidth, settings.reverbWidth) || changed(old.reverbMix, settings.reverbMix))
+    {
+        juce::dsp::Reverb::Parameters params;
+        params.roomSize = settings.reverbSize;
+        params.damping = settings.reverbDamping;
+        params.width = settings.reverbWidth;
+        params.wetLevel = settings.reverbMix;
+        params.dryLevel = 1.0f - settings.reverbMix;
+        reverb.setParameters(params);
+    }
+
+    // Effects coming back from bypass start from silence
+    if (settings.chorusEnabled && ! old.chorusEnabled)    chorus.reset();
+    if (settings.delayEnabled && ! old.delayEnabled)      delayLine.reset();
+    if (settings.reverbEnabled && ! old.reverbEnabled)    reverb.reset();
+    if (settings.convolutionEnabled && ! old.convolutionEnabled)    convolver.restart();
+
+    tailSamples = (juce::int64) std::ceil(getTailLengthSeconds(settings) * sampleRate);
+    firstSettings = false;
+}
+
+double EffectsChain::getTailLengthSeconds(const EffectsSettings& s) const
+{
+    double tail = 0.0;
+
+    if (s.chorusEnabled)
+        tail += 0.05;
+
+    if (s.delayEnabled)
+    {
+        // Each repeat is scaled by the feedback, so count the repeats it takes to fall 60 dB
+        auto feedback = juce::jlimit(0.0, 0.99, (double) s.delayFeedback);
+        auto repeats = feedback > 0.0 ? std::ceil(std::log(0.001) / std::log(feedback)) : 0.0;
+        tail += s.delayTimeMs * 0.001 * (1.0 + repeats);
+    }
+
+    if (s.reverbEnabled)
+    {
+        // Freeverb's comb feedback is roomSize * 0.28 + 0.7, and its longest comb is ~37 ms
+        auto combFeedback = s.reverbSize * 0.28 + 0.7;
+        tail += 3.0 * 0.0372 / -std::log10(combFeedback);
+    }
+
+    if (s.convolutionEnabled)
+        tail += convolver.getTailLengthSeconds();
+
+    return tail;
+}
+
+void EffectsChain::process(juce::AudioBuffer<float>& buffer, int startSample, int numSamples) noexcept
+{
+    if (! (settings.chorusEnabled || settings.delayEnabled || settings.reverbEnabled || settings.convolutionEnabled))
+        return;
+
+    auto channelsToProcess = juce::jmin(numChannels, buffer.getNumChannels());
+    auto hasInput = false;
+
+    for (int ch = 0; ch < channelsToProcess && ! hasInput; ++ch)
+        hasInput = buffer.getMagnitude(ch, startSample, numSamples) > silenceThreshold;
+
+    if (hasInput)
+    {
+        silentSamples = 0;
+        idle = false;
+    }
+    else
+    {
+        if (idle)
+            return;
+
+        silentSamples += numSamples;
+
+        // The tail has died away: clear what's left in the effects and stop until the next sound
+        if (silentSamples > tailSamples)
+        {
+            reset();
+            return;
+        }
+    }
+
+    auto block = juce::dsp::AudioBlock<float>(buffer).getSubsetChannelBlock(0, (size_t) channelsToProcess)
+                                                     .getSubBlock((size_t) startSample, (size_t) numSamples);
+    juce::dsp::ProcessContextReplacing<float> context(block);
+
+    if (settings.chorusEnabled)
+        chorus.process(context);
+
+    if (settings.delayEnabled)
+        processDelay(block);
+
+    if (settings.reverbEnabled)
+        reverb.process(context);
+
+    if (settings.convolutionEnabled)
+        convolver.process(block, settings.convolutionMix);
+}
+
+void EffectsChain::processDelay(juce::dsp::AudioBlock<float>& block) noexcept
+{
+    auto numBlockChannels = (int) block.getNumChannels();
+    auto feedback = settings.delayFeedback;
+    auto wet = settings.delayMix;
+    auto dry = 1.0f - wet;
+
+    for (size_t i = 0; i < block.getNumSamples(); ++i)
+    {
+        auto delay = delaySamples.getNextValue();
+
+        for (int ch = 0; ch < numBlockChannels; ++ch)
+        {
+            auto* samples = block.getChannelPointer((size_t) ch);
+            auto input = samples[i];
+            auto delayed = delayLine.popSample(ch, delay);
+
+            delayLine.pushSample(ch, input + delayed * feedback);
+            samples[i] = input * dry + delayed * wet;
+        }
+    }
+}
@@ -0,0 +1,77 @@
+/*
+  ==============================================================================
+
+    EffectsChain.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PartitionedConvolver.h"
+
+struct EffectsSettings
+{
+    bool chorusEnabled = false;
+    float chorusRate = 1.0f, chorusDepth = 0.25f, chorusMix = 0.5f;
+
+    bool delayEnabled = false;
+    float delayTimeMs = 375.0f, delayFeedback = 0.4f, delayMix = 0.3f;
+
+    bool reverbEnabled = false;
+    float reverbSize = 0.5f, reverbDamping = 0.5f, reverbWidth = 1.0f, reverbMix = 0.25f;
+
+    bool convolutionEnabled = false;
+    float convolutionMix = 0.25f;
+};
+
+//==============================================================================
+/**
+    Chorus -> delay -> reverb -> convolution reverb, run after the ladder filter.
+
+    - All buffers are allocated in prepare(); process() never allocates.
+    - A bypassed effect is skipped entirely, and is cleared when it comes back
+      on so it doesn't replay stale audio.
+    - Once the input has been silent for longer than the chain's tail, the
+      whole chain stops processing until sound arrives again.
+*/
+class EffectsChain
+{
+public:
+    static constexpr double maxDelaySeconds = 2.0;
+
+    void prepare(const juce::dsp::ProcessSpec& spec);
+    void reset();
+
+    /** Cheap to call every block: only changed values are passed on to the effects. */
+    void setSettings(const EffectsSettings& newSettings);
+
+    void process(juce::AudioBuffer<float>& buffer, int startSample, int numSamples) noexcept;
+
+    /** How long the enabled effects keep ringing after their input stops, to -60 dB. */
+    double getTailLengthSeconds(const EffectsSettings& settings) const;
+
+    PartitionedConvolver& getConvolver() noexcept   { return convolver; }
+
+    bool isIdle() const noexcept    { return idle; }
+
+private:
+    void processDelay(juce::dsp::AudioBlock<float>& block) noexcept;
+
+    static constexpr float silenceThreshold = 1.0e-5f;
+
+    juce::dsp::Chorus<float> chorus;
+    juce::dsp::DelayLine<float, juce::dsp::DelayLineInterpolationTypes::Linear> delayLine;
+    juce::dsp::Reverb reverb;
+    PartitionedConvolver convolver;
+
+    juce::SmoothedValue<float> delaySamples;
+    EffectsSettings settings;
+    bool firstSettings = true;
+
+    double sampleRate = 44100.0;
+    int numChannels = 2;
+    juce::int64 tailSamples = 0, silentSamples = 0;
+    bool idle = true;
+};
@@ -0,0 +1,245 @@
+/*
+  ==============================================================================
+
+    EventTracer.cpp
+
+  ==============================================================================
+*/
+
+#include "EventTracer.h"
+
+#if JUCE_WINDOWS
+ #include <process.h>
+#else
+ #include <unistd.h>
+#endif
+
+namespace
+{
+    int getProcessId() noexcept
+    {
+       #if JUCE_WINDOWS
+        return (int) _getpid();
+       #else
+        return (int) getpid();
+       #endif
+    }
+
+    std::atomic<int> numInstanceFiles { 0 };
+}
+
+//==============================================================================
+EventTracer::EventTracer()
+: juce::Thread ("Event trace writer")
+{
+}
+
+EventTracer::~EventTracer()
+{
+    stop();
+}
+
+juce::File EventTracer::getInstanceFile (const juce::File& traceFile)
+{
+    auto suffix = "-" + juce::String (getProcessId()) + "-" + juce::String (++numInstanceFiles);
+    return traceFile.getSiblingFile (traceFile.getFileNameWithoutExtension() + suffix + traceFile.getFileExtension());
+}
+
+bool EventTracer::start (const juce::File& traceFile)
+{
+    stop();
+
+    auto newStream = std::make_unique<juce::FileOutputStream> (traceFile);
+
+    if (! newStream->openedOk())
+        return false;
+
+    newStream->setPosition (0);
+    newStream->truncate();
+
+    for (auto& ring : rings)
+        if (ring.events == nullptr)
+            ring.events.calloc ((size_t) eventsPerThread);
+
+    // Anything left over from a previous session belongs to that session
+    drainRings (false);
+    droppedWithoutRing.store (0);
+
+    stream = std::move (newStream);
+    processId = getProcessId();
+    *stream << "{\"traceEvents\":[\n";
+    firstEventWritten = false;
+    startTicks = juce::Time::getHighResolutionTicks();
+
+    tracing.store (true, std::memory_order_release);
+    startThread();
+    return true;
+}
+
+void EventTracer::stop()
+{
+    if (stream == nullptr)
+        return;
+
+    tracing.store (false, std::memory_order_release);
+    stopThread (2000);
+    drainRings (true);
+
+    juce::uint32 totalDropped = 0;
+
+    for (auto& ring : rings)
+        totalDropped += ring.dropped.exchange (0);
+
+    *stream << "\n],\"otherData\":{\"droppedEvents\":" << (int) totalDropped
+            << ",\"droppedEventsFromExtraThreads\":" << (int) droppedWithoutRing.exchange (0) << "}}\n";
+    stream->flush();
+    stream.reset();
+}
+
+void EventTracer::record (EventType type, int channel, int note, int voice, float value) noexcept
+{
+    if (! isTracing())
+        return;
+
+    auto* ring = getRingForCurrentThread();
+
+    if (ring == nullptr)
+    {
+        droppedWithoutRing.fetch_add (1, std::memory_order_relaxed);
+        return;
+    }
+
+    int start1, size1, start2, size2;
+    ring->fifo.prepareToWrite (1, start1, size1, start2, size2);
+
+    if (size1 + size2 == 0)
+    {
+        ring->dropped.fetch_add (1, std::memory_order_relaxed);
+        return;
+    }
+
+    auto& e = ring->events[(size_t) (size1 > 0 ? start1 : start2)];
+    e.ticks = juce::Time::getHighResolutionTicks();
+    e.value = value;
+    e.note = (juce::int16) note;
+    e.voice = (juce::int16) voice;
+    e.channel = (juce::int8) channel;
+    e.type = type;
+
+    ring->fifo.finishedWrite (1);
+}
+
+EventTracer::ThreadRing* EventTracer::getRingForCurrentThread() noexcept
+{
+    auto thisThread = juce::Thread::getCurrentThreadId();
+
+    for (auto& ring : rings)
+    {
+        auto owner = ring.owner.load (std::memory_order_acquire);
+
+        if (owner == thisThread)
+            return &ring;
+
+        if (owner == nullptr && ring.owner.compare_exchange_strong (owner, thisThread))
+            return &ring;
+    }
+
+    return nullptr;
+}
+
+//==============================================================================
+void EventTracer::run()
+{
+    while (! threadShouldExit())
+    {
+        wait (20);
+        drainRings (true);
+    }
+}
+
+void EventTracer::drainRings (bool writeEvents)
+{
+    for (int i = 0; i < maxThreads; ++i)
+    {
+        auto& ring = rings[(size_t) i];
+
+        if (ring.events == nullptr)
+            continue;
+
+        auto numReady = ring.fifo.getNumReady();
+
+        if (numReady == 0)
+            continue;
+
+        int start1, size1, start2, size2;
+        ring.fifo.prepareToRead (numReady, start1, size1, start2, size2);
+
+        if (writeEvents)
+        {
+            for (int n = 0; n < size1; ++n)
+                writeEvent (ring.events[(size_t) (start1 + n)], i);
+
+            for (int n = 0; n < size2; ++n)
+                writeEvent (ring.events[(size_t) (start2 + n)], i);
+        }
+
+        ring.fifo.finishedRead (size1 + size2);
+    }
+
+    if (writeEvents && stream != nullptr)
+        stream->flush();
+}
+
+void EventTracer::writeEvent (const Event& e, int threadIndex)
+{
+    if (stream == nullptr || e.ticks < startTicks)
+        return;
+
+    auto micros = juce::Time::highResolutionTicksToSeconds (e.ticks - startTicks) * 1.0e6;
+    auto common = "\"pid\":" + juce::String (processId) + ",\"tid\":" + juce::String (threadIndex) + ",\"ts\":" + juce::String (micros, 3);
+    juce::String json;
+
+    switch (e.type)
+    {
+        case EventType::blockBegin:
+            json << "{\"name\":\"processBlock\",\"ph\":\"B\"," << common
+                 << ",\"args\":{\"numSamples\":" << juce::String ((int) e.value) << "}}";
+            break;
+        case EventType::blockEnd:
+            json << "{\"name\":\"processBlock\",\"ph\":\"E\"," << common << "}";
+            break;
+        case EventType::noteOn:
+        case EventType::noteOff:
+            json << "{\"name\":\"" << (e.type == EventType::noteOn ? "noteOn" : "noteOff")
+                 << "\",\"cat\":\"midi\",\"ph\":\"i\",\"s\":\"t\"," << common
+                 << ",\"args\":{\"channel\":" << juce::String ((int) e.channel)
+                 << ",\"note\":" << juce::String ((int) e.note)
+                 << ",\"velocity\":" << juce::String (e.value, 3) << "}}";
+            break;
+        case EventType::voiceStart:
+        case EventType::voiceFree:
+            json << "{\"name\":\"voice " << juce::String ((int) e.voice)
+                 << "\",\"cat\":\"voice\",\"ph\":\"" << (e.type == EventType::voiceStart ? "b" : "e")
+                 << "\",\"id\":" << juce::String ((int) e.voice) << "," << common
+                 << ",\"args\":{\"note\":" << juce::String ((int) e.note) << "}}";
+            break;
+        case EventType::voiceSteal:
+            json << "{\"name\":\"voiceSteal\",\"cat\":\"voice\",\"ph\":\"i\",\"s\":\"t\"," << common
+                 << ",\"args\":{\"voice\":" << juce::String ((int) e.voice)
+                 << ",\"note\":" << juce::String ((int) e.note) << "}}";
+            break;
+        case EventType::parameterChange:
+            json << "{\"name\":\"parameterChange\",\"cat\":\"parameter\",\"ph\":\"i\",\"s\":\"t\"," << common
+                 << ",\"args\":{\"index\":" << juce::String ((int) e.note)
+                 << ",\"value\":" << juce::String (e.value, 4) << "}}";
+            break;
+        default:
+            return;
+    }
+
+    if (firstEventWritten)
+        *stream << ",\n";
+
+    *stream << json;
+    firstEventWritten = true;
+}
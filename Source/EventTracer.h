@@ -0,0 +1,94 @@
+/*
+  ==============================================================================
+
+    EventTracer.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Records timestamped engine events (blocks, notes, voice allocation and
+    parameter changes) into pre-allocated per-thread ring buffers, and flushes
+    them from a background thread to a Chrome/Perfetto JSON trace file.
+
+    record() never allocates or locks, so it is safe to call on the audio thread.
+    Open the resulting file in chrome://tracing or ui.perfetto.dev.
+*/
+class EventTracer : private juce::Thread
+{
+public:
+    enum class EventType : juce::uint8
+    {
+        blockBegin = 0,
+        blockEnd,
+        noteOn,
+        noteOff,
+        voiceStart,
+        voiceSteal,
+        voiceFree,
+        parameterChange
+    };
+
+    EventTracer();
+    ~EventTracer() override;
+
+    /** The file with this process's ID and a per-process count added to its name, so
+        instances sharing one path, in one process or several, each get their own trace.
+    */
+    static juce::File getInstanceFile (const juce::File& traceFile);
+
+    /** Starts writing a new trace to the given file. Call from the message thread. */
+    bool start (const juce::File& traceFile);
+
+    /** Flushes any remaining events and closes the trace file. */
+    void stop();
+
+    bool isTracing() const noexcept { return tracing.load (std::memory_order_relaxed); }
+
+    /** Records an event for the calling thread. Events are dropped if that thread's ring is full,
+        or if every ring is already taken by other threads; the trace counts both.
+    */
+    void record (EventType type, int channel = 0, int note = -1, int voice = -1, float value = 0.0f) noexcept;
+
+private:
+    struct Event
+    {
+        juce::int64 ticks;
+        float value;
+        juce::int16 note, voice;
+        juce::int8 channel;
+        EventType type;
+    };
+
+    static constexpr int maxThreads = 8;
+    static constexpr int eventsPerThread = 1 << 14;
+
+    struct ThreadRing
+    {
+        std::atomic<juce::Thread::ThreadID> owner { nullptr };
+        juce::AbstractFifo fifo { eventsPerThread };
+        juce::HeapBlock<Event> events;
+        std::atomic<juce::uint32> dropped { 0 };
+    };
+
+    ThreadRing* getRingForCurrentThread() noexcept;
+    void run() override;
+    void drainRings (bool writeEvents);
+    void writeEvent (const Event&, int threadIndex);
+
+    std::array<ThreadRing, maxThreads> rings;
+    std::atomic<bool> tracing { false };
+    std::atomic<juce::uint32> droppedWithoutRing { 0 };
+
+    std::unique_ptr<juce::FileOutputStream> stream;
+    juce::int64 startTicks = 0;
+    int processId = 0;
+    bool firstEventWritten = false;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (EventTracer)
+};
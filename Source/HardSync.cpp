@@ -0,0 +1,187 @@
+/*
+  ==============================================================================
+
+    HardSync.cpp
+
+  ==============================================================================
+*/
+
+#include "HardSync.h"
+
+namespace BandLimitedStep
+{
+    const Residual& getResidual()
+    {
+        static const Residual residual = []
+        {
+            // A Blackman-windowed sinc spanning numTaps samples, zero padded so the cepstrum doesn't wrap around
+            constexpr int fftOrder = 13;
+            constexpr int fftSize = 1 << fftOrder;
+            constexpr int impulseLength = numTaps * oversampling + 1;
+            static_assert (impulseLength * 2 <= fftSize);
+
+            using Complex = juce::dsp::Complex<float>;
+            juce::dsp::FFT fft(fftOrder);
+            std::vector<Complex> buffer((size_t) fftSize), spectrum((size_t) fftSize);
+
+            constexpr double pi = 3.141592653589793238;
+            const auto centre = (double) (impulseLength - 1) / 2.0;
+
+            for (int i = 0; i < impulseLength; ++i)
+            {
+                auto x = ((double) i - centre) / (double) oversampling;
+                auto sinc = x == 0.0 ? 1.0 : std::sin(pi * x) / (pi * x);
+                auto w = (double) i / (double) (impulseLength - 1);
+                auto window = 0.42 - 0.5 * std::cos(2.0 * pi * w) + 0.08 * std::cos(4.0 * pi * w);
+                buffer[(size_t) i] = (float) (sinc * window);
+            }
+
+            // The real cepstrum: the inverse transform of the log magnitude, floored so the stopband stays finite
+            fft.perform(buffer.data(), spectrum.data(), false);
+
+            for (auto& bin : spectrum)
+                bin = std::log(juce::jmax(1.0e-7f, std::abs(bin)));
+
+            fft.perform(spectrum.data(), buffer.data(), true);
+
+            // Folding the cepstrum onto positive time gives the minimum-phase version of the same magnitude
+            for (int i = 1; i < fftSize / 2; ++i)
+                buffer[(size_t) i] = 2.0f * buffer[(size_t) i].real();
+
+            for (int i = fftSize / 2 + 1; i < fftSize; ++i)
+                buffer[(size_t) i] = 0.0f;
+
+            buffer[0] = buffer[0].real();
+            buffer[(size_t) fftSize / 2] = buffer[(size_t) fftSize / 2].real();
+
+            fft.perform(buffer.data(), spectrum.data(), false);
+
+            for (auto& bin : spectrum)
+                bin = std::exp(bin);
+
+            fft.perform(spectrum.data(), buffer.data(), true);
+
+            // Integrating the impulse gives the step, scaled to end at exactly 1
+            Residual table {};
+            auto sum = 0.0;
+
+            for (size_t i = 0; i < table.size(); ++i)
+            {
+                sum += (double) buffer[i].real();
+                table[i] = (float) sum;
+            }
+
+            for (auto& value : table)
+                value = value / (float) sum - 1.0f;
+
+            table.back() = 0.0f;
+            return table;
+        }();
+
+        return residual;
+    }
+}
+
+//==============================================================================
+HardSyncOscillator::HardSyncOscillator()
+    : residual(BandLimitedStep::getResidual())
+{
+    reset();
+}
+
+void HardSyncOscillator::setTable(const float* samples, int numSamples) noexcept
+{
+    table = samples;
+    tableSize = numSamples - 1;
+    mask = (unsigned int) tableSize - 1;
+    jassert (juce::isPowerOfTwo (tableSize));
+}
+
+void HardSyncOscillator::setSync(bool shouldBeEnabled, float newRatio) noexcept
+{
+    enabled = shouldBeEnabled;
+    targetRatio = juce::jmax(1.0f, newRatio);
+}
+
+void HardSyncOscillator::setFrequency(float frequency, float sampleRate) noexcept
+{
+    increment = frequency / sampleRate;
+}
+
+void HardSyncOscillator::reset() noexcept
+{
+    phase = 0.0f;
+    firstBlock = true;
+    std::fill(std::begin(corrections), std::end(corrections), 0.0f);
+}
+
+void HardSyncOscillator::process(float* output, int numSamples) noexcept
+{
+    jassert (table != nullptr && numSamples <= maxBlockSize);
+
+    if (firstBlock)
+        ratio = targetRatio;
+
+    firstBlock = false;
+
+    const auto ratioStep = (targetRatio - ratio) / (float) numSamples;
+
+    // The slave's phase is the master's, scaled by the ratio, so every sample's is known up front
+    for (int i = 0; i < numSamples; ++i)
+    {
+        auto p = phase + (float) i * increment;
+        ratios[i] = ratio + (float) (i + 1) * ratioStep;
+        slavePhases[i] = ratios[i] * (p - (float) (int) p);
+    }
+
+    kernels.renderPhaseOperator(table, tableSize, 0.0f, 0.0f, slavePhases, output, numSamples);
+
+    // Each time the master completes a cycle, the slave jumps from ratio cycles in back to its start.
+    // A jump that falls just after the last sample is corrected from the next block's first
+    const auto end = phase + (float) numSamples * increment;
+    const auto start = readTable(0.0f);
+
+    for (int cycle = 1; cycle <= (int) end; ++cycle)
+    {
+        // The first sample at or past the restart, by the same sums as the phases above
+        auto i = juce::jmax(0, (int) std::ceil(((float) cycle - phase) / increment) - 1);
+
+        while ((int) (phase + (float) i * increment) < cycle)
+            ++i;
+
+        auto timeSinceStep = (phase + (float) i * increment - (float) cycle) / increment;
+        auto ratioAtStep = i < numSamples ? ratios[i] : targetRatio;
+        auto before = readTable(ratioAtStep - (float) (int) ratioAtStep);
+
+        addStep(i, timeSinceStep, start - before);
+    }
+
+    juce::FloatVectorOperations::add(output, corrections, numSamples);
+
+    // Keep the tails that reach into the next block
+    std::copy(corrections + numSamples, corrections + numSamples + BandLimitedStep::numTaps, corrections);
+    std::fill(corrections + BandLimitedStep::numTaps, std::end(corrections), 0.0f);
+
+    phase = end - (float) (int) end;
+    ratio = targetRatio;
+}
+
+float HardSyncOscillator::readTable(float cycles) const noexcept
+{
+    auto position = cycles * (float) tableSize;
+    auto index = (unsigned int) position;
+    auto frac = position - (float) index;
+    index &= mask;
+
+    return table[index] + frac * (table[index + 1] - table[index]);
+}
+
+void HardSyncOscillator::addStep(int startSample, float timeSinceStep, float height) noexcept
+{
+    // A jump too small to hear isn't worth the 32 taps
+    if (std::abs(height) < 1.0e-5f)
+        return;
+
+    for (int i = 0; i < BandLimitedStep::numTaps; ++i)
+        corrections[startSample + i] += height * BandLimitedStep::lookup(residual, (float) i + timeSinceStep);
+}
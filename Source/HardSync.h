@@ -0,0 +1,114 @@
+/*
+  ==============================================================================
+
+    HardSync.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "SimdKernels.h"
+
+/** The minBLEP residual: a band-limited, minimum-phase step minus the ideal
+    step, which is what has to be added after a jump to remove its aliasing.
+    Being minimum-phase, it starts at the jump itself, so it needs no lookahead
+    or latency.
+*/
+namespace BandLimitedStep
+{
+    /** How many output samples a correction lasts, and its resolution in between. */
+    constexpr int numTaps = 32;
+    constexpr int oversampling = 64;
+
+    // The last point is 0, for interpolation
+    using Residual = std::array<float, numTaps * oversampling + 1>;
+
+    /** One table for the whole process, built on first use, which should not be on the audio thread. */
+    const Residual& getResidual();
+
+    /** The residual of a unit step, time samples after it. */
+    inline float lookup(const Residual& residual, float time) noexcept
+    {
+        auto position = time * (float) oversampling;
+        auto index = (int) position;
+
+        if (index >= numTaps * oversampling)
+            return 0.0f;
+
+        auto frac = position - (float) index;
+        return residual[(size_t) index] + frac * (residual[(size_t) index + 1] - residual[(size_t) index]);
+    }
+}
+
+//==============================================================================
+/**
+    A hard-synced oscillator: a slave wave at ratio times the note's frequency,
+    restarted from the beginning of its cycle every time a master oscillator at
+    the note's frequency completes one.
+
+    The slave reads a table band-limited for its own frequency, the note's times
+    the ratio: a mip level of the basic shapes, or of the custom wavetable. So
+    only the restarts can alias. Each one is a jump whose height and sub-sample time are known, and
+    gets the shared minBLEP residual scaled to it, which keeps sync clean at the
+    plain sample rate.
+
+    Since the slave restarts with the master, its phase is always the master's
+    times the ratio. That is worked out for the whole block up front, and the
+    table is read with SimdKernels' phase operator kernel for this CPU; only
+    the restarts are handled one at a time.
+*/
+class HardSyncOscillator
+{
+public:
+    /** The most samples one process() call can render. */
+    static constexpr int maxBlockSize = 64;
+
+    HardSyncOscillator();
+
+    /** numSamples includes the guard sample at the end, as for WavetableOscillator.
+        Only repoints the oscillator, so it is safe to call from the audio thread.
+    */
+    void setTable(const float* samples, int numSamples) noexcept;
+
+    /** ratio is the slave's frequency over the master's, 1 or more. Changes are ramped across a block. */
+    void setSync(bool shouldBeEnabled, float newRatio) noexcept;
+    bool isEnabled() const noexcept     { return enabled; }
+
+    /** How far above the note the slave plays: the ratio while enabled, otherwise 1. */
+    float getFrequencyRatio() const noexcept    { return enabled ? targetRatio : 1.0f; }
+
+    /** The master's frequency, which is the note's. */
+    void setFrequency(float frequency, float sampleRate) noexcept;
+
+    /** Restarts both oscillators and drops any pending corrections, for a new note. */
+    void reset() noexcept;
+
+    /** Overwrites output with the slave. */
+    void process(float* output, int numSamples) noexcept;
+
+private:
+    float readTable(float cycles) const noexcept;
+    void addStep(int startSample, float timeSinceStep, float height) noexcept;
+
+    const float* table = nullptr;
+    int tableSize = 0;
+    unsigned int mask = 0;
+
+    bool enabled = false;
+    float ratio = 1.0f, targetRatio = 1.0f;
+    bool firstBlock = true;
+
+    // The master's phase and increment, in cycles
+    float phase = 0.0f, increment = 0.0f;
+
+    alignas(16) float slavePhases[maxBlockSize];
+    alignas(16) float ratios[maxBlockSize];
+
+    // Corrections for this block and the tails of the steps near its end, which run into the next one
+    alignas(16) float corrections[maxBlockSize + BandLimitedStep::numTaps];
+
+    const BandLimitedStep::Residual& residual;
+    const SimdKernels::Kernels& kernels = SimdKernels::get();
+};
@@ -0,0 +1,85 @@
+/*
+  ==============================================================================
+
+    HarmonicEditorComponent.cpp
+
+  ==============================================================================
+*/
+
+#include "HarmonicEditorComponent.h"
+
+HarmonicEditorComponent::HarmonicEditorComponent(MysynthpracAudioProcessor& p)
+    : audioProcessor(p), harmonics(p.getHarmonics())
+{
+}
+
+void HarmonicEditorComponent::refresh()
+{
+    auto current = audioProcessor.getHarmonics();
+
+    for (int i = 0; i < HarmonicWavetable::numHarmonics; ++i)
+    {
+        if (current[(size_t) i].amplitude != harmonics[(size_t) i].amplitude || current[(size_t) i].phase != harmonics[(size_t) i].phase)
+        {
+            harmonics = current;
+            repaint();
+            return;
+        }
+    }
+}
+
+void HarmonicEditorComponent::paint(juce::Graphics& g)
+{
+    g.fillAll(juce::Colour::fromRGB(38, 38, 38));
+
+    const auto barWidth = (float) getWidth() / (float) HarmonicWavetable::numHarmonics;
+    const auto height = (float) getHeight();
+
+    for (int i = 0; i < HarmonicWavetable::numHarmonics; ++i)
+    {
+        auto& harmonic = harmonics[(size_t) i];
+        auto bar = juce::Rectangle<float>(i * barWidth, 0.0f, barWidth, height).reduced(1.0f, 0.0f);
+
+        g.setColour(juce::Colour::fromRGB(122, 122, 122));
+        g.fillRect(bar.withTrimmedTop(bar.getHeight() * (1.0f - harmonic.amplitude)));
+
+        // Phase is marked as a tick on the bar
+        g.setColour(juce::Colours::green);
+        g.fillRect(bar.withY(height * (1.0f - harmonic.phase) - 1.0f).withHeight(2.0f));
+    }
+}
+
+void HarmonicEditorComponent::mouseDown(const juce::MouseEvent& e)
+{
+    editAt(e);
+}
+
+void HarmonicEditorComponent::mouseDrag(const juce::MouseEvent& e)
+{
+    editAt(e);
+}
+
+void HarmonicEditorComponent::editAt(const juce::MouseEvent& e)
+{
+    auto index = juce::jlimit(0, HarmonicWavetable::numHarmonics - 1, e.x * HarmonicWavetable::numHarmonics / juce::jmax(1, getWidth()));
+    auto value = juce::jlimit(0.0f, 1.0f, 1.0f - (float) e.y / (float) juce::jmax(1, getHeight()));
+    auto& harmonic = harmonics[(size_t) index];
+
+    if (e.mods.isShiftDown())
+    {
+        if (harmonic.phase == value)
+            return;
+
+        harmonic.phase = value;
+    }
+    else
+    {
+        if (harmonic.amplitude == value)
+            return;
+
+        harmonic.amplitude = value;
+    }
+
+    audioProcessor.setHarmonics(harmonics);
+    repaint();
+}
@@ -0,0 +1,38 @@
+/*
+  ==============================================================================
+
+    HarmonicEditorComponent.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+
+//==============================================================================
+/**
+    Bars for the harmonics of the CUSTOM wave. Drag across them to draw the
+    amplitudes; hold shift to draw the phases instead.
+*/
+class HarmonicEditorComponent  : public juce::Component
+{
+public:
+    explicit HarmonicEditorComponent(MysynthpracAudioProcessor& p);
+
+    void paint(juce::Graphics& g) override;
+    void mouseDown(const juce::MouseEvent& e) override;
+    void mouseDrag(const juce::MouseEvent& e) override;
+
+    /** Picks up harmonics that changed underneath the editor, e.g. after loading a preset. */
+    void refresh();
+
+private:
+    void editAt(const juce::MouseEvent& e);
+
+    MysynthpracAudioProcessor& audioProcessor;
+    HarmonicWavetable::Harmonics harmonics;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (HarmonicEditorComponent)
+};
@@ -0,0 +1,251 @@
+/*
+  ==============================================================================
+
+    HarmonicWavetable.cpp
+
+  ==============================================================================
+*/
+
+#include "HarmonicWavetable.h"
+
+static_assert((1 << 10) == HarmonicWavetable::tableSize, "The inverse FFT must be the size of a table");
+static_assert((HarmonicWavetable::numHarmonics >> (HarmonicWavetable::numLevels - 1)) == 1, "The top level should hold just the fundamental");
+
+//==============================================================================
+class HarmonicWavetable::RebuildJob  : public juce::ThreadPoolJob
+{
+public:
+    explicit RebuildJob(HarmonicWavetable& o)
+        : juce::ThreadPoolJob("Harmonic wavetable rebuild"), owner(o)
+    {
+    }
+
+    JobStatus runJob() override
+    {
+        owner.rebuildDirtyLevels(*this);
+        return jobHasFinished;
+    }
+
+    HarmonicWavetable& owner;
+};
+
+//==============================================================================
+HarmonicWavetable::HarmonicWavetable()
+{
+    harmonics = createSaw();
+}
+
+HarmonicWavetable::~HarmonicWavetable()
+{
+    struct JobsOwnedBy  : public juce::ThreadPool::JobSelector
+    {
+        explicit JobsOwnedBy(HarmonicWavetable& o) : owner(o) {}
+
+        bool isJobSuitable(juce::ThreadPoolJob* job) override
+        {
+            auto* rebuild = dynamic_cast<RebuildJob*>(job);
+            return rebuild != nullptr && &rebuild->owner == &owner;
+        }
+
+        HarmonicWavetable& owner;
+    };
+
+    JobsOwnedBy selector(*this);
+    sharedResources->getWorkerPool().removeAllJobs(true, 2000, &selector);
+}
+
+void HarmonicWavetable::prepare()
+{
+    const juce::ScopedLock sl(rebuildLock);
+
+    if (prepared)
+        return;
+
+    inverseFFT = &sharedResources->getFFT(10);
+    work.resize((size_t) tableSize * 2);
+
+    // Anything set from here on is picked up by a rebuild job
+    dirtyLevels = 0;
+    auto snapshot = getHarmonics();
+
+    for (int level = 0; level < numLevels; ++level)
+    {
+        for (auto& table : tables[(size_t) level])
+            table.setSize(1, tableSize + 1);
+
+        renderLevel(snapshot, level, tables[(size_t) level][(size_t) frontIndex[(size_t) level].load()]);
+    }
+
+    prepared = true;
+
+    if (dirtyLevels != 0)
+        scheduleRebuild();
+}
+
+void HarmonicWavetable::setHarmonics(const Harmonics& newHarmonics)
+{
+    auto changedLevels = 0;
+
+    {
+        const juce::SpinLock::ScopedLockType sl(lock);
+
+        for (int i = 0; i < numHarmonics; ++i)
+        {
+            auto& oldHarmonic = harmonics[(size_t) i];
+            auto& newHarmonic = newHarmonics[(size_t) i];
+
+            if (oldHarmonic.amplitude != newHarmonic.amplitude || oldHarmonic.phase != newHarmonic.phase)
+                changedLevels |= getLevelsContaining(i);
+        }
+
+        harmonics = newHarmonics;
+    }
+
+    if (changedLevels != 0)
+    {
+        dirtyLevels |= changedLevels;
+
+        // Before prepare() there are no tables yet; it builds them from the latest harmonics
+        if (prepared)
+            scheduleRebuild();
+    }
+}
+
+void HarmonicWavetable::scheduleRebuild()
+{
+    if (! rebuildScheduled.exchange(true))
+        sharedResources->getWorkerPool().addJob(new RebuildJob(*this), true);
+}
+
+HarmonicWavetable::Harmonics HarmonicWavetable::getHarmonics() const
+{
+    const juce::SpinLock::ScopedLockType sl(lock);
+    return harmonics;
+}
+
+int HarmonicWavetable::getLevelsContaining(int harmonicIndex) noexcept
+{
+    auto levels = 0;
+
+    for (int level = 0; level < numLevels; ++level)
+        if (harmonicIndex < (numHarmonics >> level))
+            levels |= 1 << level;
+
+    return levels;
+}
+
+const juce::AudioSampleBuffer& HarmonicWavetable::getTable(float frequency, double sampleRate) const noexcept
+{
+    auto harmonicsBelowNyquist = (int) (0.5 * sampleRate / juce::jmax(1.0f, frequency));
+    auto level = 0;
+
+    while (level < numLevels - 1 && (numHarmonics >> level) > harmonicsBelowNyquist)
+        ++level;
+
+    return tables[(size_t) level][(size_t) frontIndex[(size_t) level].load()];
+}
+
+//==============================================================================
+void HarmonicWavetable::renderLevel(const Harmonics& source, int level, juce::AudioSampleBuffer& destination)
+{
+    std::fill(work.begin(), work.end(), 0.0f);
+
+    // With the inverse FFT's 1/N scaling, bin h = (N/2) * a * e^(i(phase - pi/2)) gives a * sin(h * x + phase)
+    const auto scale = 0.5f * (float) tableSize;
+
+    for (int i = 0; i < (numHarmonics >> level); ++i)
+    {
+        auto& harmonic = source[(size_t) i];
+        auto phase = juce::MathConstants<float>::twoPi * harmonic.phase;
+        auto bin = (size_t) (i + 1) * 2;
+
+        work[bin]     = scale * harmonic.amplitude * std::sin(phase);
+        work[bin + 1] = -scale * harmonic.amplitude * std::cos(phase);
+    }
+
+    inverseFFT->performRealOnlyInverseTransform(work.data());
+
+    auto* samples = destination.getWritePointer(0);
+    std::copy(work.begin(), work.begin() + tableSize, samples);
+    samples[tableSize] = samples[0];
+}
+
+bool HarmonicWavetable::isBackBufferFree(int level) const noexcept
+{
+    // The back buffer was the front one until the last publish. If a block was
+    // running then, it may still be reading it until that block ends
+    auto published = publishedAt[(size_t) level];
+    return (published & 1) == 0 || blockCounter.load() != published;
+}
+
+void HarmonicWavetable::rebuildDirtyLevels(const juce::ThreadPoolJob& job)
+{
+    const juce::ScopedLock sl(rebuildLock);
+
+    // Cleared before looking at the levels, so any edit from here on queues another job
+    rebuildScheduled = false;
+
+    auto levels = dirtyLevels.exchange(0);
+    auto snapshot = getHarmonics();
+
+    for (int level = 0; level < numLevels; ++level)
+    {
+        if ((levels & (1 << level)) == 0)
+            continue;
+
+        // At most one audio block
+        while (! isBackBufferFree(level))
+        {
+            if (job.shouldExit())
+                return;
+
+            juce::Thread::sleep(1);
+        }
+
+        auto back = 1 - frontIndex[(size_t) level].load();
+        renderLevel(snapshot, level, tables[(size_t) level][(size_t) back]);
+
+        frontIndex[(size_t) level].store(back);
+        publishedAt[(size_t) level] = blockCounter.load();
+    }
+}
+
+//==============================================================================
+HarmonicWavetable::Harmonics HarmonicWavetable::createSaw()
+{
+    Harmonics saw;
+
+    for (int i = 0; i < numHarmonics; ++i)
+        saw[(size_t) i].amplitude = 0.6366f / (float) (i + 1);     // 2 / pi / n, a unit saw
+
+    return saw;
+}
+
+juce::String HarmonicWavetable::harmonicsToString(const Harmonics& source)
+{
+    juce::StringArray entries;
+
+    for (auto& harmonic : source)
+        entries.add(juce::String(harmonic.amplitude, 4) + ":" + juce::String(harmonic.phase, 4));
+
+    return entries.joinIntoString(";");
+}
+
+HarmonicWavetable::Harmonics HarmonicWavetable::harmonicsFromString(const juce::String& text)
+{
+    auto entries = juce::StringArray::fromTokens(text, ";", {});
+
+    if (entries.isEmpty())
+        return createSaw();
+
+    Harmonics result;
+
+    for (int i = 0; i < juce::jmin(entries.size(), numHarmonics); ++i)
+    {
+        auto fields = juce::StringArray::fromTokens(entries[i], ":", {});
+        result[(size_t) i].amplitude = juce::jlimit(0.0f, 1.0f, fields[0].getFloatValue());
+        result[(size_t) i].phase = juce::jlimit(0.0f, 1.0f, fields[1].getFloatValue());
+    }
+
+    return result;
+}
@@ -0,0 +1,107 @@
+/*
+  ==============================================================================
+
+    HarmonicWavetable.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "SharedResources.h"
+
+//==============================================================================
+/**
+    A user-designed wave, described by the amplitude and phase of its first
+    numHarmonics harmonics and built into band-limited mip levels by inverse
+    FFT. Level n keeps only the lowest numHarmonics >> n harmonics, so higher
+    notes can use a level that doesn't alias.
+
+    Edits are rebuilt on the process-wide worker pool, and only the levels
+    that contain a changed harmonic are rebuilt: a change to a high harmonic
+    touches a single level. Each level is double-buffered. A rebuilt level is
+    published by flipping its front index, and the old buffer isn't reused
+    until any block that might still be reading it has finished, so the
+    audio thread never waits.
+
+    The audio thread must wrap its use of the tables in a ScopedBlock, and
+    re-fetch the table with getTable() at least once per block.
+*/
+class HarmonicWavetable
+{
+public:
+    static constexpr int numHarmonics = 64;
+    static constexpr int tableSize = 1024;
+    static constexpr int numLevels = 7;    // 64, 32, ... 1 harmonics
+
+    struct Harmonic
+    {
+        float amplitude = 0.0f;
+        float phase = 0.0f;     // fraction of a cycle
+    };
+
+    using Harmonics = std::array<Harmonic, numHarmonics>;
+
+    HarmonicWavetable();
+    ~HarmonicWavetable();
+
+    /** Builds the tables the first time it's called. Not on the audio thread. */
+    void prepare();
+
+    /** Call from the message thread. Returns straight away; the tables follow shortly after. */
+    void setHarmonics(const Harmonics& newHarmonics);
+    Harmonics getHarmonics() const;
+
+    /** The level with as many harmonics as fit below Nyquist at this frequency. Only valid after prepare(). */
+    const juce::AudioSampleBuffer& getTable(float frequency, double sampleRate) const noexcept;
+
+    /** Marks the span in which the audio thread may hold on to a table. */
+    class ScopedBlock
+    {
+    public:
+        explicit ScopedBlock(HarmonicWavetable& t) noexcept : table(t)     { ++table.blockCounter; }
+        ~ScopedBlock() noexcept                                            { ++table.blockCounter; }
+
+    private:
+        HarmonicWavetable& table;
+        JUCE_DECLARE_NON_COPYABLE (ScopedBlock)
+    };
+
+    static Harmonics createSaw();
+
+    /** "amplitude:phase" per harmonic, separated by semicolons, for saving with the plugin state. */
+    static juce::String harmonicsToString(const Harmonics& harmonics);
+    static Harmonics harmonicsFromString(const juce::String& text);
+
+private:
+    class RebuildJob;
+
+    void scheduleRebuild();
+    void rebuildDirtyLevels(const juce::ThreadPoolJob& job);
+    void renderLevel(const Harmonics& source, int level, juce::AudioSampleBuffer& destination);
+    bool isBackBufferFree(int level) const noexcept;
+
+    static int getLevelsContaining(int harmonicIndex) noexcept;
+
+    juce::SpinLock lock;
+    Harmonics harmonics;
+    std::atomic<int> dirtyLevels { 0 };
+
+    juce::SharedResourcePointer<SharedResources> sharedResources;
+    std::atomic<bool> prepared { false }, rebuildScheduled { false };
+
+    // Held by whichever job is rebuilding, so two jobs never write the same tables
+    juce::CriticalSection rebuildLock;
+    const juce::dsp::FFT* inverseFFT = nullptr;
+    std::vector<float> work;
+
+    std::array<std::array<juce::AudioSampleBuffer, 2>, numLevels> tables;
+    std::array<std::atomic<int>, numLevels> frontIndex {};
+
+    // Odd while the audio thread is inside a block
+    std::atomic<juce::uint32> blockCounter { 0 };
+    std::array<juce::uint32, numLevels> publishedAt {};
+
+    JUCE_DECLARE_NON_COPYABLE (HarmonicWavetable)
+};
@@ -0,0 +1,372 @@
+/*
+  ==============================================================================
+
+    LatencyTest.cpp
+
+  ==============================================================================
+*/
+
+#include "LatencyTest.h"
+#include "PluginProcessor.h"
+#include <iostream>
+
+namespace
+{
+    double nowMs() noexcept     { return juce::Time::getMillisecondCounterHiRes(); }
+
+    constexpr int noteLengthMs = 20;
+    constexpr double silenceHoldSeconds = 0.02;     // silence needed before the next onset counts
+}
+
+//==============================================================================
+/** Calls its callback from a high-priority thread at the pace of a real device, and
+    times the callbacks and the note onsets in their output.
+*/
+class LatencyTest::DummyDevice  : public juce::AudioIODevice, private juce::Thread
+{
+public:
+    DummyDevice(int maxOnsets, int maxBlocks, float threshold)
+        : juce::AudioIODevice("Dummy", "Latency test"),
+          juce::Thread("Dummy audio device"),
+          onsetThreshold(threshold)
+    {
+        onsetTimes.resize((size_t) maxOnsets);
+        lateness.resize((size_t) maxBlocks);
+        processTimes.resize((size_t) maxBlocks);
+    }
+
+    ~DummyDevice() override
+    {
+        close();
+    }
+
+    juce::StringArray getOutputChannelNames() override      { return { "Left", "Right" }; }
+    juce::StringArray getInputChannelNames() override       { return {}; }
+    juce::Array<double> getAvailableSampleRates() override  { return { sampleRate }; }
+    juce::Array<int> getAvailableBufferSizes() override     { return { bufferSize }; }
+    int getDefaultBufferSize() override                     { return bufferSize; }
+
+    juce::String open(const juce::BigInteger&, const juce::BigInteger&, double newSampleRate, int newBufferSize) override
+    {
+        close();
+
+        sampleRate = newSampleRate;
+        bufferSize = newBufferSize;
+        outputs.setSize(numOutputs, bufferSize);
+        opened = true;
+
+        return {};
+    }
+
+    void close() override
+    {
+        stop();
+        opened = false;
+    }
+
+    bool isOpen() override      { return opened; }
+
+    void start(juce::AudioIODeviceCallback* newCallback) override
+    {
+        stop();
+
+        if (newCallback == nullptr)
+            return;
+
+        callback = newCallback;
+        callback->audioDeviceAboutToStart(this);
+        startThread(juce::Thread::Priority::highest);
+    }
+
+    void stop() override
+    {
+        if (callback == nullptr)
+            return;
+
+        stopThread(2000);
+        callback->audioDeviceStopped();
+        callback = nullptr;
+    }
+
+    bool isPlaying() override                   { return callback != nullptr; }
+    juce::String getLastError() override        { return {}; }
+    int getCurrentBufferSizeSamples() override  { return bufferSize; }
+    double getCurrentSampleRate() override      { return sampleRate; }
+    int getCurrentBitDepth() override           { return 32; }
+    int getOutputLatencyInSamples() override    { return bufferSize; }
+    int getInputLatencyInSamples() override     { return 0; }
+
+    juce::BigInteger getActiveOutputChannels() const override
+    {
+        juce::BigInteger channels;
+        channels.setRange(0, numOutputs, true);
+        return channels;
+    }
+
+    juce::BigInteger getActiveInputChannels() const override    { return {}; }
+
+    // Only read these once the device has stopped
+    std::vector<double> getOnsetTimes() const       { return { onsetTimes.begin(), onsetTimes.begin() + (std::ptrdiff_t) numOnsets }; }
+    std::vector<double> getLateness() const         { return { lateness.begin(), lateness.begin() + (std::ptrdiff_t) numBlocks }; }
+    std::vector<double> getProcessTimes() const     { return { processTimes.begin(), processTimes.begin() + (std::ptrdiff_t) numBlocks }; }
+
+private:
+    void run() override
+    {
+        const auto blockMs = 1000.0 * bufferSize / sampleRate;
+        const auto msPerSample = 1000.0 / sampleRate;
+        const auto holdSamples = (int) (silenceHoldSeconds * sampleRate);
+        const auto silenceThreshold = onsetThreshold * 0.1f;
+        const auto startTime = nowMs() + blockMs;
+
+        auto silentRun = holdSamples;
+        juce::AudioIODeviceCallbackContext context;
+
+        for (juce::int64 block = 0; ! threadShouldExit(); ++block)
+        {
+            const auto deadline = startTime + (double) block * blockMs;
+
+            // Sleep most of the way, then yield until the deadline for an accurate start
+            for (auto remaining = deadline - nowMs(); remaining > 0.0; remaining = deadline - nowMs())
+            {
+                if (remaining > 2.0)
+                    juce::Thread::sleep((int) (remaining - 1.5));
+                else
+                    juce::Thread::yield();
+            }
+
+            const auto callbackStart = nowMs();
+
+            outputs.clear();
+            callback->audioDeviceIOCallbackWithContext(nullptr, 0, outputs.getArrayOfWritePointers(), numOutputs, bufferSize, context);
+
+            if (numBlocks < lateness.size())
+            {
+                lateness[numBlocks] = callbackStart - deadline;
+                processTimes[numBlocks] = nowMs() - callbackStart;
+                ++numBlocks;
+            }
+
+            // Like a double-buffered card, the block reaches the output one buffer after it was due
+            const auto playoutStart = deadline + blockMs;
+            const auto* samples = outputs.getReadPointer(0);
+
+            for (int i = 0; i < bufferSize; ++i)
+            {
+                const auto level = std::abs(samples[i]);
+                const auto armed = silentRun >= holdSamples;
+
+                if (level >= onsetThreshold)
+                {
+                    if (armed && numOnsets < onsetTimes.size())
+                        onsetTimes[numOnsets++] = playoutStart + i * msPerSample;
+
+                    silentRun = 0;
+                }
+                else if (level < silenceThreshold)
+                {
+                    ++silentRun;
+                }
+                else if (! armed)
+                {
+                    silentRun = 0;
+                }
+            }
+        }
+    }
+
+    static constexpr int numOutputs = 2;
+
+    const float onsetThreshold;
+    double sampleRate = 48000.0;
+    int bufferSize = 256;
+    bool opened = false;
+
+    juce::AudioIODeviceCallback* callback = nullptr;
+    juce::AudioBuffer<float> outputs;
+
+    std::vector<double> onsetTimes, lateness, processTimes;
+    size_t numOnsets = 0, numBlocks = 0;
+};
+
+//==============================================================================
+LatencyTest::Distribution LatencyTest::Distribution::of(std::vector<double> values)
+{
+    Distribution d;
+    d.count = (int) values.size();
+
+    if (values.empty())
+        return d;
+
+    std::sort(values.begin(), values.end());
+
+    auto percentile = [&values](double p)
+    {
+        auto index = (size_t) juce::jlimit(0, (int) values.size() - 1, (int) std::ceil(p * (double) values.size()) - 1);
+        return values[index];
+    };
+
+    d.min = values.front();
+    d.max = values.back();
+    d.p50 = percentile(0.5);
+    d.p95 = percentile(0.95);
+    d.p99 = percentile(0.99);
+
+    auto sum = 0.0, sumOfSquares = 0.0;
+
+    for (auto v : values)
+    {
+        sum += v;
+        sumOfSquares += v * v;
+    }
+
+    d.mean = sum / d.count;
+    d.stdDev = std::sqrt(juce::jmax(0.0, sumOfSquares / d.count - d.mean * d.mean));
+
+    return d;
+}
+
+std::vector<LatencyTest::RunResult> LatencyTest::run(const Options& options)
+{
+    std::vector<RunResult> results;
+    juce::Random random;
+
+    for (auto bufferSize : options.bufferSizes)
+    {
+        RunResult result;
+        result.bufferSize = bufferSize;
+
+        MysynthpracAudioProcessor processor;
+        processor.setLiveMidiJitterBufferMs(options.jitterBufferMs);
+        processor.setLiveMidiInputEnabled(true);
+
+        juce::AudioProcessorPlayer player;
+        player.setProcessor(&processor);
+
+        const auto blockMs = 1000.0 * bufferSize / options.sampleRate;
+        const auto expectedMs = options.notesPerRun * options.noteSpacingMs * 1.5 + 2000.0;
+
+        DummyDevice device(options.notesPerRun * 2, (int) (expectedMs / blockMs) + 1, options.onsetThreshold);
+        juce::BigInteger outputs;
+        outputs.setRange(0, 2, true);
+        device.open({}, outputs, options.sampleRate, bufferSize);
+        device.start(&player);
+
+        // Let the first blocks go by, so start-up costs don't count as latency
+        juce::Thread::sleep(500);
+
+        auto input = processor.getLiveMidiInput();
+        std::vector<double> sentTimes;
+
+        for (int n = 0; n < options.notesPerRun; ++n)
+        {
+            auto noteOn = juce::MidiMessage::noteOn(1, 60, 1.0f);
+            auto sendTime = nowMs();
+            noteOn.setTimeStamp(sendTime * 0.001);
+            input->addMessage(noteOn);
+            sentTimes.push_back(sendTime);
+
+            juce::Thread::sleep(noteLengthMs);
+
+            auto noteOff = juce::MidiMessage::noteOff(1, 60);
+            noteOff.setTimeStamp(nowMs() * 0.001);
+            input->addMessage(noteOff);
+
+            juce::Thread::sleep(juce::jmax(1, (int) (options.noteSpacingMs * (0.5 + random.nextDouble())) - noteLengthMs));
+        }
+
+        juce::Thread::sleep(500);
+        device.stop();
+        player.setProcessor(nullptr);
+
+        // Pair each note with the first onset heard after it and before the next note
+        auto onsets = device.getOnsetTimes();
+        std::vector<double> latencies;
+        size_t onset = 0;
+
+        for (size_t n = 0; n < sentTimes.size(); ++n)
+        {
+            while (onset < onsets.size() && onsets[onset] < sentTimes[n])
+                ++onset;
+
+            if (onset < onsets.size() && (n + 1 == sentTimes.size() || onsets[onset] < sentTimes[n + 1]))
+                latencies.push_back(onsets[onset++] - sentTimes[n]);
+        }
+
+        result.notesSent = (int) sentTimes.size();
+        result.onsetsFound = (int) latencies.size();
+        result.latency = Distribution::of(latencies);
+        result.callbackLateness = Distribution::of(device.getLateness());
+        result.processTime = Distribution::of(device.getProcessTimes());
+        result.liveInput = input->getLatencyStats();
+
+        results.push_back(result);
+    }
+
+    return results;
+}
+
+juce::String LatencyTest::describe(const std::vector<RunResult>& results)
+{
+    auto format = [](const Distribution& d)
+    {
+        return "min " + juce::String(d.min, 3) + ", p50 " + juce::String(d.p50, 3) + ", p95 " + juce::String(d.p95, 3)
+                + ", p99 " + juce::String(d.p99, 3) + ", max " + juce::String(d.max, 3) + ", sd " + juce::String(d.stdDev, 3) + " ms";
+    };
+
+    juce::String text;
+
+    for (auto& result : results)
+    {
+        text << "buffer " << result.bufferSize << ": " << result.onsetsFound << " of " << result.notesSent << " notes heard\n"
+             << "  latency           " << format(result.latency) << "\n"
+             << "  callback lateness " << format(result.callbackLateness) << "\n"
+             << "  process time      " << format(result.processTime) << "\n"
+             << "  live input        " << result.liveInput.numEvents << " events (" << result.liveInput.numLateEvents << " late), min "
+             << juce::String(result.liveInput.minMs, 3) << ", mean " << juce::String(result.liveInput.averageMs, 3)
+             << ", max " << juce::String(result.liveInput.maxMs, 3) << ", jitter "
+             << juce::String(result.liveInput.maxMs - result.liveInput.minMs, 3) << " ms\n";
+    }
+
+    return text;
+}
+
+int LatencyTest::runFromCommandLine(const juce::String& commandLine)
+{
+    Options options;
+    juce::File reportFile;
+
+    for (auto& argument : juce::StringArray::fromTokens(commandLine, true))
+    {
+        auto value = argument.fromFirstOccurrenceOf("=", false, false);
+
+        if (argument.startsWith("--buffer-sizes="))
+        {
+            options.bufferSizes.clear();
+
+            for (auto& size : juce::StringArray::fromTokens(value, ",", {}))
+                if (size.getIntValue() > 0)
+                    options.bufferSizes.add(size.getIntValue());
+        }
+        else if (argument.startsWith("--notes="))         options.notesPerRun = juce::jmax(1, value.getIntValue());
+        else if (argument.startsWith("--spacing-ms="))    options.noteSpacingMs = juce::jmax(300.0, value.getDoubleValue());
+        else if (argument.startsWith("--sample-rate="))   options.sampleRate = juce::jmax(8000.0, value.getDoubleValue());
+        else if (argument.startsWith("--jitter-ms="))     options.jitterBufferMs = juce::jmax(0.0, value.getDoubleValue());
+        else if (argument.startsWith("--report="))        reportFile = juce::File(value.unquoted());
+    }
+
+    auto results = run(options);
+    auto report = describe(results);
+
+    std::cout << report << std::flush;
+
+    if (reportFile != juce::File())
+        reportFile.replaceWithText(report);
+
+    // Every note should have been heard
+    for (auto& result : results)
+        if (result.onsetsFound < result.notesSent)
+            return 1;
+
+    return 0;
+}
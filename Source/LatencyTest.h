@@ -0,0 +1,78 @@
+/*
+  ==============================================================================
+
+    LatencyTest.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "LiveMidiInput.h"
+
+//==============================================================================
+/**
+    Measures MIDI-to-sound latency and callback jitter of the standalone audio
+    path without any audio hardware.
+
+    The processor runs inside a juce::AudioProcessorPlayer, as in the
+    standalone app, driven by a dummy audio device that calls it at real-time
+    pace from its own thread. Notes go in through the processor's
+    LiveMidiInput with wall-clock timestamps, exactly like the standalone
+    app's MIDI inputs, and the device finds each note's onset in the rendered
+    output.
+
+    The dummy device behaves like a double-buffered sound card: a block
+    requested at time t reaches the output one buffer later, so latency
+    includes one buffer of output delay.
+
+    Each run also reports the live input's own latency and jitter estimate,
+    worked out from where it placed each event, next to the measured figures.
+
+    Start the standalone app with --latency-test to run it; see
+    runFromCommandLine() for the options.
+*/
+class LatencyTest
+{
+public:
+    struct Options
+    {
+        double sampleRate = 48000.0;
+        juce::Array<int> bufferSizes { 32, 64, 128, 256, 512, 1024 };
+        int notesPerRun = 100;
+        double noteSpacingMs = 300.0;       // randomised by +-50% so notes land anywhere in a block
+        float onsetThreshold = 0.01f;
+        double jitterBufferMs = 0.0;        // the live input's setting, see LiveMidiInput
+    };
+
+    /** Summary of a set of measurements, in milliseconds. */
+    struct Distribution
+    {
+        int count = 0;
+        double min = 0.0, p50 = 0.0, p95 = 0.0, p99 = 0.0, max = 0.0, mean = 0.0, stdDev = 0.0;
+
+        static Distribution of(std::vector<double> values);
+    };
+
+    struct RunResult
+    {
+        int bufferSize = 0;
+        Distribution latency;           // note-on timestamp to first sample above the threshold
+        Distribution callbackLateness;  // how late each callback started against its deadline
+        Distribution processTime;       // time spent in each callback
+        LiveMidiInput::LatencyStats liveInput;  // the live input's own estimate, from where it placed each event
+        int notesSent = 0, onsetsFound = 0;
+    };
+
+    static std::vector<RunResult> run(const Options& options);
+    static juce::String describe(const std::vector<RunResult>& results);
+
+    /** Options: --buffer-sizes=64,128,... --notes=N --spacing-ms=X --sample-rate=X --jitter-ms=X --report=file.
+        Prints the report and returns the process exit code.
+    */
+    static int runFromCommandLine(const juce::String& commandLine);
+
+private:
+    class DummyDevice;
+};
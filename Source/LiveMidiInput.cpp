@@ -0,0 +1,146 @@
+/*
+  ==============================================================================
+
+    LiveMidiInput.cpp
+
+  ==============================================================================
+*/
+
+#include "LiveMidiInput.h"
+
+//==============================================================================
+LiveMidiInput::LiveMidiInput()
+{
+}
+
+void LiveMidiInput::prepare (double newSampleRate, int /*maximumBlockSize*/)
+{
+    jassert (newSampleRate > 0.0);
+    sampleRate = newSampleRate;
+    hasTimeline = false;
+
+    const juce::SpinLock::ScopedLockType sl (producerLock);
+    fifo.reset();
+    resetLatencyStats();
+}
+
+void LiveMidiInput::setJitterBufferMs (double newJitterBufferMs) noexcept
+{
+    jitterBufferSeconds = juce::jmax (0.0, newJitterBufferMs) * 0.001;
+}
+
+void LiveMidiInput::setOutputLatencySamples (int numSamples) noexcept
+{
+    outputLatencySeconds = juce::jmax (0, numSamples) / sampleRate;
+}
+
+void LiveMidiInput::addMessage (const juce::MidiMessage& message)
+{
+    // Only short messages are needed to play the synth
+    auto size = message.getRawDataSize();
+
+    if (size <= 0 || size > 3)
+        return;
+
+    TimedMessage timed;
+    timed.timeSeconds = message.getTimeStamp() > 0.0 ? message.getTimeStamp() : now();
+    timed.size = (juce::uint8) size;
+    std::memcpy (timed.data, message.getRawData(), (size_t) size);
+
+    // Several input devices can call this from different threads, the audio thread never takes this lock
+    const juce::SpinLock::ScopedLockType sl (producerLock);
+
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite (1, start1, size1, start2, size2);
+
+    if (size1 + size2 == 0)
+        return;
+
+    messages[(size_t) (size1 > 0 ? start1 : start2)] = timed;
+    fifo.finishedWrite (1);
+}
+
+void LiveMidiInput::removeNextBlockOfMessages (juce::MidiBuffer& destBuffer, int numSamples)
+{
+    if (statsResetPending.exchange (false))
+    {
+        statEvents = 0;
+        statLateEvents = 0;
+        statSumMs = 0.0;
+        statMinMs = 0.0;
+        statMaxMs = 0.0;
+    }
+
+    const auto callbackTime = now();
+    const auto blockDuration = numSamples / sampleRate;
+    const auto targetStart = callbackTime - jitterBufferSeconds.load();
+
+    // Follow the sample clock, pulled gently towards the callback times so their own jitter is smoothed out
+    if (! hasTimeline || std::abs (nextBlockStartTime - targetStart) > juce::jmax (blockDuration, 0.01))
+        blockStartTime = targetStart;
+    else
+        blockStartTime = nextBlockStartTime + 0.05 * (targetStart - nextBlockStartTime);
+
+    hasTimeline = true;
+    nextBlockStartTime = blockStartTime + blockDuration;
+
+    int start1, size1, start2, size2;
+    fifo.prepareToRead (fifo.getNumReady(), start1, size1, start2, size2);
+
+    auto placeMessage = [&] (const TimedMessage& m)
+    {
+        auto offset = (m.timeSeconds - blockStartTime) * sampleRate;
+
+        if (offset >= (double) numSamples)
+            return false;
+
+        auto isLate = offset < 0.0;
+        auto samplePosition = isLate ? 0 : juce::jmin (numSamples - 1, (int) offset);
+        destBuffer.addEvent (m.data, (int) m.size, samplePosition);
+
+        auto latencyMs = (callbackTime - m.timeSeconds + samplePosition / sampleRate + outputLatencySeconds.load()) * 1000.0;
+        auto count = statEvents.load();
+
+        statMinMs = count == 0 ? latencyMs : juce::jmin (statMinMs.load(), latencyMs);
+        statMaxMs = count == 0 ? latencyMs : juce::jmax (statMaxMs.load(), latencyMs);
+        statSumMs = statSumMs.load() + latencyMs;
+        statEvents = count + 1;
+
+        if (isLate)
+            statLateEvents = statLateEvents.load() + 1;
+
+        return true;
+    };
+
+    int numUsed = 0;
+
+    for (int i = 0; i < size1 && placeMessage (messages[(size_t) (start1 + i)]); ++i)
+        ++numUsed;
+
+    if (numUsed == size1)
+        for (int i = 0; i < size2 && placeMessage (messages[(size_t) (start2 + i)]); ++i)
+            ++numUsed;
+
+    fifo.finishedRead (numUsed);
+}
+
+LiveMidiInput::LatencyStats LiveMidiInput::getLatencyStats() const noexcept
+{
+    LatencyStats stats;
+    stats.numEvents = statEvents.load();
+    stats.numLateEvents = statLateEvents.load();
+
+    if (stats.numEvents > 0)
+    {
+        stats.minMs = statMinMs.load();
+        stats.maxMs = statMaxMs.load();
+        stats.averageMs = statSumMs.load() / stats.numEvents;
+    }
+
+    return stats;
+}
+
+void LiveMidiInput::resetLatencyStats() noexcept
+{
+    statsResetPending = true;
+}
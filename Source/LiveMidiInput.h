@@ -0,0 +1,91 @@
+/*
+  ==============================================================================
+
+    LiveMidiInput.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Collects MIDI from live inputs and places it in each audio block at the
+    sample position matching its arrival time.
+
+    The jitter buffer sets the tradeoff: at 0 ms every event is played at the
+    start of the next block (lowest latency, up to one block of jitter); at one
+    block duration or more, events keep their exact spacing at the cost of that
+    much extra latency.
+
+    Messages go through a pre-allocated FIFO, so the audio thread never locks
+    or allocates.
+*/
+class LiveMidiInput : public juce::MidiInputCallback
+{
+public:
+    struct LatencyStats
+    {
+        int numEvents = 0, numLateEvents = 0;
+        double minMs = 0.0, averageMs = 0.0, maxMs = 0.0;
+    };
+
+    LiveMidiInput();
+
+    void prepare (double sampleRate, int maximumBlockSize);
+
+    void setJitterBufferMs (double newJitterBufferMs) noexcept;
+    double getJitterBufferMs() const noexcept      { return jitterBufferSeconds.load() * 1000.0; }
+
+    /** Latency added after the callback (device buffers, converters), included in the stats. */
+    void setOutputLatencySamples (int numSamples) noexcept;
+
+    /** Queues a message. Its timestamp should be in seconds on the
+        Time::getMillisecondCounterHiRes() clock, as MidiInput provides;
+        a zero timestamp means "now".
+    */
+    void addMessage (const juce::MidiMessage& message);
+
+    void handleIncomingMidiMessage (juce::MidiInput*, const juce::MidiMessage& message) override
+    {
+        addMessage (message);
+    }
+
+    /** Moves the events due in the next block into destBuffer. Call once per audio callback. */
+    void removeNextBlockOfMessages (juce::MidiBuffer& destBuffer, int numSamples);
+
+    /** MIDI-to-audio latency measured over the events placed so far. */
+    LatencyStats getLatencyStats() const noexcept;
+    void resetLatencyStats() noexcept;
+
+private:
+    struct TimedMessage
+    {
+        double timeSeconds;
+        juce::uint8 data[3];
+        juce::uint8 size;
+    };
+
+    static constexpr int fifoSize = 2048;
+
+    static double now() noexcept    { return juce::Time::getMillisecondCounterHiRes() * 0.001; }
+
+    juce::AbstractFifo fifo { fifoSize };
+    std::array<TimedMessage, fifoSize> messages;
+    juce::SpinLock producerLock;
+
+    double sampleRate = 44100.0;
+    double blockStartTime = 0.0, nextBlockStartTime = 0.0;
+    bool hasTimeline = false;
+
+    std::atomic<double> jitterBufferSeconds { 0.0 };
+    std::atomic<double> outputLatencySeconds { 0.0 };
+
+    std::atomic<int> statEvents { 0 }, statLateEvents { 0 };
+    std::atomic<double> statSumMs { 0.0 }, statMinMs { 0.0 }, statMaxMs { 0.0 };
+    std::atomic<bool> statsResetPending { false };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LiveMidiInput)
+};
@@ -0,0 +1,250 @@
+/*
+  ==============================================================================
+
+    MasterLimiter.cpp
+
+  ==============================================================================
+*/
+
+#include "MasterLimiter.h"
+
+void MasterLimiter::prepare(double newSampleRate, int newNumChannels, int maximumBlockSize)
+{
+    sampleRate = newSampleRate;
+    numChannels = juce::jmax(1, newNumChannels);
+    chunkSize = juce::jmax(1, maximumBlockSize);
+
+    scratch.setSize(2, chunkSize);
+
+    lookaheadSamples = juce::jmax(1, (int) std::ceil(lookaheadSeconds * sampleRate));
+    delayBuffer.setSize(numChannels, lookaheadSamples);
+
+    // The sliding minimum never holds more entries than its window
+    minimumIndices.resize((size_t) lookaheadSamples + 1);
+    minimumValues.resize((size_t) lookaheadSamples + 1);
+    averageHistory.resize((size_t) lookaheadSamples);
+
+    reset();
+}
+
+void MasterLimiter::reset() noexcept
+{
+    gain = 1.0f;
+    delayBuffer.clear();
+    delayPosition = 0;
+    sampleIndex = 0;
+    resetLookaheadState();
+}
+
+void MasterLimiter::resetLookaheadState() noexcept
+{
+    // As if every recent sample had been under the threshold
+    minimumFront = minimumSize = 0;
+    std::fill(averageHistory.begin(), averageHistory.end(), 1.0f);
+    averagePosition = 0;
+    averageSum = (double) averageHistory.size();
+    samplesUnderThreshold = 0;
+    idle = true;
+}
+
+void MasterLimiter::setLookahead(bool shouldLookAhead)
+{
+    if (shouldLookAhead != lookahead)
+    {
+        lookahead = shouldLookAhead;
+        reset();
+    }
+}
+
+void MasterLimiter::setParameters(bool shouldBeEnabled, float thresholdDecibels, float releaseMs) noexcept
+{
+    if (shouldBeEnabled != enabled)
+    {
+        enabled = shouldBeEnabled;
+        gain = 1.0f;
+        resetLookaheadState();
+    }
+
+    threshold = juce::Decibels::decibelsToGain(thresholdDecibels);
+    kneeStart = juce::Decibels::decibelsToGain(thresholdDecibels - kneeDecibels);
+    releaseCoefficient = 1.0f - std::exp(-1.0f / (juce::jmax(1.0f, releaseMs) * 0.001f * (float) sampleRate));
+}
+
+void MasterLimiter::process(juce::AudioBuffer<float>& buffer, int startSample, int numSamples) noexcept
+{
+    // The host's block can be bigger than the one prepare() was told about
+    for (int start = 0; start < numSamples; start += chunkSize)
+        processChunk(buffer, startSample + start, juce::jmin(chunkSize, numSamples - start));
+}
+
+void MasterLimiter::processChunk(juce::AudioBuffer<float>& buffer, int startSample, int numSamples) noexcept
+{
+    if (! enabled)
+    {
+        if (lookahead)
+            delay(buffer, startSample, numSamples);
+
+        return;
+    }
+
+    auto channelsToProcess = juce::jmin(numChannels, buffer.getNumChannels());
+    auto peak = 0.0f;
+
+    for (int ch = 0; ch < channelsToProcess; ++ch)
+        peak = juce::jmax(peak, buffer.getMagnitude(ch, startSample, numSamples));
+
+    auto underThreshold = peak <= threshold;
+
+    if (! lookahead)
+    {
+        if (peak <= kneeStart && gain >= 1.0f)
+            return;
+
+        computeTargetGains(buffer, startSample, numSamples, true);
+
+        // Instant attack, one-pole release
+        auto* gains = scratch.getWritePointer(1);
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            auto target = gains[i];
+            gain = target < gain ? target : gain + releaseCoefficient * (target - gain);
+            gains[i] = gain;
+        }
+
+        if (gain > 0.9999f)
+            gain = 1.0f;
+
+        applyGains(buffer, startSample, numSamples);
+        return;
+    }
+
+    samplesUnderThreshold = underThreshold ? samplesUnderThreshold + numSamples : 0;
+
+    // Once the whole lookahead window is quiet and the gain has recovered, just delay
+    if (underThreshold && idle)
+    {
+        sampleIndex += numSamples;
+        delay(buffer, startSample, numSamples);
+        return;
+    }
+
+    idle = false;
+
+    if (underThreshold)
+        juce::FloatVectorOperations::fill(scratch.getWritePointer(1), 1.0f, numSamples);
+    else
+        computeTargetGains(buffer, startSample, numSamples, false);
+
+    auto* gains = scratch.getWritePointer(1);
+    const auto window = (juce::int64) lookaheadSamples + 1;
+    const auto capacity = (int) minimumValues.size();
+
+    for (int i = 0; i < numSamples; ++i, ++sampleIndex)
+    {
+        auto target = gains[i];
+
+        // Sliding minimum: a queue of increasing values, oldest first
+        while (minimumSize > 0 && minimumValues[(size_t) ((minimumFront + minimumSize - 1) % capacity)] >= target)
+            --minimumSize;
+
+        auto back = (minimumFront + minimumSize) % capacity;
+        minimumIndices[(size_t) back] = sampleIndex;
+        minimumValues[(size_t) back] = target;
+        ++minimumSize;
+
+        if (minimumIndices[(size_t) minimumFront] <= sampleIndex - window)
+        {
+            minimumFront = (minimumFront + 1) % capacity;
+            --minimumSize;
+        }
+
+        auto held = minimumValues[(size_t) minimumFront];
+
+        // Averaging the held minimum over the lookahead ramps the gain down just in time for the peak
+        averageSum += held - averageHistory[(size_t) averagePosition];
+        averageHistory[(size_t) averagePosition] = held;
+        averagePosition = averagePosition + 1 == lookaheadSamples ? 0 : averagePosition + 1;
+
+        auto smoothed = juce::jmin(1.0f, (float) (averageSum / lookaheadSamples));
+        gain = smoothed < gain ? smoothed : gain + releaseCoefficient * (smoothed - gain);
+        gains[i] = gain;
+    }
+
+    delay(buffer, startSample, numSamples);
+    applyGains(buffer, startSample, numSamples);
+
+    if (gain > 0.9999f && samplesUnderThreshold > 2 * lookaheadSamples)
+    {
+        gain = 1.0f;
+        resetLookaheadState();
+    }
+}
+
+void MasterLimiter::computeTargetGains(const juce::AudioBuffer<float>& buffer, int startSample, int numSamples, bool softKnee) noexcept
+{
+    auto* envelope = scratch.getWritePointer(0);
+    auto* targets = scratch.getWritePointer(1);
+    auto channelsToProcess = juce::jmin(numChannels, buffer.getNumChannels());
+
+    // Peak across channels, floored where limiting starts so the target gain never exceeds 1
+    juce::FloatVectorOperations::abs(envelope, buffer.getReadPointer(0, startSample), numSamples);
+
+    for (int ch = 1; ch < channelsToProcess; ++ch)
+    {
+        juce::FloatVectorOperations::abs(targets, buffer.getReadPointer(ch, startSample), numSamples);
+        juce::FloatVectorOperations::max(envelope, envelope, targets, numSamples);
+    }
+
+    juce::FloatVectorOperations::max(envelope, envelope, softKnee ? kneeStart : threshold, numSamples);
+
+    // No branches or dependencies, so the compiler vectorises these too
+    if (! softKnee)
+    {
+        for (int i = 0; i < numSamples; ++i)
+            targets[i] = threshold / envelope[i];
+
+        return;
+    }
+
+    // Above the knee the output follows a tanh from kneeStart up towards the threshold.
+    // The Pade tanh is accurate to 1e-4 up to 5 and the curve is flat beyond it
+    const auto kneeWidth = threshold - kneeStart;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        auto excess = juce::jmin(5.0f, (envelope[i] - kneeStart) / kneeWidth);
+        targets[i] = (kneeStart + kneeWidth * juce::dsp::FastMathApproximations::tanh(excess)) / envelope[i];
+    }
+}
+
+void MasterLimiter::applyGains(juce::AudioBuffer<float>& buffer, int startSample, int numSamples) noexcept
+{
+    auto* gains = scratch.getReadPointer(1);
+
+    for (int ch = 0; ch < juce::jmin(numChannels, buffer.getNumChannels()); ++ch)
+        juce::FloatVectorOperations::multiply(buffer.getWritePointer(ch, startSample), gains, numSamples);
+}
+
+void MasterLimiter::delay(juce::AudioBuffer<float>& buffer, int startSample, int numSamples) noexcept
+{
+    auto channelsToProcess = juce::jmin(numChannels, buffer.getNumChannels());
+    auto position = delayPosition;
+
+    for (int ch = 0; ch < channelsToProcess; ++ch)
+    {
+        auto* samples = buffer.getWritePointer(ch, startSample);
+        auto* line = delayBuffer.getWritePointer(ch);
+        position = delayPosition;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            auto delayed = line[position];
+            line[position] = samples[i];
+            samples[i] = delayed;
+            position = position + 1 == lookaheadSamples ? 0 : position + 1;
+        }
+    }
+
+    delayPosition = position;
+}
@@ -0,0 +1,83 @@
+/*
+  ==============================================================================
+
+    MasterLimiter.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Peak limiter for the master bus, run after the effects chain.
+
+    Without lookahead the gain drops instantly, following a tanh knee that
+    starts kneeDecibels under the threshold and only approaches the threshold
+    itself, so peaks are rounded off rather than flattened into hard clips.
+    With lookahead the output is delayed by getLatencySamples(), and the gain
+    ramps down over that time so it has reached the right level by the time a
+    peak comes out. Either way it recovers over the release time.
+
+    While the signal stays under the threshold and the gain has fully
+    recovered, process() only measures the block's peak (and runs the delay).
+*/
+class MasterLimiter
+{
+public:
+    static constexpr double lookaheadSeconds = 0.0015;
+    static constexpr float kneeDecibels = 3.0f;
+
+    void prepare(double sampleRate, int numChannels, int maximumBlockSize);
+    void reset() noexcept;
+
+    /** The output is delayed whenever lookahead is on, even with the limiter
+        disabled, so the latency doesn't change with its parameters.
+        Not on the audio thread.
+    */
+    void setLookahead(bool shouldLookAhead);
+    bool isLookingAhead() const noexcept        { return lookahead; }
+    int getLatencySamples() const noexcept      { return lookahead ? lookaheadSamples : 0; }
+
+    /** Cheap to call every block. */
+    void setParameters(bool shouldBeEnabled, float thresholdDecibels, float releaseMs) noexcept;
+
+    void process(juce::AudioBuffer<float>& buffer, int startSample, int numSamples) noexcept;
+
+private:
+    void processChunk(juce::AudioBuffer<float>& buffer, int startSample, int numSamples) noexcept;
+    void computeTargetGains(const juce::AudioBuffer<float>& buffer, int startSample, int numSamples, bool softKnee) noexcept;
+    void applyGains(juce::AudioBuffer<float>& buffer, int startSample, int numSamples) noexcept;
+    void delay(juce::AudioBuffer<float>& buffer, int startSample, int numSamples) noexcept;
+    void resetLookaheadState() noexcept;
+
+    double sampleRate = 44100.0;
+    int numChannels = 2, chunkSize = 512;
+
+    bool enabled = false, lookahead = false;
+    float threshold = 1.0f, kneeStart = 1.0f, releaseCoefficient = 0.001f;
+    float gain = 1.0f;
+
+    // Per-sample scratch: the peak envelope, then the target gains, then the applied gains
+    juce::AudioBuffer<float> scratch;
+
+    // Lookahead: the delayed audio, a sliding minimum of the target gains over
+    // lookaheadSamples + 1 samples, and a moving average of that minimum over lookaheadSamples
+    int lookaheadSamples = 0;
+    juce::AudioBuffer<float> delayBuffer;
+    int delayPosition = 0;
+
+    std::vector<juce::int64> minimumIndices;
+    std::vector<float> minimumValues;
+    int minimumFront = 0, minimumSize = 0;
+    juce::int64 sampleIndex = 0;
+
+    std::vector<float> averageHistory;
+    int averagePosition = 0;
+    double averageSum = 0.0;
+
+    juce::int64 samplesUnderThreshold = 0;
+    bool idle = true;
+};
@@ -0,0 +1,668 @@
+/*
+  ==============================================================================
+
+    OfflineRenderer.cpp
+
+  ==============================================================================
+*/
+
+#include "OfflineRenderer.h"
+#include "PluginProcessor.h"
+#include "RealtimeSafetyChecker.h"
+#include <iostream>
+
+#if JUCE_LINUX
+ #include <unistd.h>
+#elif JUCE_MAC
+ #include <mach/mach.h>
+#endif
+
+namespace
+{
+    void setParameter (MysynthpracAudioProcessor& processor, const juce::String& parameterID, float value)
+    {
+        if (auto* param = processor.state.getParameter (parameterID))
+            param->setValueNotifyingHost (param->convertTo0to1 (value));
+    }
+
+    void addNote (juce::MidiBuffer& midi, int channel, int note, float velocity, int onSample, int offSample)
+    {
+        midi.addEvent (juce::MidiMessage::noteOn (channel, note, velocity), onSample);
+        midi.addEvent (juce::MidiMessage::noteOff (channel, note), offSample);
+    }
+
+    // Timings use the best of a few fresh renders, so one scheduling hiccup isn't reported as a regression
+    constexpr int timingRuns = 3;
+
+    juce::int64 getResidentBytes()
+    {
+       #if JUCE_LINUX
+        // statm's second field is the resident set, in pages
+        auto fields = juce::StringArray::fromTokens (juce::File ("/proc/self/statm").loadFileAsString(), true);
+        return fields[1].getLargeIntValue() * (juce::int64) sysconf (_SC_PAGESIZE);
+       #elif JUCE_MAC
+        mach_task_basic_info info;
+        mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+
+        if (task_info (mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t) &info, &count) != KERN_SUCCESS)
+            return -1;
+
+        return (juce::int64) info.resident_size;
+       #else
+        return -1;
+       #endif
+    }
+
+    double secondsSince (juce::int64 startTicks)
+    {
+        return juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - startTicks);
+    }
+
+    // Nearest-rank percentile of sorted values
+    double percentile (const std::vector<double>& sorted, double p)
+    {
+        if (sorted.empty())
+            return 0.0;
+
+        auto rank = (int) std::ceil (p * (double) sorted.size()) - 1;
+        return sorted[(size_t) juce::jlimit (0, (int) sorted.size() - 1, rank)];
+    }
+}
+
+//==============================================================================
+std::vector<RenderScenario> OfflineRenderer::createStandardScenarios()
+{
+    std::vector<RenderScenario> scenarios;
+
+    auto makeScenario = [] (const juce::String& name, double seconds)
+    {
+        RenderScenario scenario;
+        scenario.name = name;
+        scenario.lengthInSamples = (int) (seconds * scenario.sampleRate);
+        return scenario;
+    };
+
+    {
+        auto scenario = makeScenario ("single_note", 1.5);
+        addNote (scenario.midi, 1, 60, 0.8f, 0, 48000);
+        scenarios.push_back (std::move (scenario));
+    }
+
+    {
+        auto scenario = makeScenario ("chord", 1.5);
+        for (auto note : { 60, 64, 67, 71 })
+            addNote (scenario.midi, 1, note, 0.7f, 0, 48000);
+
+        scenario.setup = [] (MysynthpracAudioProcessor& p) { setParameter (p, "wavetype", (float) SineWaveVoice::TRIANGLE); };
+        scenarios.push_back (std::move (scenario));
+    }
+
+    {
+        auto scenario = makeScenario ("fast_repeats", 1.2);
+        for (int onset = 0; onset < 48000; onset += 960)
+            addNote (scenario.midi, 1, 72, 0.9f, onset, onset + 480);
+
+        scenario.setup = [] (MysynthpracAudioProcessor& p) { setParameter (p, "wavetype", (float) SineWaveVoice::SQUARE); };
+        scenarios.push_back (std::move (scenario));
+    }
+
+    {
+        // More held notes than the 127-voice pool, so the later ones have to steal
+        auto scenario = makeScenario ("polyphony_stealing", 1.5);
+        for (int i = 0; i < 140; ++i)
+            addNote (scenario.midi, 1 + i % 4, 24 + i % 96, 0.5f, i * 64, 48000);
+
+        scenarios.push_back (std::move (scenario));
+    }
+
+    {
+        auto scenario = makeScenario ("filter_sweep", 2.5);
+        for (auto note : { 48, 55, 60 })
+            addNote (scenario.midi, 1, note, 0.8f, 0, 96000);
+
+        scenario.setup = [] (MysynthpracAudioProcessor& p)
+        {
+            setParameter (p, "wavetype", (float) SineWaveVoice::SAW);
+            setParameter (p, "ladderbutton", 1.0f);
+            setParameter (p, "laddermode", 3.0f);
+            setParameter (p, "ladderresonance", 0.7f);
+            setParameter (p, "ladderdrive", 2.0f);
+        };
+
+        auto length = scenario.lengthInSamples;
+        scenario.automation = [length] (MysynthpracAudioProcessor& p, int position)
+        {
+            setParameter (p, "laddercutoff", 100.0f * std::pow (80.0f, (float) position / (float) length));
+        };
+
+        scenarios.push_back (std::move (scenario));
+    }
+
+    return scenarios;
+}
+
+//==============================================================================
+OfflineRenderer::Result OfflineRenderer::render (MysynthpracAudioProcessor& processor, const RenderScenario& scenario)
+{
+    processor.setRateAndBufferSizeDetails (scenario.sampleRate, scenario.blockSize);
+
+    if (scenario.setup)
+        scenario.setup (processor);
+
+    processor.prepareToPlay (scenario.sampleRate, scenario.blockSize);
+
+    auto numChannels = processor.getTotalNumOutputChannels();
+
+    Result result;
+    result.audio.setSize (numChannels, scenario.lengthInSamples);
+
+    juce::AudioBuffer<float> blockBuffer (numChannels, scenario.blockSize);
+    juce::MidiBuffer blockMidi;
+
+    auto startTicks = juce::Time::getHighResolutionTicks();
+
+    for (int position = 0; position < scenario.lengthInSamples; position += scenario.blockSize)
+    {
+        auto numSamples = juce::jmin (scenario.blockSize, scenario.lengthInSamples - position);
+
+        if (scenario.automation)
+            scenario.automation (processor, position);
+
+        blockMidi.clear();
+        blockMidi.addEvents (scenario.midi, position, numSamples, -position);
+
+        juce::AudioBuffer<float> block (blockBuffer.getArrayOfWritePointers(), numChannels, numSamples);
+        block.clear();
+        processor.processBlock (block, blockMidi);
+
+        for (int ch = 0; ch < numChannels; ++ch)
+            result.audio.copyFrom (ch, position, block, ch, 0, numSamples);
+    }
+
+    result.renderSeconds = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - startTicks);
+    processor.releaseResources();
+
+    return result;
+}
+
+OfflineRenderer::Result OfflineRenderer::render (const RenderScenario& scenario)
+{
+    MysynthpracAudioProcessor processor;
+    return render (processor, scenario);
+}
+
+OfflineRenderer::Comparison OfflineRenderer::compare (const juce::AudioBuffer<float>& reference, const juce::AudioBuffer<float>& actual, float tolerance)
+{
+    Comparison comparison;
+    comparison.lengthsMatch = reference.getNumChannels() == actual.getNumChannels()
+                                && reference.getNumSamples() == actual.getNumSamples();
+
+    if (! comparison.lengthsMatch)
+        return comparison;
+
+    double sumOfSquares = 0.0;
+
+    for (int ch = 0; ch < reference.getNumChannels(); ++ch)
+    {
+        auto* expected = reference.getReadPointer (ch);
+        auto* rendered = actual.getReadPointer (ch);
+
+        for (int i = 0; i < reference.getNumSamples(); ++i)
+        {
+            auto difference = std::abs (expected[i] - rendered[i]);
+            comparison.maxAbsDifference = juce::jmax (comparison.maxAbsDifference, difference);
+            sumOfSquares += (double) difference * difference;
+        }
+    }
+
+    auto numValues = juce::jmax (1, reference.getNumChannels() * reference.getNumSamples());
+    comparison.rmsDifference = (float) std::sqrt (sumOfSquares / numValues);
+    comparison.withinTolerance = comparison.maxAbsDifference <= tolerance;
+
+    return comparison;
+}
+
+//==============================================================================
+bool OfflineRenderer::writeWav (const juce::File& file, const juce::AudioBuffer<float>& audio, double sampleRate, int bitsPerSample)
+{
+    file.deleteFile();
+    auto stream = file.createOutputStream();
+
+    if (stream == nullptr)
+        return false;
+
+    juce::WavAudioFormat wav;
+    std::unique_ptr<juce::AudioFormatWriter> writer (wav.createWriterFor (stream.get(), sampleRate, (unsigned int) audio.getNumChannels(),
+                                                                          bitsPerSample, juce::StringPairArray(), 0));
+
+    if (writer == nullptr)
+        return false;
+
+    stream.release();
+    return writer->writeFromAudioSampleBuffer (audio, 0, audio.getNumSamples());
+}
+
+bool OfflineRenderer::readWav (const juce::File& file, juce::AudioBuffer<float>& audio)
+{
+    juce::AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+
+    std::unique_ptr<juce::AudioFormatReader> reader (formatManager.createReaderFor (file));
+
+    if (reader == nullptr)
+        return false;
+
+    audio.setSize ((int) reader->numChannels, (int) reader->lengthInSamples);
+    return reader->read (&audio, 0, audio.getNumSamples(), 0, true, true);
+}
+
+//==============================================================================
+std::vector<OfflineRenderer::ScenarioReport> OfflineRenderer::runRegressionSuite (const juce::File& referenceDirectory,
+                                                                                 bool updateReferences,
+                                                                                 float tolerance,
+                                                                                 double allowedSlowdown)
+{
+    referenceDirectory.createDirectory();
+
+    auto baselineFile = referenceDirectory.getChildFile ("baselines.json");
+    auto baselines = juce::JSON::parse (baselineFile);
+    auto* newBaselines = new juce::DynamicObject();
+    juce::var newBaselineData (newBaselines);
+
+    std::vector<ScenarioReport> reports;
+
+    for (auto& scenario : createStandardScenarios())
+    {
+        ScenarioReport report;
+        report.name = scenario.name;
+
+        auto result = render (scenario);
+        report.renderSeconds = result.renderSeconds;
+
+        for (int i = 1; i < timingRuns; ++i)
+            report.renderSeconds = juce::jmin (report.renderSeconds, render (scenario).renderSeconds);
+
+        auto referenceFile = referenceDirectory.getChildFile (scenario.name + ".wav");
+
+        if (updateReferences)
+        {
+            report.hasReference = writeWav (referenceFile, result.audio, scenario.sampleRate);
+            report.comparison = compare (result.audio, result.audio, tolerance);
+            report.baselineSeconds = report.renderSeconds;
+            newBaselines->setProperty (scenario.name, report.renderSeconds);
+        }
+        else
+        {
+            juce::AudioBuffer<float> reference;
+            report.hasReference = readWav (referenceFile, reference);
+
+            if (report.hasReference)
+                report.comparison = compare (reference, result.audio, tolerance);
+
+            report.baselineSeconds = (double) baselines.getProperty (scenario.name, 0.0);
+            report.slowerThanBaseline = report.baselineSeconds > 0.0
+                                          && report.renderSeconds > report.baselineSeconds * allowedSlowdown;
+        }
+
+        reports.push_back (report);
+    }
+
+    if (updateReferences)
+        baselineFile.replaceWithText (juce::JSON::toString (newBaselineData));
+
+    return reports;
+}
+
+bool OfflineRenderer::allPassed (const std::vector<ScenarioReport>& reports)
+{
+    // A scenario with no reference yet is skipped, not failed; describe() says so
+    for (auto& report : reports)
+        if (report.hasReference && (! report.comparison.withinTolerance || report.slowerThanBaseline))
+            return false;
+
+    return ! reports.empty();
+}
+
+juce::String OfflineRenderer::describe (const std::vector<ScenarioReport>& reports)
+{
+    juce::String text;
+    auto numSkipped = 0;
+
+    for (auto& report : reports)
+    {
+        text << report.name << ": ";
+
+        if (! report.hasReference)
+        {
+            text << "skipped, no reference " << report.name << ".wav";
+            ++numSkipped;
+        }
+        else if (! report.comparison.lengthsMatch)
+            text << "length mismatch";
+        else
+            text << (report.comparison.withinTolerance ? "match" : "MISMATCH")
+                 << " (max diff " << juce::String (report.comparison.maxAbsDifference, 6)
+                 << ", rms " << juce::String (report.comparison.rmsDifference, 6) << ")";
+
+        text << ", " << juce::String (report.renderSeconds * 1000.0, 2) << " ms";
+
+        if (report.baselineSeconds > 0.0)
+            text << " (baseline " << juce::String (report.baselineSeconds * 1000.0, 2) << " ms"
+                 << (report.slowerThanBaseline ? ", SLOWER" : "") << ")";
+
+        text << "\n";
+    }
+
+    if (numSkipped > 0)
+        text << numSkipped << " of " << (int) reports.size() << " scenarios skipped for lack of a reference;"
+             << " run --regression-test=update to record them\n";
+
+    return text;
+}
+
+int OfflineRenderer::runRegressionFromCommandLine (const juce::String& commandLine)
+{
+    auto referenceDirectory = juce::File::getCurrentWorkingDirectory().getChildFile ("Regression");
+    auto update = false;
+
+    for (auto& argument : juce::StringArray::fromTokens (commandLine, true))
+    {
+        if (argument == "--regression-test=update")
+            update = true;
+        else if (argument.startsWith ("--reference-dir="))
+            referenceDirectory = juce::File::getCurrentWorkingDirectory()
+                                     .getChildFile (argument.fromFirstOccurrenceOf ("=", false, false).unquoted());
+    }
+
+    auto reports = runRegressionSuite (referenceDirectory, update);
+    std::cout << describe (reports) << (update ? "references written to " : "references in ")
+              << referenceDirectory.getFullPathName() << "\n" << std::flush;
+
+    return allPassed (reports) ? 0 : 1;
+}
+
+//==============================================================================
+OfflineRenderer::InstantiationReport OfflineRenderer::measureInstantiation (int numInstances)
+{
+    InstantiationReport report;
+    report.numInstances = juce::jmax (1, numInstances);
+
+    // A typical saved state to restore into every instance
+    juce::MemoryBlock savedState;
+    {
+        MysynthpracAudioProcessor source;
+        source.getStateInformation (savedState);
+    }
+
+    std::vector<std::unique_ptr<MysynthpracAudioProcessor>> instances;
+    instances.reserve ((size_t) report.numInstances);
+
+    auto bytesBefore = getResidentBytes();
+    auto startTicks = juce::Time::getHighResolutionTicks();
+
+    for (int i = 0; i < report.numInstances; ++i)
+        instances.push_back (std::make_unique<MysynthpracAudioProcessor>());
+
+    report.constructSeconds = secondsSince (startTicks) / report.numInstances;
+
+    auto bytesAfter = getResidentBytes();
+
+    if (bytesBefore >= 0 && bytesAfter >= 0)
+        report.bytesPerInstance = (bytesAfter - bytesBefore) / report.numInstances;
+
+    startTicks = juce::Time::getHighResolutionTicks();
+
+    for (auto& instance : instances)
+        instance->setStateInformation (savedState.getData(), (int) savedState.getSize());
+
+    report.restoreSeconds = secondsSince (startTicks) / report.numInstances;
+    startTicks = juce::Time::getHighResolutionTicks();
+
+    for (auto& instance : instances)
+    {
+        instance->setRateAndBufferSizeDetails (48000.0, 512);
+        instance->prepareToPlay (48000.0, 512);
+    }
+
+    report.prepareSeconds = secondsSince (startTicks) / report.numInstances;
+
+    return report;
+}
+
+juce::String OfflineRenderer::describe (const InstantiationReport& report)
+{
+    juce::String text;
+    text << report.numInstances << " instances: construct " << juce::String (report.constructSeconds * 1000.0, 3) << " ms"
+         << ", restore state " << juce::String (report.restoreSeconds * 1000.0, 3) << " ms"
+         << ", first prepare " << juce::String (report.prepareSeconds * 1000.0, 3) << " ms each";
+
+    if (report.bytesPerInstance >= 0)
+        text << ", " << juce::String ((double) report.bytesPerInstance / 1024.0, 1) << " KB resident each";
+
+    return text << "\n";
+}
+
+//==============================================================================
+std::vector<RenderScenario> OfflineRenderer::createStressScenarios()
+{
+    std::vector<RenderScenario> scenarios;
+
+    auto makeScenario = [] (const juce::String& name, double seconds)
+    {
+        RenderScenario scenario;
+        scenario.name = name;
+        scenario.lengthInSamples = (int) (seconds * scenario.sampleRate);
+        return scenario;
+    };
+
+    {
+        // 5000 short notes a second on random keys and channels
+        auto scenario = makeScenario ("note_storm", 4.0);
+        juce::Random random (1);
+
+        for (int onset = 0; onset < scenario.lengthInSamples; onset += random.nextInt ({ 1, 19 }))
+            addNote (scenario.midi, 1 + random.nextInt (16), random.nextInt (128), 0.1f + 0.9f * random.nextFloat(),
+                     onset, onset + random.nextInt ({ 16, 2400 }));
+
+        scenarios.push_back (std::move (scenario));
+    }
+
+    {
+        // All 128 keys, one more than the voice pool, struck together again and again
+        auto scenario = makeScenario ("all_keys", 3.0);
+
+        for (int onset = 0; onset < 120000; onset += 12000)
+            for (int note = 0; note < 128; ++note)
+                addNote (scenario.midi, 1, note, 1.0f, onset, onset + 11000);
+
+        scenario.setup = [] (MysynthpracAudioProcessor& p) { setParameter (p, "wavetype", (float) SineWaveVoice::SAW); };
+        scenarios.push_back (std::move (scenario));
+    }
+
+    {
+        // Long releases keep every voice busy, so each new note has to steal one
+        auto scenario = makeScenario ("constant_stealing", 4.0);
+        juce::Random random (2);
+
+        for (int i = 0; i < 128; ++i)
+            scenario.midi.addEvent (juce::MidiMessage::noteOn (1, i, 0.8f), 0);
+
+        for (int onset = 64; onset < scenario.lengthInSamples - 48000; onset += 64)
+            addNote (scenario.midi, 1 + random.nextInt (4), random.nextInt (128), 0.8f, onset, onset + 32);
+
+        scenario.setup = [] (MysynthpracAudioProcessor& p)
+        {
+            setParameter (p, "release", 3.0f);
+            setParameter (p, "ladderbutton", 1.0f);
+        };
+
+        scenarios.push_back (std::move (scenario));
+    }
+
+    {
+        // Every parameter jumps to a new random value on every block, under a dense chord
+        auto scenario = makeScenario ("automation", 3.0);
+
+        for (int note = 36; note < 96; note += 3)
+            addNote (scenario.midi, 1 + note % 16, note, 0.7f, 0, scenario.lengthInSamples - 24000);
+
+        auto random = std::make_shared<juce::Random> (3);
+        scenario.automation = [random] (MysynthpracAudioProcessor& p, int)
+        {
+            for (auto* param : p.getParameters())
+                param->setValueNotifyingHost (random->nextFloat());
+        };
+
+        scenarios.push_back (std::move (scenario));
+    }
+
+    return scenarios;
+}
+
+OfflineRenderer::StressReport OfflineRenderer::runStressTest (const RenderScenario& scenario)
+{
+    MysynthpracAudioProcessor processor;
+    processor.setRateAndBufferSizeDetails (scenario.sampleRate, scenario.blockSize);
+
+    if (scenario.setup)
+        scenario.setup (processor);
+
+    processor.prepareToPlay (scenario.sampleRate, scenario.blockSize);
+
+    StressReport report;
+    report.name = scenario.name;
+    report.deadlineMs = 1000.0 * scenario.blockSize / scenario.sampleRate;
+
+    auto numChannels = processor.getTotalNumOutputChannels();
+    juce::AudioBuffer<float> blockBuffer (numChannels, scenario.blockSize);
+    juce::MidiBuffer blockMidi;
+    std::vector<double> blockMs;
+    blockMs.reserve ((size_t) (scenario.lengthInSamples / scenario.blockSize + 1));
+
+    for (int position = 0; position < scenario.lengthInSamples; position += scenario.blockSize)
+    {
+        auto numSamples = juce::jmin (scenario.blockSize, scenario.lengthInSamples - position);
+
+        if (scenario.automation)
+            scenario.automation (processor, position);
+
+        blockMidi.clear();
+        blockMidi.addEvents (scenario.midi, position, numSamples, -position);
+
+        juce::AudioBuffer<float> block (blockBuffer.getArrayOfWritePointers(), numChannels, numSamples);
+        block.clear();
+
+        auto startTicks = juce::Time::getHighResolutionTicks();
+        processor.processBlock (block, blockMidi);
+        blockMs.push_back (secondsSince (startTicks) * 1000.0);
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            auto* samples = block.getReadPointer (ch);
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                if (! std::isfinite (samples[i]))
+                    ++report.nonFiniteSamples;
+                else if (std::fpclassify (samples[i]) == FP_SUBNORMAL)
+                    ++report.denormalSamples;
+            }
+        }
+    }
+
+    processor.releaseResources();
+
+    report.numBlocks = (int) blockMs.size();
+
+    for (auto ms : blockMs)
+        if (ms > report.deadlineMs)
+            ++report.blocksOverDeadline;
+
+    std::sort (blockMs.begin(), blockMs.end());
+    report.p50Ms = percentile (blockMs, 0.5);
+    report.p99Ms = percentile (blockMs, 0.99);
+    report.p999Ms = percentile (blockMs, 0.999);
+    report.maxMs = blockMs.empty() ? 0.0 : blockMs.back();
+
+    return report;
+}
+
+std::vector<OfflineRenderer::StressReport> OfflineRenderer::runStressSuite()
+{
+    std::vector<StressReport> reports;
+
+    for (auto& scenario : createStressScenarios())
+        reports.push_back (runStressTest (scenario));
+
+    return reports;
+}
+
+bool OfflineRenderer::allPassed (const std::vector<StressReport>& reports)
+{
+    for (auto& report : reports)
+        if (report.nonFiniteSamples > 0 || report.denormalSamples > 0)
+            return false;
+
+    return ! reports.empty();
+}
+
+juce::String OfflineRenderer::describe (const std::vector<StressReport>& reports)
+{
+    juce::String text;
+
+    for (auto& report : reports)
+    {
+        text << report.name << ": " << report.numBlocks << " blocks"
+             << ", p50 " << juce::String (report.p50Ms, 3) << " ms"
+             << ", p99 " << juce::String (report.p99Ms, 3) << " ms"
+             << ", p99.9 " << juce::String (report.p999Ms, 3) << " ms"
+             << ", max " << juce::String (report.maxMs, 3) << " ms"
+             << " (deadline " << juce::String (report.deadlineMs, 3) << " ms, " << report.blocksOverDeadline << " over)";
+
+        if (report.nonFiniteSamples > 0)
+            text << ", " << report.nonFiniteSamples << " NON-FINITE samples";
+
+        if (report.denormalSamples > 0)
+            text << ", " << report.denormalSamples << " DENORMAL samples";
+
+        text << "\n";
+    }
+
+    return text;
+}
+
+//==============================================================================
+int OfflineRenderer::runRealtimeCheck()
+{
+   #if MYSYNTH_REALTIME_CHECKS
+    RealtimeSafetyChecker::resetViolations();
+    RealtimeSafetyChecker::setAbortOnViolation (true);
+
+    for (auto renderAhead : { false, true })
+    {
+        for (auto scenario : createStressScenarios())
+        {
+            // The render thread runs the voices inside its own real-time section
+            if (renderAhead)
+            {
+                scenario.name << " (render ahead)";
+                scenario.setup = [setup = scenario.setup] (MysynthpracAudioProcessor& processor)
+                {
+                    if (setup)
+                        setup (processor);
+
+                    processor.setAnticipativeRendering (true);
+                };
+            }
+
+            std::cout << scenario.name << ": " << runStressTest (scenario).numBlocks << " blocks clean\n" << std::flush;
+        }
+    }
+
+    RealtimeSafetyChecker::setAbortOnViolation (false);
+    return RealtimeSafetyChecker::getNumViolations() == 0 ? 0 : 1;
+   #else
+    std::cout << "Built without MYSYNTH_REALTIME_CHECKS, so there is nothing to check with\n" << std::flush;
+    return 2;
+   #endif
+}
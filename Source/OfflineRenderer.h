@@ -0,0 +1,142 @@
+/*
+  ==============================================================================
+
+    OfflineRenderer.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+class MysynthpracAudioProcessor;
+
+//==============================================================================
+/** A fixed MIDI performance, plus optional parameter setup and automation, rendered offline. */
+struct RenderScenario
+{
+    juce::String name;
+    double sampleRate = 48000.0;
+    int blockSize = 256;
+    int lengthInSamples = 0;
+
+    /** Events at absolute sample positions from the start of the render. */
+    juce::MidiBuffer midi;
+
+    std::function<void (MysynthpracAudioProcessor&)> setup;
+
+    /** Called before each block with the position of its first sample. */
+    std::function<void (MysynthpracAudioProcessor&, int)> automation;
+};
+
+//==============================================================================
+/**
+    Renders scenarios through a MysynthpracAudioProcessor and compares them with
+    stored reference renders and render-time baselines.
+
+    runRegressionSuite() is the whole golden-render check: each standard
+    scenario is compared against <dir>/<name>.wav within a tolerance, and its
+    render time against <dir>/baselines.json. The standalone app runs it with
+    --regression-test, against the Regression directory checked in at the top
+    of the repository.
+*/
+class OfflineRenderer
+{
+public:
+    struct Result
+    {
+        juce::AudioBuffer<float> audio;
+        double renderSeconds = 0.0;
+    };
+
+    struct Comparison
+    {
+        float maxAbsDifference = 0.0f;
+        float rmsDifference = 0.0f;
+        bool lengthsMatch = false;
+        bool withinTolerance = false;
+    };
+
+    struct ScenarioReport
+    {
+        juce::String name;
+        Comparison comparison;
+        double renderSeconds = 0.0, baselineSeconds = 0.0;
+        bool hasReference = false, slowerThanBaseline = false;
+    };
+
+    /** Single notes, chords, fast repeats, polyphony beyond the voice pool and a filter sweep. */
+    static std::vector<RenderScenario> createStandardScenarios();
+
+    static Result render (MysynthpracAudioProcessor& processor, const RenderScenario& scenario);
+    static Result render (const RenderScenario& scenario);
+
+    static Comparison compare (const juce::AudioBuffer<float>& reference, const juce::AudioBuffer<float>& actual, float tolerance);
+
+    /** 32 bits is float, so references are stored exactly. */
+    static bool writeWav (const juce::File& file, const juce::AudioBuffer<float>& audio, double sampleRate, int bitsPerSample = 32);
+    static bool readWav (const juce::File& file, juce::AudioBuffer<float>& audio);
+
+    /** With updateReferences set, the current renders and timings become the new references. */
+    static std::vector<ScenarioReport> runRegressionSuite (const juce::File& referenceDirectory,
+                                                          bool updateReferences,
+                                                          float tolerance = 1.0e-4f,
+                                                          double allowedSlowdown = 1.25);
+
+    static bool allPassed (const std::vector<ScenarioReport>& reports);
+    static juce::String describe (const std::vector<ScenarioReport>& reports);
+
+    /** --regression-test checks against the references, and --regression-test=update
+        rewrites them. --reference-dir=<dir> overrides the default, Regression in the
+        working directory. Returns the process exit code: 0 if no scenario failed. One
+        without a reference is reported as skipped rather than failed.
+    */
+    static int runRegressionFromCommandLine (const juce::String& commandLine);
+
+    struct InstantiationReport
+    {
+        int numInstances = 0;
+        double constructSeconds = 0.0;      // per instance
+        double restoreSeconds = 0.0;        // setStateInformation, per instance
+        double prepareSeconds = 0.0;        // first prepareToPlay, per instance
+        juce::int64 bytesPerInstance = -1;  // resident memory after construction, or -1 if unknown
+    };
+
+    /** Creates numInstances processors side by side, as a host does when scanning or
+        loading a session, and times each stage. Memory is measured on Linux and macOS.
+    */
+    static InstantiationReport measureInstantiation (int numInstances = 100);
+    static juce::String describe (const InstantiationReport& report);
+
+    struct StressReport
+    {
+        juce::String name;
+        int numBlocks = 0;
+        double deadlineMs = 0.0;        // real-time length of one block
+        double p50Ms = 0.0, p99Ms = 0.0, p999Ms = 0.0, maxMs = 0.0;
+        int blocksOverDeadline = 0;
+        juce::int64 nonFiniteSamples = 0, denormalSamples = 0;
+    };
+
+    /** Adversarial input: note storms, every key at once beyond the voice pool, constant
+        voice stealing, and every parameter automated on every block.
+    */
+    static std::vector<RenderScenario> createStressScenarios();
+
+    /** Times every processBlock call on its own, and checks that all the output is finite
+        and free of denormals. The timings are spikes to look at, not a pass/fail check.
+    */
+    static StressReport runStressTest (const RenderScenario& scenario);
+    static std::vector<StressReport> runStressSuite();
+
+    /** True if every scenario's output stayed finite and denormal-free. */
+    static bool allPassed (const std::vector<StressReport>& reports);
+    static juce::String describe (const std::vector<StressReport>& reports);
+
+    /** Runs every stress scenario, with and without anticipative rendering, with the
+        RealtimeSafetyChecker set to abort at the first violation. Returns the process
+        exit code: 0 if nothing was flagged, non-zero if the build has no checker to run.
+    */
+    static int runRealtimeCheck();
+};
@@ -0,0 +1,460 @@
+/*
+  ==============================================================================
+
+    PartitionedConvolver.cpp
+
+  ==============================================================================
+*/
+
+#include "PartitionedConvolver.h"
+
+namespace
+{
+    constexpr int fftOrder = 8;
+    constexpr int fftSize = 1 << fftOrder;                                // two partitions, for overlap-save
+    constexpr int numBins = fftSize / 2 + 1;
+    constexpr int spectrumSize = numBins * 2;                             // interleaved re/im
+    constexpr int workSize = fftSize * 2;                                 // what the real-only FFT needs
+
+    static_assert(fftSize == 2 * PartitionedConvolver::partitionSize, "The FFT must cover two partitions");
+
+    void multiplyAccumulate(float* accumulator, const float* a, const float* b) noexcept
+    {
+        for (int i = 0; i < spectrumSize; i += 2)
+        {
+            const auto ar = a[i], ai = a[i + 1];
+            const auto br = b[i], bi = b[i + 1];
+
+            accumulator[i]     += ar * br - ai * bi;
+            accumulator[i + 1] += ar * bi + ai * br;
+        }
+    }
+}
+
+//==============================================================================
+class PartitionedConvolver::Engine  : public SharedResources::StreamingWorker::Client
+{
+public:
+    Engine(const juce::AudioBuffer<float>& ir, int numChannelsToUse, SharedResources::StreamingWorker& w)
+        : worker(w)
+    {
+        constexpr int B = partitionSize;
+
+        numPartitions = juce::jmax(1, (ir.getNumSamples() + B - 1) / B);
+        numSlots = numPartitions + headPartitions + 1;
+        numTailSlots = headPartitions + 1;
+        tailSlotResetFrame.resize((size_t) numTailSlots, -1);
+
+        std::vector<float> work((size_t) workSize);
+
+        for (int ch = 0; ch < numChannelsToUse; ++ch)
+        {
+            Channel c;
+            c.irSpectra.resize((size_t) (numPartitions * spectrumSize));
+            c.spectra.resize((size_t) (numSlots * spectrumSize));
+            c.inputFrame.resize((size_t) B);
+            c.outputFrame.resize((size_t) B);
+            c.history.resize((size_t) fftSize);
+            c.tailOutput.resize((size_t) (numTailSlots * B));
+            c.headWork.resize((size_t) workSize);
+            c.tailWork.resize((size_t) workSize);
+
+            // A mono IR feeds every channel
+            auto* irData = ir.getReadPointer(juce::jmin(ch, ir.getNumChannels() - 1));
+
+            for (int k = 0; k < numPartitions; ++k)
+            {
+                std::fill(work.begin(), work.end(), 0.0f);
+                auto start = k * B;
+                auto length = juce::jmin(B, ir.getNumSamples() - start);
+
+                if (length > 0)
+                    std::copy(irData + start, irData + start + length, work.begin());
+
+                fftAudio.performRealOnlyForwardTransform(work.data(), true);
+                std::copy(work.begin(), work.begin() + spectrumSize, c.irSpectra.begin() + k * spectrumSize);
+            }
+
+            channels.push_back(std::move(c));
+        }
+
+        worker.addClient(*this);
+    }
+
+    ~Engine() override
+    {
+        worker.removeClient(*this);
+    }
+
+    void restart() noexcept
+    {
+        for (auto& c : channels)
+        {
+            std::fill(c.inputFrame.begin(), c.inputFrame.end(), 0.0f);
+            std::fill(c.outputFrame.begin(), c.outputFrame.end(), 0.0f);
+            std::fill(c.history.begin(), c.history.end(), 0.0f);
+        }
+
+        fifoPosition = 0;
+
+        // Spectra older than this frame now count as silence, for both threads
+        resetFrame.store(frameIndex, std::memory_order_release);
+    }
+
+    void process(const juce::dsp::AudioBlock<float>& block, float wetLevel, std::atomic<int>& lateCounter) noexcept
+    {
+        auto numChannels = juce::jmin((int) block.getNumChannels(), (int) channels.size());
+        auto numSamples = (int) block.getNumSamples();
+        auto dryLevel = 1.0f - wetLevel;
+
+        for (int done = 0; done < numSamples;)
+        {
+            auto n = juce::jmin(partitionSize - fifoPosition, numSamples - done);
+
+            for (int ch = 0; ch < numChannels; ++ch)
+            {
+                auto& c = channels[(size_t) ch];
+                auto* samples = block.getChannelPointer((size_t) ch) + done;
+                auto* in = c.inputFrame.data() + fifoPosition;
+                auto* out = c.outputFrame.data() + fifoPosition;
+
+                for (int i = 0; i < n; ++i)
+                {
+                    in[i] = samples[i];
+                    samples[i] = samples[i] * dryLevel + out[i] * wetLevel;
+                }
+            }
+
+            fifoPosition += n;
+            done += n;
+
+            if (fifoPosition == partitionSize)
+            {
+                processFrame(lateCounter);
+                fifoPosition = 0;
+            }
+        }
+    }
+
+private:
+    struct Channel
+    {
+        std::vector<float> irSpectra;       // numPartitions spectra
+        std::vector<float> spectra;         // frequency-domain delay line of input frames, numSlots long
+        std::vector<float> inputFrame, outputFrame, history;
+        std::vector<float> tailOutput;      // numTailSlots time-domain frames written by the worker
+        std::vector<float> headWork, tailWork;
+    };
+
+    // Audio thread
+    void processFrame(std::atomic<int>& lateCounter) noexcept
+    {
+        constexpr int B = partitionSize;
+
+        const auto frame = frameIndex;
+        const auto oldest = resetFrame.load(std::memory_order_relaxed);
+        const auto slot = (int) (frame % numSlots);
+        const auto numHead = juce::jmin(headPartitions, numPartitions);
+
+        for (auto& c : channels)
+        {
+            std::copy(c.history.begin() + B, c.history.end(), c.history.begin());
+            std::copy(c.inputFrame.begin(), c.inputFrame.end(), c.history.begin() + B);
+
+            auto* work = c.headWork.data();
+            std::copy(c.history.begin(), c.history.end(), work);
+            std::fill(work + fftSize, work + workSize, 0.0f);
+            fftAudio.performRealOnlyForwardTransform(work, true);
+            std::copy(work, work + spectrumSize, c.spectra.begin() + slot * spectrumSize);
+
+            std::fill(work, work + workSize, 0.0f);
+
+            for (int k = 0; k < numHead && frame - k >= oldest; ++k)
+                multiplyAccumulate(work, c.spectra.data() + ((frame - k) % numSlots) * spectrumSize,
+                                   c.irSpectra.data() + k * spectrumSize);
+
+            fftAudio.performRealOnlyInverseTransform(work);
+            std::copy(work + B, work + fftSize, c.outputFrame.begin());
+        }
+
+        if (numPartitions > headPartitions)
+        {
+            const auto tailSlot = (int) (frame % numTailSlots);
+
+            if (tailFramesReady.load(std::memory_order_acquire) > frame && tailSlotResetFrame[(size_t) tailSlot] == oldest)
+            {
+                for (auto& c : channels)
+                    juce::FloatVectorOperations::add(c.outputFrame.data(), c.tailOutput.data() + tailSlot * B, B);
+            }
+            else if (frame >= oldest + headPartitions)
+            {
+                lateCounter.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        ++frameIndex;
+        framesWritten.store(frameIndex, std::memory_order_release);
+
+        // Wakes the worker for the tail this frame's spectrum makes computable
+        worker.wake();
+    }
+
+    // Worker thread, one frame per call so the other engines on it get a turn. The tail of
+    // frame t only needs input frames up to t - headPartitions, so it can be computed as soon
+    // as that frame's spectrum has been written.
+    bool processNext() noexcept override
+    {
+        constexpr int B = partitionSize;
+
+        const auto written = framesWritten.load(std::memory_order_acquire);
+
+        // Anything before the audio thread's current frame is too late to be used
+        nextTailFrame = juce::jmax(nextTailFrame, written);
+
+        // Nothing to do until the audio thread writes another frame, which wakes the worker
+        if (nextTailFrame > written - 1 + headPartitions)
+            return false;
+
+        const auto t = nextTailFrame;
+        const auto oldest = resetFrame.load(std::memory_order_acquire);
+        const auto tailSlot = (int) (t % numTailSlots);
+
+        for (auto& c : channels)
+        {
+            auto* work = c.tailWork.data();
+            std::fill(work, work + workSize, 0.0f);
+
+            for (int k = headPartitions; k < numPartitions && t - k >= oldest; ++k)
+                multiplyAccumulate(work, c.spectra.data() + ((t - k) % numSlots) * spectrumSize,
+                                   c.irSpectra.data() + k * spectrumSize);
+
+            fftWorker.performRealOnlyInverseTransform(work);
+            std::copy(work + B, work + fftSize, c.tailOutput.begin() + tailSlot * B);
+        }
+
+        tailSlotResetFrame[(size_t) tailSlot] = oldest;
+        tailFramesReady.store(t + 1, std::memory_order_release);
+        ++nextTailFrame;
+        return true;
+    }
+
+    SharedResources::StreamingWorker& worker;
+    juce::dsp::FFT fftAudio { fftOrder }, fftWorker { fftOrder };
+    std::vector<Channel> channels;
+    int numPartitions = 0, numSlots = 0, numTailSlots = 0;
+
+    // Audio thread
+    int fifoPosition = 0;
+    juce::int64 frameIndex = 0;
+
+    // Worker thread
+    juce::int64 nextTailFrame = 0;
+
+    std::atomic<juce::int64> framesWritten { 0 }, tailFramesReady { 0 }, resetFrame { 0 };
+    std::vector<juce::int64> tailSlotResetFrame;
+};
+
+//==============================================================================
+class PartitionedConvolver::LoadJob  : public juce::ThreadPoolJob
+{
+public:
+    explicit LoadJob(PartitionedConvolver& o)
+        : juce::ThreadPoolJob("IR loader"), owner(o)
+    {
+    }
+
+    JobStatus runJob() override
+    {
+        owner.loadAndBuild();
+        owner.loadFinished.signal();
+        return jobHasFinished;
+    }
+
+    PartitionedConvolver& owner;
+};
+
+//==============================================================================
+PartitionedConvolver::PartitionedConvolver()
+{
+}
+
+PartitionedConvolver::~PartitionedConvolver()
+{
+    struct JobsOwnedBy  : public juce::ThreadPool::JobSelector
+    {
+        explicit JobsOwnedBy(PartitionedConvolver& o) : owner(o) {}
+
+        bool isJobSuitable(juce::ThreadPoolJob* job) override
+        {
+            auto* load = dynamic_cast<LoadJob*>(job);
+            return load != nullptr && &load->owner == &owner;
+        }
+
+        PartitionedConvolver& owner;
+    };
+
+    JobsOwnedBy selector(*this);
+    sharedResources->getWorkerPool().removeAllJobs(true, 5000, &selector);
+
+    delete activeEngine;
+    delete pendingEngine.exchange(nullptr);
+    delete retiredEngine.exchange(nullptr);
+}
+
+void PartitionedConvolver::prepare(const juce::dsp::ProcessSpec& newSpec)
+{
+    {
+        const juce::ScopedLock sl(lock);
+        spec = newSpec;
+        rebuildNeeded = impulseFile != juce::File();
+    }
+
+    // Engines are built for one sample rate and channel count, so drop them and rebuild in the background
+    delete activeEngine;
+    activeEngine = nullptr;
+    delete pendingEngine.exchange(nullptr);
+    delete retiredEngine.exchange(nullptr);
+
+    scheduleLoad();
+}
+
+void PartitionedConvolver::loadImpulseResponse(const juce::File& file)
+{
+    {
+        const juce::ScopedLock sl(lock);
+        impulseFile = file;
+        fileChanged = true;
+    }
+
+    scheduleLoad();
+}
+
+juce::File PartitionedConvolver::getImpulseResponseFile() const
+{
+    const juce::ScopedLock sl(lock);
+    return impulseFile;
+}
+
+void PartitionedConvolver::waitUntilReady()
+{
+    // A queued job leaves the flag set until it starts; one that is running holds loaderLock
+    while (loadScheduled.load())
+        loadFinished.wait(100);
+
+    const juce::ScopedLock loadLock(loaderLock);
+}
+
+void PartitionedConvolver::restart() noexcept
+{
+    if (activeEngine != nullptr)
+        activeEngine->restart();
+}
+
+void PartitionedConvolver::process(const juce::dsp::AudioBlock<float>& block, float wetLevel) noexcept
+{
+    // Swap in a newly built engine, once the previous one has been collected. The one swapped
+    // out is deleted by the next load job or prepare(), never here
+    if (pendingEngine.load(std::memory_order_relaxed) != nullptr
+        && retiredEngine.load(std::memory_order_acquire) == nullptr)
+    {
+        retiredEngine.store(activeEngine, std::memory_order_release);
+        activeEngine = pendingEngine.exchange(nullptr, std::memory_order_acq_rel);
+    }
+
+    if (activeEngine != nullptr)
+        activeEngine->process(block, wetLevel, numLateTailFrames);
+}
+
+//==============================================================================
+void PartitionedConvolver::scheduleLoad()
+{
+    if (! loadScheduled.exchange(true))
+        sharedResources->getWorkerPool().addJob(new LoadJob(*this), true);
+}
+
+void PartitionedConvolver::loadAndBuild()
+{
+    // The pool has more than one thread, so a job queued while another runs waits for it here
+    const juce::ScopedLock loadLock(loaderLock);
+
+    // Cleared before looking at the request, so anything from here on queues another job
+    loadScheduled = false;
+
+    delete retiredEngine.exchange(nullptr, std::memory_order_acq_rel);
+
+    juce::File fileToLoad;
+    juce::dsp::ProcessSpec buildSpec;
+    bool needsLoad = false, needsBuild = false;
+
+    {
+        const juce::ScopedLock sl(lock);
+        needsLoad = fileChanged;
+        needsBuild = fileChanged || rebuildNeeded;
+        fileToLoad = impulseFile;
+        buildSpec = spec;
+        fileChanged = rebuildNeeded = false;
+    }
+
+    // If the new file can't be read, the previous IR stays in use
+    if (needsLoad && ! readImpulse(fileToLoad))
+        return;
+
+    if (! needsBuild || impulse.getNumSamples() == 0)
+        return;
+
+    // Resample to the playback rate and normalise to unit energy
+    auto ratio = impulseSampleRate / buildSpec.sampleRate;
+    auto length = juce::jmin((int) std::ceil(impulse.getNumSamples() / ratio), (int) (maxImpulseSeconds * buildSpec.sampleRate));
+
+    juce::AudioBuffer<float> resampled(impulse.getNumChannels(), length);
+    auto maxEnergy = 0.0f;
+
+    for (int ch = 0; ch < impulse.getNumChannels(); ++ch)
+    {
+        juce::LagrangeInterpolator interpolator;
+        interpolator.process(ratio, impulse.getReadPointer(ch), resampled.getWritePointer(ch), length,
+                             impulse.getNumSamples(), 0);
+
+        auto* data = resampled.getReadPointer(ch);
+        auto energy = 0.0f;
+
+        for (int i = 0; i < length; ++i)
+            energy += data[i] * data[i];
+
+        maxEnergy = juce::jmax(maxEnergy, energy);
+    }
+
+    if (maxEnergy > 0.0f)
+        resampled.applyGain(1.0f / std::sqrt(maxEnergy));
+
+    auto engine = std::make_unique<Engine>(resampled, juce::jmax(1, (int) buildSpec.numChannels),
+                                           sharedResources->getStreamingWorker());
+
+    const juce::ScopedLock sl(lock);
+
+    // A newer file or a re-prepare arrived while building, so this engine is already stale
+    // and the job that request queued will build the right one
+    if (fileChanged || rebuildNeeded)
+        return;
+
+    delete pendingEngine.exchange(engine.release(), std::memory_order_acq_rel);
+    tailSeconds = (length + partitionSize) / buildSpec.sampleRate;
+}
+
+bool PartitionedConvolver::readImpulse(const juce::File& file)
+{
+    juce::AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+
+    std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(file));
+
+    if (reader == nullptr || reader->lengthInSamples <= 0 || reader->sampleRate <= 0.0)
+        return false;
+
+    auto length = (int) juce::jmin(reader->lengthInSamples, (juce::int64) (maxImpulseSeconds * reader->sampleRate));
+
+    impulse.setSize(juce::jmin(2, (int) reader->numChannels), length);
+    impulseSampleRate = reader->sampleRate;
+
+    return reader->read(&impulse, 0, length, 0, true, impulse.getNumChannels() > 1);
+}
@@ -0,0 +1,95 @@
+/*
+  ==============================================================================
+
+    PartitionedConvolver.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "SharedResources.h"
+
+//==============================================================================
+/**
+    Impulse-response reverb using uniformly-partitioned overlap-save FFT
+    convolution.
+
+    The first headPartitions partitions of the IR are convolved on the audio
+    thread. The rest (the tail) are summed in the frequency domain on the
+    process-wide streaming worker, which every instance's convolver shares and
+    which starts on a frame's tail as soon as the input spectrum it
+    depends on exists, i.e. headPartitions frames before the audio thread
+    needs it. The two threads only share atomics and ring buffers; the audio
+    thread never waits for the worker. If the worker misses a frame, that
+    frame's tail is dropped and counted in getNumLateTailFrames().
+
+    The wet signal comes out one partition (partitionSize samples) after the
+    dry signal, which acts as a short pre-delay.
+
+    Impulse responses are read, resampled and transformed by jobs on the
+    shared worker pool, then swapped in at the start of a block.
+*/
+class PartitionedConvolver
+{
+public:
+    static constexpr int partitionSize = 128;
+    static constexpr int headPartitions = 8;
+    static constexpr double maxImpulseSeconds = 10.0;
+
+    PartitionedConvolver();
+    ~PartitionedConvolver();
+
+    void prepare(const juce::dsp::ProcessSpec& spec);
+
+    /** Loads the file in the background; the current IR keeps playing until it's ready. */
+    void loadImpulseResponse(const juce::File& file);
+    juce::File getImpulseResponseFile() const;
+
+    /** Blocks until every requested load and rebuild has finished, for non-realtime
+        rendering. The engine is then swapped in by the next process() call.
+    */
+    void waitUntilReady();
+
+    /** Forgets the current input, e.g. when coming back from bypass. Safe on the audio thread. */
+    void restart() noexcept;
+
+    /** Replaces the block with dry * (1 - wetLevel) + wet * wetLevel. */
+    void process(const juce::dsp::AudioBlock<float>& block, float wetLevel) noexcept;
+
+    /** The IR length plus the pre-delay, or 0 when no IR is loaded. */
+    double getTailLengthSeconds() const noexcept    { return tailSeconds.load(); }
+    int getNumLateTailFrames() const noexcept       { return numLateTailFrames.load(); }
+
+private:
+    class Engine;
+    class LoadJob;
+
+    void scheduleLoad();
+    void loadAndBuild();
+    bool readImpulse(const juce::File& file);
+
+    juce::SharedResourcePointer<SharedResources> sharedResources;
+
+    juce::CriticalSection lock;
+    juce::dsp::ProcessSpec spec { 44100.0, 512, 2 };
+    juce::File impulseFile;
+    bool fileChanged = false, rebuildNeeded = false;
+
+    // Only touched by load jobs, which take loaderLock
+    juce::CriticalSection loaderLock;
+    std::atomic<bool> loadScheduled { false };
+    juce::WaitableEvent loadFinished;
+    juce::AudioBuffer<float> impulse;
+    double impulseSampleRate = 0.0;
+
+    // The active engine belongs to the audio thread; the others are handed over through the atomics
+    Engine* activeEngine = nullptr;
+    std::atomic<Engine*> pendingEngine { nullptr }, retiredEngine { nullptr };
+
+    std::atomic<double> tailSeconds { 0.0 };
+    std::atomic<int> numLateTailFrames { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE (PartitionedConvolver)
+};
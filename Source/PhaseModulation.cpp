@@ -0,0 +1,141 @@
+/*
+  ==============================================================================
+
+    PhaseModulation.cpp
+
+  ==============================================================================
+*/
+
+#include "PhaseModulation.h"
+
+namespace
+{
+    // Full feedback swings the top operator's phase by up to half a cycle (pi radians)
+    constexpr float maxFeedbackCycles = 0.5f;
+}
+
+void PhaseModulationOscillator::setTable(const float* samples, int numSamples) noexcept
+{
+    table = samples;
+    tableSize = numSamples - 1;
+    mask = (unsigned int) tableSize - 1;
+    jassert (juce::isPowerOfTwo (tableSize));
+}
+
+void PhaseModulationOscillator::setSettings(const PhaseModulationSettings& newSettings) noexcept
+{
+    auto ratiosChanged = newSettings.ratios != settings.ratios;
+    settings = newSettings;
+    settings.numOperators = juce::jlimit(0, PhaseModulationSettings::maxOperators, settings.numOperators);
+
+    if (ratiosChanged)
+        setFrequency(frequency, sampleRate);
+}
+
+void PhaseModulationOscillator::setFrequency(float newFrequency, float newSampleRate) noexcept
+{
+    frequency = newFrequency;
+    sampleRate = newSampleRate;
+
+    for (size_t op = 0; op < increments.size(); ++op)
+        increments[op] = frequency * settings.ratios[op] / sampleRate;
+}
+
+void PhaseModulationOscillator::reset() noexcept
+{
+    phases.fill(0.0f);
+    feedbackHistory[0] = feedbackHistory[1] = 0.0f;
+    firstBlock = true;
+}
+
+void PhaseModulationOscillator::process(float* output, int numSamples) noexcept
+{
+    jassert (table != nullptr && numSamples <= maxBlockSize);
+
+    if (! isEnabled())
+    {
+        juce::FloatVectorOperations::clear(output, numSamples);
+        return;
+    }
+
+    const auto top = settings.numOperators - 1;
+
+    if (settings.feedback > 0.0f)
+        renderFeedbackOperator(top, modulation, numSamples);
+    else
+        renderOperator(top, nullptr, modulation, numSamples);
+
+    for (int op = top - 1; op >= 0; --op)
+    {
+        // Scale the operator above to its index, ramping from the last block's
+        auto& depth = currentDepths[(size_t) op + 1];
+        auto target = settings.indices[(size_t) op + 1] / juce::MathConstants<float>::twoPi;
+
+        if (firstBlock)
+            depth = target;
+
+        auto step = (target - depth) / (float) numSamples;
+
+        for (int i = 0; i < numSamples; ++i)
+            modulation[i] *= depth + (float) (i + 1) * step;
+
+        depth = target;
+
+        renderOperator(op, modulation, op == 0 ? output : modulation, numSamples);
+    }
+
+    firstBlock = false;
+}
+
+void PhaseModulationOscillator::renderOperator(int op, const float* modulationInput, float* output, int numSamples) noexcept
+{
+    const auto phase = phases[(size_t) op];
+    const auto increment = increments[(size_t) op];
+
+    kernels.renderPhaseOperator(table, tableSize, phase, increment, modulationInput, output, numSamples);
+
+    auto next = phase + (float) numSamples * increment;
+    phases[(size_t) op] = next - (float) (int) next;
+}
+
+void PhaseModulationOscillator::renderFeedbackOperator(int op, float* output, int numSamples) noexcept
+{
+    const auto phase = phases[(size_t) op];
+    const auto increment = increments[(size_t) op];
+    const auto size = (float) tableSize;
+
+    // The unmodulated phases don't depend on the feedback, so they are worked out up front
+    for (int i = 0; i < numSamples; ++i)
+    {
+        auto p = phase + (float) i * increment;
+        fractions[i] = p - (float) (int) p;
+    }
+
+    // Averaging the last two outputs keeps strong feedback from flipping between two states
+    const auto amount = settings.feedback * maxFeedbackCycles * 0.5f;
+    auto y1 = feedbackHistory[0], y2 = feedbackHistory[1];
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        // Feedback moves the phase by at most half a cycle, so one correction each way wraps it
+        auto p = fractions[i] + amount * (y1 + y2);
+        p += p < 0.0f ? 1.0f : 0.0f;
+        p -= p >= 1.0f ? 1.0f : 0.0f;
+
+        auto position = p * size;
+        auto index = (unsigned int) position;
+        auto frac = position - (float) index;
+        index &= mask;
+
+        auto y = table[index] + frac * (table[index + 1] - table[index]);
+        y2 = y1;
+        y1 = y;
+        output[i] = y;
+    }
+
+    feedbackHistory[0] = y1;
+    feedbackHistory[1] = y2;
+
+    auto next = phase + (float) numSamples * increment;
+    phases[(size_t) op] = next - (float) (int) next;
+}
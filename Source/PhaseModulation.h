@@ -0,0 +1,93 @@
+/*
+  ==============================================================================
+
+    PhaseModulation.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "SimdKernels.h"
+
+/** One channel's FM patch. The operators form a stack: the top one modulates
+    itself by the feedback amount, and each one modulates the phase of the one
+    below it, down to operator 1, which is heard.
+*/
+struct PhaseModulationSettings
+{
+    static constexpr int maxOperators = 4;
+
+    int numOperators = 0;   // 0 is off, otherwise 2-4
+    std::array<float, maxOperators> ratios { 1.0f, 1.0f, 1.0f, 1.0f };
+
+    // Peak phase deviation in radians each operator applies to the one below it; the carrier's is unused
+    std::array<float, maxOperators> indices { 0.0f, 1.0f, 1.0f, 1.0f };
+
+    float feedback = 0.0f;  // 0 to 1
+};
+
+//==============================================================================
+/**
+    A stack of sine operators read from one of the shared sine tables.
+
+    Rather than running every operator for each sample, process() renders one
+    operator at a time across the whole block, with SimdKernels' phase operator
+    kernel for this CPU. Only the top operator's feedback has to run sample by
+    sample, and only when it is on.
+    Index changes are ramped across the block.
+*/
+class PhaseModulationOscillator
+{
+public:
+    /** The most samples one process() call can render. */
+    static constexpr int maxBlockSize = 64;
+
+    /** numSamples includes the guard sample at the end, as for WavetableOscillator.
+        Only repoints the oscillator, so it is safe to call from the audio thread.
+    */
+    void setTable(const float* samples, int numSamples) noexcept;
+
+    template <size_t numSamples>
+    void setTable(const std::array<float, numSamples>& tableToUse) noexcept
+    {
+        setTable(tableToUse.data(), (int) numSamples);
+    }
+
+    void setSettings(const PhaseModulationSettings& newSettings) noexcept;
+    bool isEnabled() const noexcept     { return settings.numOperators >= 2; }
+
+    void setFrequency(float frequency, float sampleRate) noexcept;
+
+    /** Restarts every operator from zero phase, for a new note. */
+    void reset() noexcept;
+
+    /** Overwrites output with the carrier. */
+    void process(float* output, int numSamples) noexcept;
+
+private:
+    void renderOperator(int op, const float* modulation, float* output, int numSamples) noexcept;
+    void renderFeedbackOperator(int op, float* output, int numSamples) noexcept;
+
+    const float* table = nullptr;
+    int tableSize = 0;
+    unsigned int mask = 0;
+
+    PhaseModulationSettings settings;
+    float frequency = 440.0f, sampleRate = 44100.0f;
+
+    // Phases are in cycles, 0 to 1
+    std::array<float, PhaseModulationSettings::maxOperators> phases {}, increments {};
+    std::array<float, PhaseModulationSettings::maxOperators> currentDepths {};
+    float feedbackHistory[2] = { 0.0f, 0.0f };
+    bool firstBlock = true;
+
+    // The output of the operator above, scaled to cycles of phase deviation
+    alignas(16) float modulation[maxBlockSize];
+
+    // The feedback operator's unmodulated phases
+    alignas(16) float fractions[maxBlockSize];
+
+    const SimdKernels::Kernels& kernels = SimdKernels::get();
+};
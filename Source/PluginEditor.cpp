@@ -11,16 +11,12 @@
 
 //==============================================================================
 MysynthpracAudioProcessorEditor::MysynthpracAudioProcessorEditor(MysynthpracAudioProcessor& p)
-    : AudioProcessorEditor(&p), audioProcessor(p), waveTypeMenuAttatchment(p.state, "wavetype", waveTypeMenu), ladderModeMenuAttatchment(p.state, "laddermode", ladderModeMenu),
-    ladderButtonAttatchment(p.state, "ladderbutton", ladderButton),
-    attackAttatchment(p.state, "attack", attackSlider),
-    decayAttatchment(p.state, "decay", decaySlider),
-    sustainAttatchment(p.state, "sustain", sustainSlider),
-    releaseAttatchment(p.state, "release", releaseSlider),
-    masterVolumeAttatchment(p.state, "volume", masterVolumeSlider),
-    ladderCutOffAttatchment(p.state, "laddercutoff", ladderCutOffSlider),
-    ladderDriveAttatchment(p.state, "ladderdrive", ladderDriveSlider),
-    ladderResAttatchment(p.state, "ladderresonance", ladderResSlider),
+    : AudioProcessorEditor(&p), audioProcessor(p),
+    multiTimbralAttatchment(p.state, "multitimbral", multiTimbralButton),
+    arpButtonAttatchment(p.state, "arpbutton", arpButton),
+    stepSequencer(p),
+    limiterButtonAttatchment(p.state, "limiterbutton", limiterButton),
+    harmonicEditor(p),
     scope(1)
 
 {
@@ -29,6 +25,7 @@ MysynthpracAudioProcessorEditor::MysynthpracAudioProcessorEditor(MysynthpracAudi
     waveTypeMenu.addItem("Triangle", 2);
     waveTypeMenu.addItem("Saw", 3);
     waveTypeMenu.addItem("Square", 4);
+    waveTypeMenu.addItem("Custom", 5);
     addAndMakeVisible(&waveTypeMenu);
 
     //Ladder filter on/off button
@@ -138,9 +135,223 @@ MysynthpracAudioProcessorEditor::MysynthpracAudioProcessorEditor(MysynthpracAudi
     releaseLabel.setText("R", juce::dontSendNotification);
     releaseLabel.setJustificationType(juce::Justification::centred);
 
-
-    waveTypeMenu.setSelectedId(1);
-    ladderModeMenu.setSelectedId(1);
+    //Pan and stereo spread
+    for (auto* slider : { &panSlider, &spreadSlider })
+    {
+        addAndMakeVisible(slider);
+        slider->setSliderStyle(juce::Slider::RotaryVerticalDrag);
+        slider->setTextBoxStyle(juce::Slider::NoTextBox, true, 0, 0);
+        slider->setPopupDisplayEnabled(true, true, this);
+    }
+    
+    addAndMakeVisible(panLabel);
+    panLabel.attachToComponent(&panSlider, true);
+    panLabel.setText("Pan", juce::dontSendNotification);
+    panLabel.setJustificationType(juce::Justification::centred);
+    
+    addAndMakeVisible(spreadLabel);
+    spreadLabel.attachToComponent(&spreadSlider, true);
+    spreadLabel.setText("Spread", juce::dontSendNotification);
+    spreadLabel.setJustificationType(juce::Justification::centred);
+
+    //Multi-timbral button and channel menu
+    multiTimbralButton.setColour(juce::TextButton::buttonColourId, juce::Colour::fromRGB(58, 58, 58));
+    multiTimbralButton.setColour(juce::TextButton::buttonOnColourId, juce::Colours::green);
+    multiTimbralButton.setClickingTogglesState(true);
+    multiTimbralButton.onStateChange = [&]()
+    {
+        const auto isMulti = multiTimbralButton.getToggleState();
+        multiTimbralButton.setButtonText(isMulti ? "Multi On" : "Multi Off");
+        channelMenu.setEnabled(isMulti);
+        
+        if (!isMulti && channelMenu.getSelectedId() != 1)
+            channelMenu.setSelectedId(1);
+    };
+    addAndMakeVisible(&multiTimbralButton);
+    
+    for (int channel = 1; channel <= MysynthpracAudioProcessor::numMidiChannels; ++channel)
+        channelMenu.addItem("Ch " + juce::String(channel), channel);
+    channelMenu.setJustificationType(juce::Justification::centred);
+    channelMenu.onChange = [&]() { attachToChannel(channelMenu.getSelectedId()); };
+    channelMenu.setSelectedId(1, juce::dontSendNotification);
+    channelMenu.setEnabled(multiTimbralButton.getToggleState());
+    multiTimbralButton.setButtonText(multiTimbralButton.getToggleState() ? "Multi On" : "Multi Off");
+    addAndMakeVisible(&channelMenu);
+    
+    //Phase modulation operators
+    fmOperatorsMenu.addItemList({"FM Off", "FM 2 Op", "FM 3 Op", "FM 4 Op"}, 1);
+    fmOperatorsMenu.setJustificationType(juce::Justification::centred);
+    addAndMakeVisible(&fmOperatorsMenu);
+    
+    auto setUpFMSlider = [&](juce::Slider& slider, juce::Label& label, const juce::String& text)
+    {
+        addAndMakeVisible(slider);
+        slider.setSliderStyle(juce::Slider::RotaryVerticalDrag);
+        slider.setTextBoxStyle(juce::Slider::NoTextBox, true, 0, 0);
+        slider.setPopupDisplayEnabled(true, true, this);
+        
+        addAndMakeVisible(label);
+        label.attachToComponent(&slider, true);
+        label.setText(text, juce::dontSendNotification);
+        label.setJustificationType(juce::Justification::centred);
+    };
+    
+    for (int op = 0; op < PhaseModulationSettings::maxOperators; ++op)
+    {
+        setUpFMSlider(fmRatioSliders[(size_t) op], fmRatioLabels[(size_t) op], "R" + juce::String(op + 1));
+        
+        // The carrier has no index
+        if (op > 0)
+            setUpFMSlider(fmIndexSliders[(size_t) op], fmIndexLabels[(size_t) op], "I" + juce::String(op + 1));
+    }
+    
+    setUpFMSlider(fmFeedbackSlider, fmFeedbackLabel, "FB");
+    
+    //Hard sync
+    syncButton.setColour(juce::TextButton::buttonColourId, juce::Colour::fromRGB(58, 58, 58));
+    syncButton.setColour(juce::TextButton::buttonOnColourId, juce::Colours::green);
+    syncButton.setClickingTogglesState(true);
+    syncButton.setTooltip("Restarts the wave with every cycle of the note, with the ratio setting how far above the note it plays");
+    syncButton.onStateChange = [&]() { syncButton.setButtonText(syncButton.getToggleState() ? "Sync On" : "Sync Off"); };
+    addAndMakeVisible(&syncButton);
+    
+    syncRatioSlider.setSliderStyle(juce::Slider::LinearHorizontal);
+    syncRatioSlider.setTextBoxStyle(juce::Slider::NoTextBox, true, 0, 0);
+    syncRatioSlider.setPopupDisplayEnabled(true, true, this);
+    syncRatioSlider.setTextValueSuffix("x");
+    addAndMakeVisible(&syncRatioSlider);
+    
+    attachToChannel(1);
+    
+    //Scala microtuning
+    tuningButton.setColour(juce::TextButton::buttonColourId, juce::Colour::fromRGB(58, 58, 58));
+    tuningButton.onClick = [&]()
+    {
+        juce::PopupMenu menu;
+        menu.addItem(1, "Load Scala file...");
+        menu.addItem(2, "12-TET");
+        menu.showMenuAsync(juce::PopupMenu::Options().withTargetComponent(&tuningButton), [&](int result)
+        {
+            if (result == 2)
+                audioProcessor.resetTuning();
+            
+            if (result != 1)
+                return;
+            
+            // A keyboard mapping can be picked along with the scale
+            tuningChooser = std::make_unique<juce::FileChooser>("Choose a Scala scale and keyboard mapping", juce::File(), "*.scl;*.kbm");
+            tuningChooser->launchAsync(juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles
+                                       | juce::FileBrowserComponent::canSelectMultipleItems,
+                                       [&](const juce::FileChooser& chooser)
+                                       {
+                                           juce::File scaleFile, mappingFile;
+                                           for (auto& file : chooser.getResults())
+                                               (file.hasFileExtension("kbm") ? mappingFile : scaleFile) = file;
+                                           
+                                           if (!scaleFile.existsAsFile())
+                                               return;
+                                           
+                                           auto loaded = audioProcessor.loadTuning(scaleFile, mappingFile);
+                                           if (loaded.failed())
+                                               juce::AlertWindow::showMessageBoxAsync(juce::MessageBoxIconType::WarningIcon,
+                                                                                      "Couldn't load the tuning", loaded.getErrorMessage());
+                                       });
+        });
+    };
+    addAndMakeVisible(&tuningButton);
+    
+    //Impulse response for the convolution reverb
+    impulseButton.setColour(juce::TextButton::buttonColourId, juce::Colour::fromRGB(58, 58, 58));
+    impulseButton.onClick = [&]()
+    {
+        impulseChooser = std::make_unique<juce::FileChooser>("Choose an impulse response", juce::File(), "*.wav");
+        impulseChooser->launchAsync(juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles,
+                                    [&](const juce::FileChooser& chooser)
+                                    {
+                                        auto file = chooser.getResult();
+                                        if (file.existsAsFile())
+                                            audioProcessor.loadImpulseResponse(file);
+                                    });
+    };
+    addAndMakeVisible(&impulseButton);
+    
+    //Arpeggiator
+    arpButton.setColour(juce::TextButton::buttonColourId, juce::Colour::fromRGB(58, 58, 58));
+    arpButton.setColour(juce::TextButton::buttonOnColourId, juce::Colours::green);
+    arpButton.setClickingTogglesState(true);
+    arpButton.onStateChange = [&]() { arpButton.setButtonText(arpButton.getToggleState() ? "Arp On" : "Arp Off"); };
+    arpButton.setButtonText(arpButton.getToggleState() ? "Arp On" : "Arp Off");
+    addAndMakeVisible(&arpButton);
+    
+    arpModeMenu.addItemList(Arpeggiator::getModeNames(), 1);
+    arpRateMenu.addItemList(Arpeggiator::getRateNames(), 1);
+    arpModeMenuAttatchment = std::make_unique<ComboBoxAttachment>(p.state, "arpmode", arpModeMenu);
+    arpRateMenuAttatchment = std::make_unique<ComboBoxAttachment>(p.state, "arprate", arpRateMenu);
+    arpModeMenu.setJustificationType(juce::Justification::centred);
+    arpRateMenu.setJustificationType(juce::Justification::centred);
+    addAndMakeVisible(&arpModeMenu);
+    addAndMakeVisible(&arpRateMenu);
+    addAndMakeVisible(stepSequencer);
+    addAndMakeVisible(harmonicEditor);
+    
+    //Anticipative rendering
+    anticipateButton.setColour(juce::TextButton::buttonColourId, juce::Colour::fromRGB(58, 58, 58));
+    anticipateButton.setColour(juce::TextButton::buttonOnColourId, juce::Colours::green);
+    anticipateButton.setClickingTogglesState(true);
+    anticipateButton.setTooltip("Renders the voices ahead on a background thread, adding two blocks of latency");
+    anticipateButton.onClick = [&]() { audioProcessor.setAnticipativeRendering(anticipateButton.getToggleState()); };
+    anticipateButton.onStateChange = [&]() { anticipateButton.setButtonText(anticipateButton.getToggleState() ? "Ahead On" : "Ahead Off"); };
+    anticipateButton.setToggleState(p.isAnticipativeRendering(), juce::dontSendNotification);
+    addAndMakeVisible(&anticipateButton);
+    
+    //Live MIDI jitter buffer
+    liveMidiJitterSlider.setSliderStyle(juce::Slider::LinearHorizontal);
+    liveMidiJitterSlider.setTextBoxStyle(juce::Slider::NoTextBox, true, 0, 0);
+    liveMidiJitterSlider.setPopupDisplayEnabled(true, true, this);
+    liveMidiJitterSlider.setRange(0.0, 20.0, 0.5);
+    liveMidiJitterSlider.setTextValueSuffix(" ms MIDI jitter buffer");
+    liveMidiJitterSlider.setTooltip("Holds live MIDI back to keep its timing within a block, adding this much latency");
+    liveMidiJitterSlider.setValue(p.getLiveMidiJitterBufferMs(), juce::dontSendNotification);
+    liveMidiJitterSlider.onValueChange = [&]() { audioProcessor.setLiveMidiJitterBufferMs(liveMidiJitterSlider.getValue()); };
+    
+    if (p.wrapperType == juce::AudioProcessor::wrapperType_Standalone)
+        addAndMakeVisible(&liveMidiJitterSlider);
+    
+    //Quality tier
+    qualityMenu.addItemList({"Eco", "Standard", "High"}, 1);
+    qualityMenuAttatchment = std::make_unique<ComboBoxAttachment>(p.state, "quality", qualityMenu);
+    qualityMenu.setJustificationType(juce::Justification::centred);
+    addAndMakeVisible(&qualityMenu);
+    
+    //Master limiter
+    limiterButton.setColour(juce::TextButton::buttonColourId, juce::Colour::fromRGB(58, 58, 58));
+    limiterButton.setColour(juce::TextButton::buttonOnColourId, juce::Colours::green);
+    limiterButton.setClickingTogglesState(true);
+    limiterButton.onStateChange = [&]() { limiterButton.setButtonText(limiterButton.getToggleState() ? "Limit On" : "Limit Off"); };
+    limiterButton.setButtonText(limiterButton.getToggleState() ? "Limit On" : "Limit Off");
+    addAndMakeVisible(&limiterButton);
+    
+    limiterLookaheadButton.setColour(juce::TextButton::buttonColourId, juce::Colour::fromRGB(58, 58, 58));
+    limiterLookaheadButton.setColour(juce::TextButton::buttonOnColourId, juce::Colours::green);
+    limiterLookaheadButton.setClickingTogglesState(true);
+    limiterLookaheadButton.setTooltip("Gives the limiter 1.5 ms to see peaks coming, adding the same latency");
+    limiterLookaheadButton.onClick = [&]() { audioProcessor.setLimiterLookahead(limiterLookaheadButton.getToggleState()); };
+    limiterLookaheadButton.onStateChange = [&]() { limiterLookaheadButton.setButtonText(limiterLookaheadButton.getToggleState() ? "Lookahead On" : "Lookahead Off"); };
+    limiterLookaheadButton.setToggleState(p.isLimiterLookahead(), juce::dontSendNotification);
+    addAndMakeVisible(&limiterLookaheadButton);
+    
+    for (auto* slider : { &limiterThresholdSlider, &limiterReleaseSlider })
+    {
+        slider->setSliderStyle(juce::Slider::LinearHorizontal);
+        slider->setTextBoxStyle(juce::Slider::NoTextBox, true, 0, 0);
+        slider->setPopupDisplayEnabled(true, true, this);
+        addAndMakeVisible(slider);
+    }
+    
+    limiterThresholdSlider.setTextValueSuffix(" dB");
+    limiterReleaseSlider.setTextValueSuffix(" ms");
+    limiterThresholdAttatchment = std::make_unique<SliderAttachment>(p.state, "limiterthreshold", limiterThresholdSlider);
+    limiterReleaseAttatchment = std::make_unique<SliderAttachment>(p.state, "limiterrelease", limiterReleaseSlider);
     
     //Oscilloscope
     addAndMakeVisible(scope);
@@ -156,7 +367,7 @@ MysynthpracAudioProcessorEditor::MysynthpracAudioProcessorEditor(MysynthpracAudi
     getLookAndFeel().setColour(juce::BubbleComponent::backgroundColourId, juce::Colour::fromRGB(58, 58, 58));
     
     //Essentials I guess
-    setSize (700, 200);
+    setSize (700, 410);
     
     scope.setSamplesPerBlock(2);
     startTimerHz(60);
@@ -207,11 +418,122 @@ void MysynthpracAudioProcessorEditor::resized()
     
     scope.setBounds(184, 19, 333, 90);
     
+    multiTimbralButton.setBounds(184, 163, 80, 17);
+    channelMenu.setBounds(274, 163, 90, 17);
+    
+    panSlider.setBounds(412, 158, 25, 25);
+    spreadSlider.setBounds(492, 158, 25, 25);
+    
+    impulseButton.setBounds(20, 163, 125, 17);
+    
+    arpButton.setBounds(20, 200, 60, 17);
+    anticipateButton.setBounds(85, 200, 95, 17);
+    arpModeMenu.setBounds(20, 222, 95, 17);
+    arpRateMenu.setBounds(120, 222, 60, 17);
+    qualityMenu.setBounds(20, 244, 160, 17);
+    stepSequencer.setBounds(196, 200, 492, 39);
+    
+    limiterButton.setBounds(196, 244, 70, 17);
+    limiterLookaheadButton.setBounds(271, 244, 105, 17);
+    limiterThresholdSlider.setBounds(386, 244, 146, 17);
+    limiterReleaseSlider.setBounds(542, 244, 146, 17);
+    
+    harmonicEditor.setBounds(16, 268, 672, 75);
+    
+    fmOperatorsMenu.setBounds(20, 355, 95, 17);
+    
+    // Each knob has its label to the left
+    auto x = 150;
+    for (int op = 0; op < PhaseModulationSettings::maxOperators; ++op)
+    {
+        fmRatioSliders[(size_t) op].setBounds(x, 351, 25, 25);
+        x += 60;
+    }
+    
+    for (int op = 1; op < PhaseModulationSettings::maxOperators; ++op)
+    {
+        fmIndexSliders[(size_t) op].setBounds(x, 351, 25, 25);
+        x += 60;
+    }
+    
+    fmFeedbackSlider.setBounds(x, 351, 25, 25);
+    
+    tuningButton.setBounds(600, 355, 88, 17);
+    
+    syncButton.setBounds(20, 384, 95, 17);
+    syncRatioSlider.setBounds(120, 384, 200, 17);
+    liveMidiJitterSlider.setBounds(400, 384, 288, 17);
+    
+}
+
+void MysynthpracAudioProcessorEditor::attachToChannel(int midiChannel)
+{
+    auto& state = audioProcessor.state;
+    auto id = [midiChannel](const juce::String& baseID) { return MysynthpracAudioProcessor::getChannelParameterID(baseID, midiChannel); };
+    
+    // Old attachments have to go before new ones are made for the same controls
+    waveTypeMenuAttatchment.reset();
+    ladderModeMenuAttatchment.reset();
+    ladderButtonAttatchment.reset();
+    attackAttatchment.reset();
+    decayAttatchment.reset();
+    sustainAttatchment.reset();
+    releaseAttatchment.reset();
+    masterVolumeAttatchment.reset();
+    ladderCutOffAttatchment.reset();
+    ladderDriveAttatchment.reset();
+    ladderResAttatchment.reset();
+    panAttatchment.reset();
+    spreadAttatchment.reset();
+    fmOperatorsMenuAttatchment.reset();
+    fmFeedbackAttatchment.reset();
+    syncButtonAttatchment.reset();
+    syncRatioAttatchment.reset();
+    
+    for (auto& attachment : fmRatioAttatchments)
+        attachment.reset();
+    
+    for (auto& attachment : fmIndexAttatchments)
+        attachment.reset();
+    
+    waveTypeMenuAttatchment = std::make_unique<ComboBoxAttachment>(state, id("wavetype"), waveTypeMenu);
+    ladderModeMenuAttatchment = std::make_unique<ComboBoxAttachment>(state, id("laddermode"), ladderModeMenu);
+    ladderButtonAttatchment = std::make_unique<ButtonAttachment>(state, id("ladderbutton"), ladderButton);
+    attackAttatchment = std::make_unique<SliderAttachment>(state, id("attack"), attackSlider);
+    decayAttatchment = std::make_unique<SliderAttachment>(state, id("decay"), decaySlider);
+    sustainAttatchment = std::make_unique<SliderAttachment>(state, id("sustain"), sustainSlider);
+    releaseAttatchment = std::make_unique<SliderAttachment>(state, id("release"), releaseSlider);
+    masterVolumeAttatchment = std::make_unique<SliderAttachment>(state, id("volume"), masterVolumeSlider);
+    ladderCutOffAttatchment = std::make_unique<SliderAttachment>(state, id("laddercutoff"), ladderCutOffSlider);
+    ladderDriveAttatchment = std::make_unique<SliderAttachment>(state, id("ladderdrive"), ladderDriveSlider);
+    ladderResAttatchment = std::make_unique<SliderAttachment>(state, id("ladderresonance"), ladderResSlider);
+    panAttatchment = std::make_unique<SliderAttachment>(state, id("pan"), panSlider);
+    spreadAttatchment = std::make_unique<SliderAttachment>(state, id("spread"), spreadSlider);
+    fmOperatorsMenuAttatchment = std::make_unique<ComboBoxAttachment>(state, id("fmoperators"), fmOperatorsMenu);
+    fmFeedbackAttatchment = std::make_unique<SliderAttachment>(state, id("fmfeedback"), fmFeedbackSlider);
+    syncButtonAttatchment = std::make_unique<ButtonAttachment>(state, id("syncbutton"), syncButton);
+    syncRatioAttatchment = std::make_unique<SliderAttachment>(state, id("syncratio"), syncRatioSlider);
+    
+    for (int op = 0; op < PhaseModulationSettings::maxOperators; ++op)
+    {
+        auto number = juce::String(op + 1);
+        fmRatioAttatchments[(size_t) op] = std::make_unique<SliderAttachment>(state, id("fmratio" + number), fmRatioSliders[(size_t) op]);
+        
+        if (op > 0)
+            fmIndexAttatchments[(size_t) op] = std::make_unique<SliderAttachment>(state, id("fmindex" + number), fmIndexSliders[(size_t) op]);
+    }
+    
+    ladderButton.setButtonText(ladderButton.getToggleState() ? "Filter On!" : "Filter Off!");
 }
 
 void MysynthpracAudioProcessorEditor::timerCallback ()
 {
     scope.pushBuffer(audioProcessor.cachedBuffer);
+    stepSequencer.refresh();
+    harmonicEditor.refresh();
+    anticipateButton.setToggleState(audioProcessor.isAnticipativeRendering(), juce::dontSendNotification);
+    limiterLookaheadButton.setToggleState(audioProcessor.isLimiterLookahead(), juce::dontSendNotification);
+    tuningButton.setTooltip(audioProcessor.getTuningDescription());
     repaint();
     
 };
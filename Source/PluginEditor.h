@@ -10,6 +10,8 @@
 
 #include <JuceHeader.h>
 #include "PluginProcessor.h"
+#include "StepSequencerComponent.h"
+#include "HarmonicEditorComponent.h"
 
 //==============================================================================
 /**
@@ -27,18 +29,84 @@ public:
 
     
 private:
+    void attachToChannel(int midiChannel);
+    
+
     // This reference is provided as a quick way for your editor to
     // access the processor object that created it.
     MysynthpracAudioProcessor& audioProcessor;
 
+    using ComboBoxAttachment = juce::AudioProcessorValueTreeState::ComboBoxAttachment;
+    using ButtonAttachment = juce::AudioProcessorValueTreeState::ButtonAttachment;
+    using SliderAttachment = juce::AudioProcessorValueTreeState::SliderAttachment;
+    
     juce::ComboBox waveTypeMenu, ladderModeMenu;
-    juce::AudioProcessorValueTreeState::ComboBoxAttachment waveTypeMenuAttatchment, ladderModeMenuAttatchment;
+    std::unique_ptr<ComboBoxAttachment> waveTypeMenuAttatchment, ladderModeMenuAttatchment;
 
     juce::TextButton ladderButton {"Filer Off!"};
-    juce::AudioProcessorValueTreeState::ButtonAttachment ladderButtonAttatchment;
+    std::unique_ptr<ButtonAttachment> ladderButtonAttatchment;
 
     juce::Slider attackSlider, decaySlider, sustainSlider, releaseSlider, masterVolumeSlider, ladderCutOffSlider, ladderDriveSlider, ladderResSlider;
-    juce::AudioProcessorValueTreeState::SliderAttachment attackAttatchment, decayAttatchment, sustainAttatchment, releaseAttatchment, masterVolumeAttatchment, ladderCutOffAttatchment, ladderDriveAttatchment, ladderResAttatchment;
+    std::unique_ptr<SliderAttachment> attackAttatchment, decayAttatchment, sustainAttatchment, releaseAttatchment, masterVolumeAttatchment, ladderCutOffAttatchment, ladderDriveAttatchment, ladderResAttatchment;
+    
+    //Multi-timbral channel selection
+    juce::TextButton multiTimbralButton {"Multi Off"};
+    juce::AudioProcessorValueTreeState::ButtonAttachment multiTimbralAttatchment;
+    juce::ComboBox channelMenu;
+    
+    juce::Slider panSlider, spreadSlider;
+    std::unique_ptr<SliderAttachment> panAttatchment, spreadAttatchment;
+    juce::Label panLabel, spreadLabel;
+    
+    juce::TextButton impulseButton {"Load IR..."};
+    std::unique_ptr<juce::FileChooser> impulseChooser;
+    
+    //Arpeggiator and step sequencer
+    juce::TextButton arpButton {"Arp Off"};
+    juce::AudioProcessorValueTreeState::ButtonAttachment arpButtonAttatchment;
+    juce::ComboBox arpModeMenu, arpRateMenu;
+    std::unique_ptr<ComboBoxAttachment> arpModeMenuAttatchment, arpRateMenuAttatchment;
+    StepSequencerComponent stepSequencer;
+    
+    //Render a few blocks ahead on a background thread
+    juce::TextButton anticipateButton {"Ahead Off"};
+    
+    //Jitter buffer for live MIDI, standalone only
+    juce::Slider liveMidiJitterSlider;
+    
+    //Oscillator quality tier
+    juce::ComboBox qualityMenu;
+    std::unique_ptr<ComboBoxAttachment> qualityMenuAttatchment;
+    
+    //Master limiter
+    juce::TextButton limiterButton {"Limit Off"};
+    juce::AudioProcessorValueTreeState::ButtonAttachment limiterButtonAttatchment;
+    juce::TextButton limiterLookaheadButton {"Lookahead Off"};
+    juce::Slider limiterThresholdSlider, limiterReleaseSlider;
+    std::unique_ptr<SliderAttachment> limiterThresholdAttatchment, limiterReleaseAttatchment;
+    
+    //Phase modulation operators of the selected channel
+    juce::ComboBox fmOperatorsMenu;
+    std::unique_ptr<ComboBoxAttachment> fmOperatorsMenuAttatchment;
+    std::array<juce::Slider, PhaseModulationSettings::maxOperators> fmRatioSliders, fmIndexSliders;
+    std::array<std::unique_ptr<SliderAttachment>, PhaseModulationSettings::maxOperators> fmRatioAttatchments, fmIndexAttatchments;
+    std::array<juce::Label, PhaseModulationSettings::maxOperators> fmRatioLabels, fmIndexLabels;
+    juce::Slider fmFeedbackSlider;
+    std::unique_ptr<SliderAttachment> fmFeedbackAttatchment;
+    juce::Label fmFeedbackLabel;
+    
+    //Hard sync of the selected channel
+    juce::TextButton syncButton {"Sync Off"};
+    std::unique_ptr<ButtonAttachment> syncButtonAttatchment;
+    juce::Slider syncRatioSlider;
+    std::unique_ptr<SliderAttachment> syncRatioAttatchment;
+    
+    //Scala microtuning
+    juce::TextButton tuningButton {"Tuning..."};
+    std::unique_ptr<juce::FileChooser> tuningChooser;
+    
+    //Harmonics of the custom wave
+    HarmonicEditorComponent harmonicEditor;
     juce::Label attackLabel, decayLabel, sustainLabel, releaseLabel, ladderCuttOffLabel, ladderResonanceLabel, ladderDriveLabel, volumeLabel;
     
     juce::AudioFormatManager formatManager;
@@ -19,25 +19,40 @@ MysynthpracAudioProcessor::MysynthpracAudioProcessor()
 #endif
                   .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
 #endif
-                  ),state(*this, nullptr, "parameters", { std::make_unique<juce::AudioParameterChoice>("wavetype", "WaveType", juce::StringArray{"SINE", "TRIANGLE", "SAW", "SQUARE"}, 0),
-                                                        std::make_unique<juce::AudioParameterBool>("ladderbutton", "LadderButton", false),
-                                                        std::make_unique<juce::AudioParameterChoice>("laddermode", "LadderMode", juce::StringArray{"LPF12", "HPF12", "BPF12", "LPF24", "HPF24", "BPF24"}, 0),
-                                                        std::make_unique<juce::AudioParameterFloat>("attack","Attack",juce::NormalisableRange<float> { 0.1f, 1.0f, 0.1f }, 0.1f),
-                                                        std::make_unique<juce::AudioParameterFloat>("decay","Decay",juce::NormalisableRange<float> { 0.1f, 1.0f, 0.1f }, 0.1f),
-                                                        std::make_unique<juce::AudioParameterFloat>("sustain","Sustain",juce::NormalisableRange<float> { 0.1f, 1.0f, 0.1f }, 1.0f),
-                                                        std::make_unique<juce::AudioParameterFloat>("release","Release",juce::NormalisableRange<float> { 0.1f, 3.0f, 0.1f }, 0.1f),
-                                                        std::make_unique<juce::AudioParameterFloat>("volume", "Volume", juce::NormalisableRange<float> (0.0f, 1.0f), 1.0f),
-                                                        std::make_unique<juce::AudioParameterFloat>("laddercutoff", "LadderCutOff",juce::NormalisableRange<float>(1.0f, 10000.0f,1),200.0f),
-                                                        std::make_unique<juce::AudioParameterFloat>("ladderresonance", "LadderResonance", juce::NormalisableRange<float>(0.0f, 1.0f), 0.1f),
-                                                        std::make_unique<juce::AudioParameterFloat>("ladderdrive", "LadderDrive", 1.0f, 5.0f, 1.0f)
-})
+                  ),state(*this, nullptr, "parameters", createParameterLayout())
 #endif
 
 
 {
     
-    for (auto i = 0; i < 127; ++i)synth.addVoice(new SineWaveVoice());
+    // Voices are created in prepareToPlay, so host scans and session loads don't pay for them
     synth.addSound(new SineWaveSound());
+    
+    for (int channel = 1; channel <= numMidiChannels; ++channel)
+        channelParameters[(size_t) channel - 1].attach(state, channel);
+    
+    multiTimbralParam = dynamic_cast<juce::AudioParameterBool*>(state.getParameter("multitimbral"));
+    mpeParam = dynamic_cast<juce::AudioParameterBool*>(state.getParameter("mpe"));
+    mpeBendRangeParam = state.getParameter("mpebendrange");
+    pressureDepthParam = state.getParameter("pressuredepth");
+    qualityParam = state.getParameter("quality");
+    
+    arpButtonParam = dynamic_cast<juce::AudioParameterBool*>(state.getParameter("arpbutton"));
+    arpModeParam = state.getParameter("arpmode");
+    arpRateParam = state.getParameter("arprate");
+    arpGateParam = state.getParameter("arpgate");
+    arpOctavesParam = state.getParameter("arpoctaves");
+    effectsParameters.attach(state);
+    
+    limiterButtonParam = dynamic_cast<juce::AudioParameterBool*>(state.getParameter("limiterbutton"));
+    limiterThresholdParam = state.getParameter("limiterthreshold");
+    limiterReleaseParam = state.getParameter("limiterrelease");
+    
+    // Set MYSYNTH_TRACE_FILE to record a Chrome/Perfetto timeline of this instance; each
+    // instance writes its own file next to it, named with the process ID and a count
+    auto traceFile = juce::SystemStats::getEnvironmentVariable("MYSYNTH_TRACE_FILE", {});
+    if (traceFile.isNotEmpty())
+        eventTracer.start(EventTracer::getInstanceFile(juce::File(traceFile)));
     //filter.setEnabled(true);
     //setLadderFilter();
 }
@@ -46,6 +61,232 @@ MysynthpracAudioProcessor::~MysynthpracAudioProcessor()
 {
 }
 
+juce::String MysynthpracAudioProcessor::getChannelParameterID(const juce::String& baseID, int midiChannel)
+{
+    return midiChannel == 1 ? baseID : baseID + "_ch" + juce::String(midiChannel);
+}
+
+juce::AudioProcessorValueTreeState::ParameterLayout MysynthpracAudioProcessor::createParameterLayout()
+{
+    juce::AudioProcessorValueTreeState::ParameterLayout layout;
+    
+    for (int channel = 1; channel <= numMidiChannels; ++channel)
+    {
+        auto id = [channel](const juce::String& baseID) { return getChannelParameterID(baseID, channel); };
+        auto name = [channel](const juce::String& baseName) { return channel == 1 ? baseName : baseName + " Ch" + juce::String(channel); };
+        
+        layout.add(std::make_unique<juce::AudioParameterChoice>(id("wavetype"), name("WaveType"), juce::StringArray{"SINE", "TRIANGLE", "SAW", "SQUARE", "CUSTOM"}, 0),
+                   std::make_unique<juce::AudioParameterBool>(id("ladderbutton"), name("LadderButton"), false),
+                   std::make_unique<juce::AudioParameterChoice>(id("laddermode"), name("LadderMode"), juce::StringArray{"LPF12", "HPF12", "BPF12", "LPF24", "HPF24", "BPF24"}, 0),
+                   std::make_unique<juce::AudioParameterFloat>(id("attack"), name("Attack"), juce::NormalisableRange<float> { 0.1f, 1.0f, 0.1f }, 0.1f),
+                   std::make_unique<juce::AudioParameterFloat>(id("decay"), name("Decay"), juce::NormalisableRange<float> { 0.1f, 1.0f, 0.1f }, 0.1f),
+                   std::make_unique<juce::AudioParameterFloat>(id("sustain"), name("Sustain"), juce::NormalisableRange<float> { 0.1f, 1.0f, 0.1f }, 1.0f),
+                   std::make_unique<juce::AudioParameterFloat>(id("release"), name("Release"), juce::NormalisableRange<float> { 0.1f, 3.0f, 0.1f }, 0.1f),
+                   std::make_unique<juce::AudioParameterFloat>(id("volume"), name("Volume"), juce::NormalisableRange<float> (0.0f, 1.0f), 1.0f),
+                   std::make_unique<juce::AudioParameterFloat>(id("laddercutoff"), name("LadderCutOff"), juce::NormalisableRange<float>(1.0f, 10000.0f,1), 200.0f),
+                   std::make_unique<juce::AudioParameterFloat>(id("ladderresonance"), name("LadderResonance"), juce::NormalisableRange<float>(0.0f, 1.0f), 0.1f),
+                   std::make_unique<juce::AudioParameterFloat>(id("ladderdrive"), name("LadderDrive"), 1.0f, 5.0f, 1.0f),
+                   std::make_unique<juce::AudioParameterFloat>(id("pan"), name("Pan"), juce::NormalisableRange<float>(-1.0f, 1.0f), 0.0f),
+                   std::make_unique<juce::AudioParameterFloat>(id("spread"), name("Spread"), juce::NormalisableRange<float>(0.0f, 1.0f), 0.0f),
+                   std::make_unique<juce::AudioParameterChoice>(id("velocitycurve"), name("VelocityCurve"), juce::StringArray{"LINEAR", "SOFT", "HARD", "FIXED"}, 0),
+                   std::make_unique<juce::AudioParameterChoice>(id("cutoffcurve"), name("CutoffCurve"), juce::StringArray{"LINEAR", "SOFT", "HARD", "FIXED"}, 0),
+                   std::make_unique<juce::AudioParameterFloat>(id("cutoffvelocity"), name("CutoffVelocity"), juce::NormalisableRange<float>(0.0f, 1.0f), 0.0f));
+        
+        // Phase modulation: operator 1 is the carrier, so it has a ratio but no index
+        layout.add(std::make_unique<juce::AudioParameterChoice>(id("fmoperators"), name("FMOperators"), juce::StringArray{"OFF", "2 OP", "3 OP", "4 OP"}, 0),
+                   std::make_unique<juce::AudioParameterFloat>(id("fmfeedback"), name("FMFeedback"), juce::NormalisableRange<float>(0.0f, 1.0f), 0.0f));
+        
+        for (int op = 1; op <= PhaseModulationSettings::maxOperators; ++op)
+        {
+            layout.add(std::make_unique<juce::AudioParameterFloat>(id("fmratio" + juce::String(op)), name("FMRatio" + juce::String(op)), juce::NormalisableRange<float>(0.25f, 16.0f, 0.01f, 0.4f), 1.0f));
+            
+            if (op > 1)
+                layout.add(std::make_unique<juce::AudioParameterFloat>(id("fmindex" + juce::String(op)), name("FMIndex" + juce::String(op)), juce::NormalisableRange<float>(0.0f, 10.0f, 0.01f, 0.5f), 1.0f));
+        }
+        
+        // Hard sync: the ratio is the synced wave's frequency over the note's
+        layout.add(std::make_unique<juce::AudioParameterBool>(id("syncbutton"), name("SyncButton"), false),
+                   std::make_unique<juce::AudioParameterFloat>(id("syncratio"), name("SyncRatio"), juce::NormalisableRange<float>(1.0f, 8.0f, 0.01f, 0.5f), 2.0f));
+    }
+    
+    layout.add(std::make_unique<juce::AudioParameterBool>("multitimbral", "MultiTimbral", false));
+    
+    // MPE uses the channel 1 patch for every note, so it takes over from multi-timbral mode
+    layout.add(std::make_unique<juce::AudioParameterBool>("mpe", "MPE", false),
+               std::make_unique<juce::AudioParameterFloat>("mpebendrange", "MPEBendRange", juce::NormalisableRange<float>(1.0f, 96.0f, 1.0f), 48.0f),
+               std::make_unique<juce::AudioParameterFloat>("pressuredepth", "PressureDepth", juce::NormalisableRange<float>(0.0f, 1.0f), 0.5f));
+    
+    // Offline renders always use the OFFLINE tier, so this only sets the real-time cost
+    layout.add(std::make_unique<juce::AudioParameterChoice>("quality", "Quality", juce::StringArray{"ECO", "STANDARD", "HIGH"}, 1));
+    
+    layout.add(std::make_unique<juce::AudioParameterBool>("arpbutton", "ArpButton", false),
+               std::make_unique<juce::AudioParameterChoice>("arpmode", "ArpMode", Arpeggiator::getModeNames(), 0),
+               std::make_unique<juce::AudioParameterChoice>("arprate", "ArpRate", Arpeggiator::getRateNames(), 2),
+               std::make_unique<juce::AudioParameterFloat>("arpgate", "ArpGate", juce::NormalisableRange<float>(0.05f, 1.0f), 0.5f),
+               std::make_unique<juce::AudioParameterFloat>("arpoctaves", "ArpOctaves", juce::NormalisableRange<float>(1.0f, 4.0f, 1.0f), 1.0f));
+    
+    // The effects chain runs on the summed output, so it has one set of parameters
+    layout.add(std::make_unique<juce::AudioParameterBool>("chorusbutton", "ChorusButton", false),
+               std::make_unique<juce::AudioParameterFloat>("chorusrate", "ChorusRate", juce::NormalisableRange<float>(0.05f, 10.0f, 0.0f, 0.5f), 1.0f),
+               std::make_unique<juce::AudioParameterFloat>("chorusdepth", "ChorusDepth", juce::NormalisableRange<float>(0.0f, 1.0f), 0.25f),
+               std::make_unique<juce::AudioParameterFloat>("chorusmix", "ChorusMix", juce::NormalisableRange<float>(0.0f, 1.0f), 0.5f),
+               std::make_unique<juce::AudioParameterBool>("delaybutton", "DelayButton", false),
+               std::make_unique<juce::AudioParameterFloat>("delaytime", "DelayTime", juce::NormalisableRange<float>(1.0f, (float) EffectsChain::maxDelaySeconds * 1000.0f, 1.0f, 0.5f), 375.0f),
+               std::make_unique<juce::AudioParameterFloat>("delayfeedback", "DelayFeedback", juce::NormalisableRange<float>(0.0f, 0.95f), 0.4f),
+               std::make_unique<juce::AudioParameterFloat>("delaymix", "DelayMix", juce::NormalisableRange<float>(0.0f, 1.0f), 0.3f),
+               std::make_unique<juce::AudioParameterBool>("reverbbutton", "ReverbButton", false),
+               std::make_unique<juce::AudioParameterFloat>("reverbsize", "ReverbSize", juce::NormalisableRange<float>(0.0f, 1.0f), 0.5f),
+               std::make_unique<juce::AudioParameterFloat>("reverbdamping", "ReverbDamping", juce::NormalisableRange<float>(0.0f, 1.0f), 0.5f),
+               std::make_unique<juce::AudioParameterFloat>("reverbwidth", "ReverbWidth", juce::NormalisableRange<float>(0.0f, 1.0f), 1.0f),
+               std::make_unique<juce::AudioParameterFloat>("reverbmix", "ReverbMix", juce::NormalisableRange<float>(0.0f, 1.0f), 0.25f),
+               std::make_unique<juce::AudioParameterBool>("convolutionbutton", "ConvolutionButton", false),
+               std::make_unique<juce::AudioParameterFloat>("convolutionmix", "ConvolutionMix", juce::NormalisableRange<float>(0.0f, 1.0f), 0.25f));
+    
+    // The limiter is the last thing on the master bus
+    layout.add(std::make_unique<juce::AudioParameterBool>("limiterbutton", "LimiterButton", false),
+               std::make_unique<juce::AudioParameterFloat>("limiterthreshold", "LimiterThreshold", juce::NormalisableRange<float>(-24.0f, 0.0f, 0.1f), -1.0f),
+               std::make_unique<juce::AudioParameterFloat>("limiterrelease", "LimiterRelease", juce::NormalisableRange<float>(10.0f, 1000.0f, 1.0f, 0.5f), 100.0f));
+    
+    return layout;
+}
+
+//==============================================================================
+void ChannelParameters::attach(juce::AudioProcessorValueTreeState& state, int midiChannel)
+{
+    auto get = [&](const juce::String& baseID)
+    {
+        auto param = state.getParameter(MysynthpracAudioProcessor::getChannelParameterID(baseID, midiChannel));
+        jassert(param != nullptr);
+        return param;
+    };
+    
+    waveType = get("wavetype");
+    attack = get("attack");
+    decay = get("decay");
+    sustain = get("sustain");
+    release = get("release");
+    volume = get("volume");
+    ladderButton = get("ladderbutton");
+    ladderMode = get("laddermode");
+    ladderCutoff = get("laddercutoff");
+    ladderResonance = get("ladderresonance");
+    ladderDrive = get("ladderdrive");
+    pan = get("pan");
+    spread = get("spread");
+    velocityCurve = get("velocitycurve");
+    cutoffCurve = get("cutoffcurve");
+    cutoffVelocity = get("cutoffvelocity");
+    fmOperators = get("fmoperators");
+    fmFeedback = get("fmfeedback");
+    syncButton = get("syncbutton");
+    syncRatio = get("syncratio");
+    
+    for (int op = 1; op <= PhaseModulationSettings::maxOperators; ++op)
+    {
+        fmRatios[(size_t) op - 1] = get("fmratio" + juce::String(op));
+        fmIndices[(size_t) op - 1] = op > 1 ? get("fmindex" + juce::String(op)) : nullptr;
+    }
+}
+
+PatchSettings ChannelParameters::read() const
+{
+    PatchSettings patch;
+    
+    patch.waveType = static_cast<SineWaveVoice::WaveType>((int)waveType->convertFrom0to1(waveType->getValue()));
+    
+    patch.attack = attack->getValue();
+    patch.decay = decay->getValue();
+    patch.sustain = sustain->getValue();
+    patch.release = release->convertFrom0to1(release->getValue());
+    patch.volume = volume->getValue();
+    
+    patch.ladderEnabled = ladderButton->getValue() >= 0.5f;
+    patch.ladderMode = (int)ladderMode->convertFrom0to1(ladderMode->getValue());
+    patch.ladderCutoff = ladderCutoff->convertFrom0to1(ladderCutoff->getValue());
+    patch.ladderResonance = ladderResonance->getValue();
+    patch.ladderDrive = ladderDrive->convertFrom0to1(ladderDrive->getValue());
+    
+    patch.pan = pan->convertFrom0to1(pan->getValue());
+    patch.spread = spread->getValue();
+    
+    patch.velocityCurve = static_cast<SineWaveVoice::VelocityCurve>((int)velocityCurve->convertFrom0to1(velocityCurve->getValue()));
+    patch.cutoffCurve = static_cast<SineWaveVoice::VelocityCurve>((int)cutoffCurve->convertFrom0to1(cutoffCurve->getValue()));
+    patch.cutoffVelocity = cutoffVelocity->getValue();
+    
+    // Choice 0 is off, and the rest count from 2 operators
+    auto numOperators = (int)fmOperators->convertFrom0to1(fmOperators->getValue());
+    patch.phaseModulation.numOperators = numOperators > 0 ? numOperators + 1 : 0;
+    patch.phaseModulation.feedback = fmFeedback->getValue();
+    
+    for (size_t op = 0; op < fmRatios.size(); ++op)
+    {
+        patch.phaseModulation.ratios[op] = fmRatios[op]->convertFrom0to1(fmRatios[op]->getValue());
+        
+        if (fmIndices[op] != nullptr)
+            patch.phaseModulation.indices[op] = fmIndices[op]->convertFrom0to1(fmIndices[op]->getValue());
+    }
+    
+    patch.syncEnabled = syncButton->getValue() >= 0.5f;
+    patch.syncRatio = syncRatio->convertFrom0to1(syncRatio->getValue());
+    
+    return patch;
+}
+
+//==============================================================================
+void EffectsParameters::attach(juce::AudioProcessorValueTreeState& state)
+{
+    auto get = [&](const juce::String& parameterID)
+    {
+        auto param = state.getParameter(parameterID);
+        jassert(param != nullptr);
+        return param;
+    };
+    
+    chorusButton = get("chorusbutton");
+    chorusRate = get("chorusrate");
+    chorusDepth = get("chorusdepth");
+    chorusMix = get("chorusmix");
+    delayButton = get("delaybutton");
+    delayTime = get("delaytime");
+    delayFeedback = get("delayfeedback");
+    delayMix = get("delaymix");
+    reverbButton = get("reverbbutton");
+    reverbSize = get("reverbsize");
+    reverbDamping = get("reverbdamping");
+    reverbWidth = get("reverbwidth");
+    reverbMix = get("reverbmix");
+    convolutionButton = get("convolutionbutton");
+    convolutionMix = get("convolutionmix");
+}
+
+EffectsSettings EffectsParameters::read() const
+{
+    auto plain = [](const juce::RangedAudioParameter* param) { return param->convertFrom0to1(param->getValue()); };
+    
+    EffectsSettings settings;
+    
+    settings.chorusEnabled = chorusButton->getValue() >= 0.5f;
+    settings.chorusRate = plain(chorusRate);
+    settings.chorusDepth = plain(chorusDepth);
+    settings.chorusMix = plain(chorusMix);
+    
+    settings.delayEnabled = delayButton->getValue() >= 0.5f;
+    settings.delayTimeMs = plain(delayTime);
+    settings.delayFeedback = plain(delayFeedback);
+    settings.delayMix = plain(delayMix);
+    
+    settings.reverbEnabled = reverbButton->getValue() >= 0.5f;
+    settings.reverbSize = plain(reverbSize);
+    settings.reverbDamping = plain(reverbDamping);
+    settings.reverbWidth = plain(reverbWidth);
+    settings.reverbMix = plain(reverbMix);
+    
+    settings.convolutionEnabled = convolutionButton->getValue() >= 0.5f;
+    settings.convolutionMix = plain(convolutionMix);
+    
+    return settings;
+}
+
 
 //==============================================================================
 const juce::String MysynthpracAudioProcessor::getName() const
@@ -82,7 +323,14 @@ bool MysynthpracAudioProcessor::isMidiEffect() const
 
 double MysynthpracAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    // Voices keep sounding for their release after the last note-off, then the effects ring out
+    auto numPatches = multiTimbralParam->get() && !mpeParam->get() ? numMidiChannels : 1;
+    auto release = 0.0f;
+    
+    for (int i = 0; i < numPatches; ++i)
+        release = juce::jmax(release, channelParameters[(size_t) i].read().release);
+    
+    return release + effects.getTailLengthSeconds(effectsParameters.read());
 }
 
 int MysynthpracAudioProcessor::getNumPrograms()
@@ -114,8 +362,31 @@ void MysynthpracAudioProcessor::prepareToPlay (double sampleRate, int samplesPer
 {
     // Use this method as the place to do any pre-playback
     // initialisation that you need..
+    
+    // The render thread may still be finishing the last block, so stop it before touching the voices
+    anticipativeRenderer.release();
+    harmonicTable.prepare();
+    
+    // Built once per process, here rather than on the audio thread when a voice first needs them
+    BasicWaveforms::getHighResolutionTables();
+    BasicWaveforms::getSyncTables();
+    BandLimitedStep::getResidual();
+    
+    if (synth.getNumVoices() == 0)
+    {
+        for (auto i = 0; i < numVoices; ++i)
+            synth.addVoice(new SineWaveVoice(wavetables, &harmonicTable));
+        
+        synth.setEventTracer(&eventTracer);
+    }
+    
+    // Every MIDI event in a micro-block is applied at its start, so each voice renders it in one go
+    synth.setMinimumRenderingSubdivisionSize(microBlockSize, true);
     synth.setCurrentPlaybackSampleRate(sampleRate);
     
+    for (int i = 0; i < synth.getNumVoices(); ++i)
+        if (auto voice = dynamic_cast<SineWaveVoice*>(synth.getVoice(i)))
+            voice->prepareToPlay(sampleRate);
     
     cachedBuffer.setSize(1, samplesPerBlock);
     
@@ -123,17 +394,43 @@ void MysynthpracAudioProcessor::prepareToPlay (double sampleRate, int samplesPer
     juce::dsp::ProcessSpec spec;
     spec.sampleRate = sampleRate;
     spec.numChannels = 2;
-    spec.maximumBlockSize = samplesPerBlock;
+    spec.maximumBlockSize = microBlockSize;
+    
+    for (auto& filter : filters)
+        filter.prepare(spec);
+    
+    spec.numChannels = (juce::uint32) juce::jmin(2, getTotalNumOutputChannels());
+    effects.setSettings(effectsParameters.read());
+    effects.prepare(spec);
     
-    filter.prepare(spec);
+    limiter.prepare(sampleRate, getTotalNumOutputChannels(), samplesPerBlock);
+    limiter.setLookahead(isLimiterLookahead());
+    
+    synth.prepareChannelBuses(getTotalNumOutputChannels(), microBlockSize);
+    microBlockMidi.ensureSize(4096 * 16);
+    arpeggiator.prepare(sampleRate);
+    channelWasActive.fill(false);
+    liveMidiInput->prepare(sampleRate, samplesPerBlock);
+    liveMidi.ensureSize(4096 * 16);
+    liveMidiInput->setJitterBufferMs(getLiveMidiJitterBufferMs());
+    
+    lastParameterValues.clearQuick();
+    for (auto* param : getParameters())
+        lastParameterValues.add(param->getValue());
+    
+    preparedBlockSize = samplesPerBlock;
+    
+    if (isAnticipativeRendering())
+        startAnticipativeRendering();
+    
+    updateLatency();
 }
 
 void MysynthpracAudioProcessor::releaseResources()
 {
     // When playback stops, you can use this as an opportunity to free up any
     // spare memory, etc.
-    //synthAudioSource.releaseResources();
-    
+    anticipativeRenderer.release();
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -165,53 +462,83 @@ bool MysynthpracAudioProcessor::isBusesLayoutSupported (const BusesLayout& layou
 void MysynthpracAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
     juce::ScopedNoDenormals noDenormals;
+    RealtimeSafetyChecker::ScopedRealtimeSection realtimeSection;
+    eventTracer.record(EventTracer::EventType::blockBegin, 0, -1, -1, (float)buffer.getNumSamples());
+    
     auto totalNumInputChannels  = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
     
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear (i, 0, buffer.getNumSamples());
 
-    auto releaseParam = state.getParameter("release");
+    if (eventTracer.isTracing())
+    {
+        auto& params = getParameters();
+        
+        for (int i = 0; i < juce::jmin(params.size(), lastParameterValues.size()); ++i)
+        {
+            auto value = params[i]->getValue();
+            
+            if (value != lastParameterValues[i])
+            {
+                eventTracer.record(EventTracer::EventType::parameterChange, 0, i, -1, value);
+                lastParameterValues.set(i, value);
+            }
+        }
+    }
     
-    auto attack = state.getParameter("attack")->getValue();
-    auto decay = state.getParameter("decay")->getValue();
-    auto sustain = state.getParameter("sustain")->getValue();
-    auto release = releaseParam->convertFrom0to1(releaseParam->getValue());
+    // Notes played live join the host's before the arpeggiator sees them. They are merged in a
+    // buffer sized in prepareToPlay, as the host's may have no room for them
+    auto* midi = &midiMessages;
     
-    auto masterVolume = state.getParameter("volume")->getValue();
-
-    int n = (int)*state.getRawParameterValue("wavetype");
-    //DBG(n);
-    //std::cout << n << std::endl;
+    if (liveMidiEnabled.load() && ! isNonRealtime())
+    {
+        liveMidi.clear();
+        liveMidi.addEvents(midiMessages, 0, -1, 0);
+        liveMidiInput->removeNextBlockOfMessages(liveMidi, buffer.getNumSamples());
+        midi = &liveMidi;
+    }
     
-    auto type = static_cast<SineWaveVoice::WaveType>(n);
-    //DBG(type);
-    //std::cout << type << std::endl;
+    // The arpeggiator rewrites the incoming notes, and without live input its output is also the plugin's MIDI out
+    arpeggiator.process(*midi, buffer.getNumSamples(), readArpSettings(), readTransport());
+    effects.setSettings(effectsParameters.read());
     
+    auto numSamples = buffer.getNumSamples();
     
-    for (int i = 0; i < synth.getNumVoices(); ++i)
+    if (anticipativeRenderer.isActive())
     {
-        if (auto voice = dynamic_cast<SineWaveVoice*>(synth.getVoice(i)))
+        // What comes out now was rendered from earlier blocks' MIDI; this block's
+        // voices render in the background over the next few callbacks
+        auto chunkSize = anticipativeRenderer.getBlockSize();
+        
+        for (int start = 0; start < numSamples; start += chunkSize)
         {
-            //std::cout << n << std::endl;
-            //DBG(type);
-            voice->setWaveType(type);
-            voice->setVolume(masterVolume);
-            voice->setADSRParameters(attack, decay, sustain, release);
-            //DBG(voice.);
+            auto numThisTime = juce::jmin(chunkSize, numSamples - start);
+            
+            anticipativeRenderer.collect(buffer, start, numThisTime);
+            readRenderSettings();
+            anticipativeRenderer.submit(*midi, start, numThisTime, renderSettings);
         }
     }
-
-
+    else
+    {
+        readRenderSettings();
+        renderVoices(buffer, *midi, numSamples, renderSettings);
+    }
+    
+    for (int start = 0; start < numSamples; start += microBlockSize)
+        effects.process(buffer, start, juce::jmin(microBlockSize, numSamples - start));
     
-    synth.renderNextBlock(buffer, midiMessages, 0, buffer.getNumSamples());
+    limiter.setParameters(limiterButtonParam->get(),
+                          limiterThresholdParam->convertFrom0to1(limiterThresholdParam->getValue()),
+                          limiterReleaseParam->convertFrom0to1(limiterReleaseParam->getValue()));
+    limiter.process(buffer, 0, numSamples);
     
-    juce::dsp::AudioBlock<float> block{buffer};
-    setLadderFilter();
-    filter.process(juce::dsp::ProcessContextReplacing<float>(block));
-    //DBG((int)*state.getRawParameterValue("ladderbutton"));
+    // The host's block can be bigger than the one prepareToPlay was told about
+    auto numToCache = juce::jmin(buffer.getNumSamples(), cachedBuffer.getNumSamples());
+    cachedBuffer.copyFrom(0, 0, buffer, 0, buffer.getNumSamples() - numToCache, numToCache);
     
-    cachedBuffer.copyFrom(0, 0, buffer, 0, 0, buffer.getNumSamples());
+    eventTracer.record(EventTracer::EventType::blockEnd);
 }
 
 //==============================================================================
@@ -231,12 +558,305 @@ void MysynthpracAudioProcessor::getStateInformation (juce::MemoryBlock& destData
     // You should use this method to store your parameters in the memory block.
     // You could do that either as raw data, or use the XML or ValueTree classes
     // as intermediaries to make it easy to save and load complex data.
+    if (auto xml = state.copyState().createXml())
+        copyXmlToBinary(*xml, destData);
 }
 
 void MysynthpracAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
     // You should use this method to restore your parameters from this memory block,
     // whose contents will have been created by the getStateInformation() call.
+    if (auto xml = getXmlFromBinary(data, sizeInBytes))
+    {
+        if (xml->hasTagName(state.state.getType()))
+        {
+            state.replaceState(juce::ValueTree::fromXml(*xml));
+            
+            auto impulsePath = state.state.getProperty(impulseResponseProperty).toString();
+            if (impulsePath.isNotEmpty())
+                effects.getConvolver().loadImpulseResponse(juce::File(impulsePath));
+            
+            arpeggiator.setPattern(Arpeggiator::patternFromString(state.state.getProperty(arpPatternProperty).toString()));
+            harmonicTable.setHarmonics(HarmonicWavetable::harmonicsFromString(state.state.getProperty(harmonicsProperty).toString()));
+            
+            auto scaleText = state.state.getProperty(tuningScaleProperty).toString();
+            if (scaleText.isEmpty() || tuning.setTuning(scaleText, state.state.getProperty(tuningMappingProperty).toString()).failed())
+                tuning.setEqualTemperament();
+            
+            liveMidiInput->setJitterBufferMs(getLiveMidiJitterBufferMs());
+            
+            updateAnticipativeRendering();
+            updateLimiterLookahead();
+            updateLatency();
+        }
+    }
+}
+
+void MysynthpracAudioProcessor::setArpPattern(const ArpPattern& pattern)
+{
+    state.state.setProperty(arpPatternProperty, Arpeggiator::patternToString(pattern), nullptr);
+    arpeggiator.setPattern(pattern);
+}
+
+void MysynthpracAudioProcessor::readRenderSettings()
+{
+    auto& voiceSettings = renderSettings.voice;
+    voiceSettings.mpe = mpeParam->get();
+    voiceSettings.mpeBendRange = mpeBendRangeParam->convertFrom0to1(mpeBendRangeParam->getValue());
+    voiceSettings.pressureDepth = pressureDepthParam->getValue();
+    voiceSettings.multiTimbral = multiTimbralParam->get() && !voiceSettings.mpe;
+    voiceSettings.quality = isNonRealtime() ? SineWaveVoice::OFFLINE
+                                            : static_cast<SineWaveVoice::Quality>((int)qualityParam->convertFrom0to1(qualityParam->getValue()));
+    
+    auto numPatches = voiceSettings.multiTimbral ? numMidiChannels : 1;
+    
+    for (int i = 0; i < numPatches; ++i)
+        renderSettings.patches[(size_t) i] = channelParameters[(size_t) i].read();
+}
+
+void MysynthpracAudioProcessor::renderVoices(juce::AudioBuffer<float>& buffer, const juce::MidiBuffer& midi, int numSamples, const RenderSettings& settings)
+{
+    HarmonicWavetable::ScopedBlock customTableBlock(harmonicTable);
+    
+    auto& voiceSettings = settings.voice;
+    auto multiTimbral = voiceSettings.multiTimbral;
+    
+    // Only this thread reads the tuning, and the table it gets stays put until its next read
+    auto& frequencies = tuning.getFrequencies();
+    synth.setTuning(&frequencies);
+    
+    for (int i = 0; i < synth.getNumVoices(); ++i)
+    {
+        if (auto voice = dynamic_cast<SineWaveVoice*>(synth.getVoice(i)))
+        {
+            auto& patch = settings.patches[multiTimbral ? (size_t) voice->getMidiChannel() - 1 : 0];
+            
+            voice->setQuality(voiceSettings.quality);
+            voice->setWaveType(patch.waveType);
+            voice->setVolume(patch.volume);
+            voice->setADSRParameters(patch.attack, patch.decay, patch.sustain, patch.release);
+            voice->setPan(patch.pan, patch.spread);
+            voice->setVelocityCurves(patch.velocityCurve, patch.cutoffCurve, patch.cutoffVelocity);
+            voice->setPhaseModulation(patch.phaseModulation);
+            voice->setHardSync(patch.syncEnabled, patch.syncRatio);
+            voice->setTuning(&frequencies);
+            voice->setExpressionSettings(voiceSettings.mpe, voiceSettings.mpeBendRange, voiceSettings.pressureDepth);
+        }
+    }
+    
+    synth.setMultiTimbral(multiTimbral);
+    synth.setMPE(voiceSettings.mpe);
+    
+    for (int start = 0; start < numSamples; start += microBlockSize)
+        renderMicroBlock(buffer, midi, start, juce::jmin(microBlockSize, numSamples - start), settings);
+}
+
+void MysynthpracAudioProcessor::renderMicroBlock(juce::AudioBuffer<float>& buffer, const juce::MidiBuffer& midi, int startSample, int numSamples, const RenderSettings& settings)
+{
+    // The synth handles every event in the buffer it's given, so it only gets this micro-block's
+    microBlockMidi.clear();
+    microBlockMidi.addEvents(midi, startSample, numSamples, 0);
+    
+    synth.beginBlock(startSample, numSamples);
+    synth.renderNextBlock(buffer, microBlockMidi, startSample, numSamples);
+    
+    auto block = juce::dsp::AudioBlock<float>(buffer).getSubBlock((size_t) startSample, (size_t) numSamples);
+    
+    if (settings.voice.multiTimbral)
+    {
+        // Each channel is filtered on its own bus, then summed into the output
+        for (int i = 0; i < numMidiChannels; ++i)
+        {
+            auto& filter = filters[(size_t) i];
+            auto bus = synth.getActiveChannelBus(i);
+            
+            if (bus == nullptr)
+            {
+                if (channelWasActive[(size_t) i])
+                    filter.reset();
+                
+                channelWasActive[(size_t) i] = false;
+                continue;
+            }
+            
+            auto busBlock = juce::dsp::AudioBlock<float>(*bus).getSubBlock(0, (size_t) numSamples);
+            setLadderFilter(filter, settings.patches[(size_t) i]);
+            filter.process(juce::dsp::ProcessContextReplacing<float>(busBlock));
+            
+            for (int ch = 0; ch < juce::jmin(buffer.getNumChannels(), bus->getNumChannels()); ++ch)
+                buffer.addFrom(ch, startSample, *bus, ch, 0, numSamples);
+            
+            channelWasActive[(size_t) i] = true;
+        }
+    }
+    else
+    {
+        setLadderFilter(filters[0], settings.patches[0]);
+        filters[0].process(juce::dsp::ProcessContextReplacing<float>(block));
+    }
+}
+
+void MysynthpracAudioProcessor::setHarmonics(const HarmonicWavetable::Harmonics& harmonics)
+{
+    state.state.setProperty(harmonicsProperty, HarmonicWavetable::harmonicsToString(harmonics), nullptr);
+    harmonicTable.setHarmonics(harmonics);
+}
+
+juce::Result MysynthpracAudioProcessor::loadTuning(const juce::File& scaleFile, const juce::File& mappingFile)
+{
+    auto scaleText = scaleFile.loadFileAsString();
+    auto mappingText = mappingFile.existsAsFile() ? mappingFile.loadFileAsString() : juce::String();
+    auto result = tuning.setTuning(scaleText, mappingText);
+    
+    if (result.wasOk())
+    {
+        state.state.setProperty(tuningScaleProperty, scaleText, nullptr);
+        state.state.setProperty(tuningMappingProperty, mappingText, nullptr);
+    }
+    
+    return result;
+}
+
+void MysynthpracAudioProcessor::resetTuning()
+{
+    state.state.removeProperty(tuningScaleProperty, nullptr);
+    state.state.removeProperty(tuningMappingProperty, nullptr);
+    tuning.setEqualTemperament();
+}
+
+void MysynthpracAudioProcessor::setAnticipativeRendering(bool shouldRenderAhead)
+{
+    state.state.setProperty(anticipativeProperty, shouldRenderAhead, nullptr);
+    updateAnticipativeRendering();
+}
+
+bool MysynthpracAudioProcessor::isAnticipativeRendering() const
+{
+    return state.state.getProperty(anticipativeProperty, false);
+}
+
+void MysynthpracAudioProcessor::updateAnticipativeRendering()
+{
+    // Before prepareToPlay there's nothing to switch; it picks the setting up itself
+    if (preparedBlockSize == 0 || isAnticipativeRendering() == anticipativeRenderer.isActive())
+        return;
+    
+    suspendProcessing(true);
+    
+    if (isAnticipativeRendering())
+        startAnticipativeRendering();
+    else
+        anticipativeRenderer.release();
+    
+    updateLatency();
+    suspendProcessing(false);
+}
+
+void MysynthpracAudioProcessor::setLimiterLookahead(bool shouldLookAhead)
+{
+    state.state.setProperty(limiterLookaheadProperty, shouldLookAhead, nullptr);
+    updateLimiterLookahead();
+}
+
+bool MysynthpracAudioProcessor::isLimiterLookahead() const
+{
+    return state.state.getProperty(limiterLookaheadProperty, false);
+}
+
+void MysynthpracAudioProcessor::updateLimiterLookahead()
+{
+    if (preparedBlockSize == 0 || isLimiterLookahead() == limiter.isLookingAhead())
+        return;
+    
+    suspendProcessing(true);
+    limiter.setLookahead(isLimiterLookahead());
+    updateLatency();
+    suspendProcessing(false);
+}
+
+void MysynthpracAudioProcessor::updateLatency()
+{
+    auto latency = limiter.getLatencySamples();
+    
+    if (anticipativeRenderer.isActive())
+        latency += anticipativeRenderer.getLatencySamples();
+    
+    // Everything after the live input's placement counts towards its MIDI-to-sound latency
+    liveMidiInput->setOutputLatencySamples(latency);
+    
+    // Live notes are held back by the jitter buffer before they reach the voices
+    if (liveMidiEnabled.load())
+        latency += juce::roundToInt(getLiveMidiJitterBufferMs() * 0.001 * getSampleRate());
+    
+    setLatencySamples(latency);
+}
+
+void MysynthpracAudioProcessor::setLiveMidiInputEnabled(bool shouldBeEnabled)
+{
+    liveMidiEnabled = shouldBeEnabled;
+    updateLatency();
+}
+
+void MysynthpracAudioProcessor::setLiveMidiJitterBufferMs(double newJitterBufferMs)
+{
+    state.state.setProperty(liveMidiJitterProperty, juce::jmax(0.0, newJitterBufferMs), nullptr);
+    liveMidiInput->setJitterBufferMs(getLiveMidiJitterBufferMs());
+    updateLatency();
+}
+
+double MysynthpracAudioProcessor::getLiveMidiJitterBufferMs() const
+{
+    return state.state.getProperty(liveMidiJitterProperty, 0.0);
+}
+
+void MysynthpracAudioProcessor::startAnticipativeRendering()
+{
+    // A block's voices have a couple of callbacks to render, so one slow render doesn't underrun
+    anticipativeRenderer.prepare(getTotalNumOutputChannels(), preparedBlockSize, anticipativeBlocksAhead,
+                                 [this](juce::AudioBuffer<float>& buffer, const juce::MidiBuffer& midi, int numSamples, const RenderSettings& settings)
+                                 {
+                                     renderVoices(buffer, midi, numSamples, settings);
+                                 });
+}
+
+Arpeggiator::Settings MysynthpracAudioProcessor::readArpSettings() const
+{
+    Arpeggiator::Settings settings;
+    settings.enabled = arpButtonParam->get();
+    settings.mode = static_cast<Arpeggiator::Mode>((int)arpModeParam->convertFrom0to1(arpModeParam->getValue()));
+    settings.rate = (int)arpRateParam->convertFrom0to1(arpRateParam->getValue());
+    settings.gate = arpGateParam->convertFrom0to1(arpGateParam->getValue());
+    settings.octaves = (int)arpOctavesParam->convertFrom0to1(arpOctavesParam->getValue());
+    return settings;
+}
+
+Arpeggiator::Transport MysynthpracAudioProcessor::readTransport() const
+{
+    Arpeggiator::Transport transport;
+    
+    if (auto* playHead = getPlayHead())
+    {
+        if (auto position = playHead->getPosition())
+        {
+            if (auto bpm = position->getBpm())
+                transport.bpm = *bpm;
+            
+            if (auto ppq = position->getPpqPosition())
+            {
+                transport.ppqPosition = *ppq;
+                transport.isPlaying = position->getIsPlaying();
+            }
+        }
+    }
+    
+    return transport;
+}
+
+void MysynthpracAudioProcessor::loadImpulseResponse(const juce::File& file)
+{
+    // Stored alongside the parameters, so the IR comes back with the session
+    state.state.setProperty(impulseResponseProperty, file.getFullPathName(), nullptr);
+    effects.getConvolver().loadImpulseResponse(file);
 }
 
 //==============================================================================
@@ -246,22 +866,12 @@ juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
     return new MysynthpracAudioProcessor();
 }
 
-void MysynthpracAudioProcessor::setLadderFilter()
+void MysynthpracAudioProcessor::setLadderFilter(StereoLadderFilter& filter, const PatchSettings& patch)
 {
-    switch ((int)*state.getRawParameterValue("ladderbutton"))
-    {
-    case 0:
-        filter.setEnabled(false);
-        break;
-    case 1:
-        filter.setEnabled(true);
-        break;
-    default:
-        filter.setEnabled(false);
-        break;
-    }
+    // The filter ignores values that haven't changed, so this is cheap to call every block
+    filter.setEnabled(patch.ladderEnabled);
 
-    switch ((int)*state.getRawParameterValue("laddermode"))
+    switch (patch.ladderMode)
     {
     case 0:
         filter.setMode(juce::dsp::LadderFilterMode::LPF12);
@@ -285,11 +895,9 @@ void MysynthpracAudioProcessor::setLadderFilter()
         filter.setMode(juce::dsp::LadderFilterMode::LPF12);
         break;
     }
-    auto cutoffparam =state.getParameter("laddercutoff");
-    auto driveParam = state.getParameter("ladderdrive");
     
-    filter.setCutoffFrequencyHz(cutoffparam->convertFrom0to1(cutoffparam->getValue()));
-    filter.setResonance(state.getParameter("ladderresonance")->getValue());
-    filter.setDrive(driveParam->convertFrom0to1(driveParam->getValue()));
+    filter.setCutoffFrequencyHz(patch.ladderCutoff);
+    filter.setResonance(patch.ladderResonance);
+    filter.setDrive(patch.ladderDrive);
    
-}
+}
\ No newline at end of file
@@ -9,6 +9,19 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "EventTracer.h"
+#include "LiveMidiInput.h"
+#include "StereoLadderFilter.h"
+#include "RealtimeSafetyChecker.h"
+#include "EffectsChain.h"
+#include "Arpeggiator.h"
+#include "HarmonicWavetable.h"
+#include "AnticipativeRenderer.h"
+#include "MasterLimiter.h"
+#include "PhaseModulation.h"
+#include "HardSync.h"
+#include "SimdKernels.h"
+#include "TuningTable.h"
 
 
 
@@ -19,11 +32,19 @@
 class WavetableOscillator
 {
 public:
-    WavetableOscillator (juce::AudioSampleBuffer& wavetableToUse)
-    : wavetable (wavetableToUse),
-    tableSize (wavetable.getNumSamples() - 1)
+    /** The quality tiers' interpolation. getNextSample() takes it at compile time so its loop has no branches. */
+    using Interpolation = SimdKernels::Interpolation;
+    
+    /** numSamples includes the guard sample at the end, which must repeat the first.
+        The table size without it must be a power of two.
+    */
+    WavetableOscillator (const float* samples, int numSamples)
+    : table (samples),
+    tableSize (numSamples - 1),
+    mask (tableSize - 1),
+    kernels (SimdKernels::get())
     {
-        jassert (wavetable.getNumChannels() == 1);
+        jassert (juce::isPowerOfTwo (tableSize));
     }
     
     void setFrequency (float frequency, float sampleRate)
@@ -32,19 +53,40 @@ public:
         tableDelta = frequency * tableSizeOverSampleRate;
     }
     
+    template <Interpolation interpolation = Interpolation::linear>
     forcedinline float getNextSample() noexcept
     {
         
         auto index0 = (unsigned int) currentIndex;
-        auto index1 = index0 + 1;
-        
         auto frac = currentIndex - (float) index0;
+        float currentSample;
         
-        auto* table = wavetable.getReadPointer (0);
-        auto value0 = table[index0];
-        auto value1 = table[index1];
-        
-        auto currentSample = value0 + frac * (value1 - value0);
+        if constexpr (interpolation == Interpolation::nearest)
+        {
+            // The guard sample covers rounding up past the end
+            currentSample = table[(unsigned int) (currentIndex + 0.5f)];
+        }
+        else if constexpr (interpolation == Interpolation::linear)
+        {
+            auto value0 = table[index0];
+            auto value1 = table[index0 + 1];
+            
+            currentSample = value0 + frac * (value1 - value0);
+        }
+        else
+        {
+            // 4-point, 3rd-order Hermite
+            auto ym1 = table[(index0 - 1) & mask];
+            auto y0 = table[index0 & mask];
+            auto y1 = table[(index0 + 1) & mask];
+            auto y2 = table[(index0 + 2) & mask];
+            
+            auto c1 = 0.5f * (y1 - ym1);
+            auto c2 = ym1 - 2.5f * y0 + 2.0f * y1 - 0.5f * y2;
+            auto c3 = 0.5f * (y2 - ym1) + 1.5f * (y0 - y1);
+            
+            currentSample = ((c3 * frac + c2) * frac + c1) * frac + y0;
+        }
         
         if ((currentIndex += tableDelta) > (float) tableSize)
             currentIndex -= (float) tableSize;
@@ -52,24 +94,226 @@ public:
         return currentSample;
     }
     
+    /** Renders a block at once with the kernel for this CPU, which is much faster than getNextSample(). */
+    void render (Interpolation interpolation, float* output, int numSamples) noexcept
+    {
+        currentIndex = kernels.renderWavetable[(size_t) interpolation] (table, tableSize, currentIndex, tableDelta, output, numSamples);
+    }
+    
+    const float* getTable() const noexcept     { return table; }
+    
+    /** Without the guard sample. */
+    int getTableSize() const noexcept          { return tableSize; }
+    
+    // Only repoints the oscillator, so it is safe to call from the audio thread
+    void setWavetable(const float* samples, int numSamples)
+    {
+        table = samples;
+        auto newTableSize = numSamples - 1;
+        jassert (juce::isPowerOfTwo (newTableSize));
+        
+        // Keep the phase and pitch when moving between tables of different sizes
+        if (newTableSize != tableSize)
+        {
+            auto scale = (float) newTableSize / (float) tableSize;
+            currentIndex *= scale;
+            tableDelta *= scale;
+            tableSize = newTableSize;
+            mask = (unsigned int) tableSize - 1;
+        }
+    }
+    
     void setWavetable(const juce::AudioSampleBuffer& wavetableToUse)
     {
         jassert (wavetableToUse.getNumChannels() == 1);
-        
-        wavetable = wavetableToUse;
-        tableSize = wavetable.getNumSamples() - 1;
-        
+        setWavetable(wavetableToUse.getReadPointer(0), wavetableToUse.getNumSamples());
     }
     
-    juce::AudioSampleBuffer& getWavetable()
+    template <size_t numSamples>
+    void setWavetable(const std::array<float, numSamples>& wavetableToUse)
     {
-        return wavetable;
+        setWavetable(wavetableToUse.data(), (int) numSamples);
     }
     
 private:
-    juce::AudioSampleBuffer& wavetable;
+    const float* table;
     int tableSize;
+    unsigned int mask;
     float currentIndex = 0.0f, tableDelta = 0.0f;
+    const SimdKernels::Kernels& kernels;
+};
+
+/** Single-cycle tables of the basic shapes, computed at compile time. Every
+    voice of every instance reads the same constant data, so creating a
+    processor costs nothing for them.
+*/
+namespace BasicWaveforms
+{
+    constexpr int tableSize = 1 << 7;
+    
+    // The last sample repeats the first, for interpolation
+    using Table = std::array<float, tableSize + 1>;
+    
+    constexpr double floorPositive(double x)
+    {
+        return (double) (long long) x;
+    }
+    
+    constexpr double sine(double phase)
+    {
+        constexpr double pi = 3.141592653589793238;
+        auto x = 2.0 * pi * (phase > 0.5 ? phase - 1.0 : phase);
+        
+        // Taylor series to x^27, good to ~1e-15 over -pi..pi
+        auto term = x, sum = x;
+        for (int n = 1; n < 14; ++n)
+        {
+            term *= -x * x / (double) ((2 * n) * (2 * n + 1));
+            sum += term;
+        }
+        return sum;
+    }
+    
+    template <typename Shape>
+    constexpr Table makeTable(Shape shape)
+    {
+        Table table {};
+        for (int i = 0; i < tableSize; ++i)
+            table[(size_t) i] = (float) shape((double) i / (double) tableSize);
+        table[(size_t) tableSize] = table[0];
+        return table;
+    }
+    
+    inline constexpr Table sineTable = makeTable([](double x) { return sine(x); });
+    inline constexpr Table sawTable = makeTable([](double x) { return 2.0 * (x - floorPositive(0.5 + x)); });
+    inline constexpr Table squareTable = makeTable([](double x) { return 2.0 * (2.0 * floorPositive(x) - floorPositive(2.0 * x)) + 1.0; });
+    inline constexpr Table triTable = makeTable([](double x)
+    {
+        auto y = x - floorPositive(x + 0.75) + 0.25;
+        return 4.0 * (y < 0.0 ? -y : y) - 1.0;
+    });
+    
+    constexpr int highResolutionSize = 1 << 11;
+    using HighResolutionTable = std::array<float, highResolutionSize + 1>;
+    
+    struct HighResolutionTables
+    {
+        HighResolutionTable sine, triangle, saw, square;
+    };
+    
+    namespace Series
+    {
+        constexpr double pi = 3.141592653589793238;
+        
+        // The weight of sin(2 pi n x) in each shape
+        inline double sine(int n)      { return n == 1 ? 1.0 : 0.0; }
+        inline double saw(int n)       { return (n % 2 == 1 ? 2.0 : -2.0) / (pi * n); }
+        inline double square(int n)    { return n % 2 == 1 ? 4.0 / (pi * n) : 0.0; }
+        inline double triangle(int n)  { return n % 2 == 1 ? ((n / 2) % 2 == 0 ? 8.0 : -8.0) / (pi * pi * n * n) : 0.0; }
+        
+        /** A shape's Fourier series up to numHarmonics, at 2048 samples. */
+        template <typename Amplitude>
+        HighResolutionTable make(Amplitude amplitude, int numHarmonics)
+        {
+            HighResolutionTable table {};
+            
+            for (int i = 0; i < highResolutionSize; ++i)
+            {
+                auto x = (double) i / (double) highResolutionSize;
+                auto sum = 0.0;
+                
+                for (int n = 1; n <= numHarmonics; ++n)
+                    sum += amplitude(n) * std::sin(2.0 * pi * n * x);
+                
+                table[(size_t) i] = (float) sum;
+            }
+            
+            table[(size_t) highResolutionSize] = table[0];
+            return table;
+        }
+    }
+    
+    /** The shapes again at 2048 samples, for the HIGH and OFFLINE quality tiers. They are
+        summed from each shape's Fourier series up to the harmonics the 128-sample tables
+        hold, so they sound the same without the small tables' folded-back harmonics.
+        Built on first use, which should not be on the audio thread.
+    */
+    inline const HighResolutionTables& getHighResolutionTables()
+    {
+        static const HighResolutionTables tables = []
+        {
+            constexpr int numHarmonics = tableSize / 2;
+            
+            HighResolutionTables t;
+            t.sine = Series::make(Series::sine, numHarmonics);
+            t.saw = Series::make(Series::saw, numHarmonics);
+            t.square = Series::make(Series::square, numHarmonics);
+            t.triangle = Series::make(Series::triangle, numHarmonics);
+            return t;
+        }();
+        
+        return tables;
+    }
+    
+    /** Mip levels of the triangle, saw and square for a hard-synced slave, which plays up to
+        8 times above the note. Level n holds the first 64 >> n harmonics, the same as the
+        128-sample tables at level 0, so a slave read from the level picked for its own
+        frequency has nothing above Nyquist. Built on first use, which should not be on the
+        audio thread.
+    */
+    struct SyncTables
+    {
+        static constexpr int numHarmonics = tableSize / 2;
+        static constexpr int numLevels = 7;
+        
+        using Levels = std::array<HighResolutionTable, numLevels>;
+        Levels triangle, saw, square;
+        
+        /** The fullest level whose harmonics all stay below Nyquist at this frequency. */
+        static const HighResolutionTable& select(const Levels& levels, float frequency, double sampleRate) noexcept
+        {
+            auto harmonicsBelowNyquist = (int) (0.5 * sampleRate / juce::jmax(1.0f, frequency));
+            auto level = 0;
+            
+            while (level < numLevels - 1 && (numHarmonics >> level) > harmonicsBelowNyquist)
+                ++level;
+            
+            return levels[(size_t) level];
+        }
+    };
+    
+    inline const SyncTables& getSyncTables()
+    {
+        static const SyncTables tables = []
+        {
+            SyncTables t;
+            
+            for (int level = 0; level < SyncTables::numLevels; ++level)
+            {
+                auto numHarmonics = SyncTables::numHarmonics >> level;
+                t.triangle[(size_t) level] = Series::make(Series::triangle, numHarmonics);
+                t.saw[(size_t) level] = Series::make(Series::saw, numHarmonics);
+                t.square[(size_t) level] = Series::make(Series::square, numHarmonics);
+            }
+            
+            return t;
+        }();
+        
+        return tables;
+    }
+}
+
+/** The basic wave shapes, as shared by every voice. */
+class WavetableBank
+{
+public:
+    const BasicWaveforms::Table& getSineTable() const noexcept     { return BasicWaveforms::sineTable; }
+    const BasicWaveforms::Table& getTriTable() const noexcept      { return BasicWaveforms::triTable; }
+    const BasicWaveforms::Table& getSawTable() const noexcept      { return BasicWaveforms::sawTable; }
+    const BasicWaveforms::Table& getSquareTable() const noexcept   { return BasicWaveforms::squareTable; }
+    
+    const BasicWaveforms::HighResolutionTables& getHighResolutionTables() const   { return BasicWaveforms::getHighResolutionTables(); }
+    const BasicWaveforms::SyncTables& getSyncTables() const                       { return BasicWaveforms::getSyncTables(); }
 };
 
 class SineWaveSound : public juce::SynthesiserSound
@@ -88,63 +332,150 @@ public:
         SINE = 0,
         TRIANGLE,
         SAW,
-        SQUARE
+        SQUARE,
+        CUSTOM
+    };
+    
+    enum VelocityCurve {
+        LINEAR = 0,
+        SOFT,
+        HARD,
+        FIXED
+    };
+    
+    /** ECO reads the nearest sample of the small tables, STANDARD interpolates them
+        linearly, and HIGH uses Hermite interpolation on 2048-sample tables. OFFLINE
+        is used whenever the host renders offline, whatever the chosen tier.
+    */
+    enum Quality {
+        ECO = 0,
+        STANDARD,
+        HIGH,
+        OFFLINE
     };
 private:
     juce::ADSR adsr;
     juce::ADSR::Parameters adsrParameters;
     
-    const unsigned int tableSize = 1 << 7;
-    float masterVolume;
+    float masterVolume = 1.0f;
+    
+    // Each block is rendered in mono into this scratch, then panned onto the bus
+    static constexpr int scratchSize = 64;
+    static_assert (scratchSize <= PhaseModulationOscillator::maxBlockSize);
+    static_assert (scratchSize <= HardSyncOscillator::maxBlockSize);
+    float scratch[scratchSize];
+    float pan = 0.0f, spread = 0.0f;
+    float panGains[2] = { 1.0f, 1.0f };
+    float currentGains[2] = { 1.0f, 1.0f }, targetGains[2] = { 1.0f, 1.0f };
+    
+    // Per-note expression. MIDI handlers only store targets; the smoothed values
+    // and everything derived from them are updated once per scratch-sized chunk
+    struct Expression
+    {
+        float bend = 0.0f;      // -1 to 1
+        float pressure = 0.0f;  // 0 to 1
+        float slide = 0.5f;     // 0 to 1 (CC74)
+    };
+    
+    Expression targetExpression, expression;
+    float masterBend = 0.0f;
+    float velocity = 1.0f, baseFrequency = 440.0f;
+    float expressionCoefficient = 1.0f;
+    float currentSemitones = 0.0f;
+    
+    bool mpeEnabled = false;
+    float bendRange = 2.0f, pressureDepth = 0.5f;
+    VelocityCurve amplitudeCurve = LINEAR, cutoffCurve = LINEAR;
+    float cutoffVelocity = 0.0f;
+    
+    // One-pole lowpass for velocity and slide brightness, skipped when fully open
+    float currentBrightness = -1.0f, lowpassCoefficient = 1.0f, lowpassState = 0.0f;
+    bool lowpassActive = false;
     
-    juce::AudioSampleBuffer sineTable, sawTable, triTable, squareTable;
+    const WavetableBank& wavetables;
+    const HarmonicWavetable* customTable = nullptr;
+    const TuningTable::Frequencies* tuning = nullptr;
+    float currentFrequency = 440.0f;
     juce::OwnedArray<WavetableOscillator> oscillators;
     
-    WaveType waveType;
+    WaveType waveType = SINE;
+    Quality quality = STANDARD;
+    int midiChannel = 1;
     
     std::unique_ptr<WavetableOscillator> oscillator;
     //auto osc : oscillators;
     
+    // Takes over from the wavetable oscillator while the patch has 2 or more operators
+    PhaseModulationOscillator phaseModulation;
+    
+    // Plays the wavetable as a slave synced to the note, when the patch turns it on
+    HardSyncOscillator hardSync;
+    
+    const SimdKernels::Kernels& kernels = SimdKernels::get();
+    
+    int voiceIndex = 0;
+    EventTracer* tracer = nullptr;
+    
 public:
     
-    SineWaveVoice()
+    SineWaveVoice(const WavetableBank& wavetableBank, const HarmonicWavetable* harmonicWavetable = nullptr)
+    : wavetables(wavetableBank), customTable(harmonicWavetable)
     {
-        createTriWavetable();
-        createSineWavetable();
-        createSawWavetable();
-        createSquareWavetable();
-        
-        oscillator = std::make_unique<WavetableOscillator>(sineTable);
+        oscillator = std::make_unique<WavetableOscillator>(wavetables.getSineTable().data(), BasicWaveforms::tableSize + 1);
+        phaseModulation.setTable(wavetables.getSineTable());
         
         
       
-        setWaveType(waveType);
+        setWaveType(waveType, true);
     }
     void setWaveType(WaveType type, bool disableCheck = false)
     {
         if(!disableCheck)
             if(type == waveType)return;
         
+        if (quality >= HIGH && type != CUSTOM)
+        {
+            auto& tables = wavetables.getHighResolutionTables();
+            
+            switch (type)
+            {
+                case TRIANGLE:  oscillator->setWavetable(tables.triangle); break;
+                case SAW:       oscillator->setWavetable(tables.saw); break;
+                case SQUARE:    oscillator->setWavetable(tables.square); break;
+                case SINE:
+                default:        oscillator->setWavetable(tables.sine); break;
+            }
+            
+            waveType = type;
+            return;
+        }
         
         switch(type){
             case(SINE):
-                oscillator->setWavetable(sineTable);
+                oscillator->setWavetable(wavetables.getSineTable());
                 
                 break;
             case(TRIANGLE):
-                oscillator->setWavetable(triTable);
+                oscillator->setWavetable(wavetables.getTriTable());
                 
                 break;
             case(SAW):
-                oscillator->setWavetable(sawTable);
+                oscillator->setWavetable(wavetables.getSawTable());
                 
                 break;
             case(SQUARE):
-                oscillator->setWavetable(squareTable);
+                oscillator->setWavetable(wavetables.getSquareTable());
+                
+                break;
+            case(CUSTOM):
+                if (customTable != nullptr)
+                    oscillator->setWavetable(customTable->getTable(currentFrequency, getSampleRate()));
+                else
+                    oscillator->setWavetable(wavetables.getSineTable());
                 
                 break;
             default :
-                oscillator->setWavetable(sineTable);
+                oscillator->setWavetable(wavetables.getSineTable());
                 
                 break;
         }
@@ -152,147 +483,393 @@ public:
         waveType = type;
     }
     
+    /** Switching to HIGH or OFFLINE needs the high-resolution tables built beforehand. */
+    void setQuality(Quality newQuality)
+    {
+        if (newQuality == quality)
+            return;
+        
+        quality = newQuality;
+        setWaveType(waveType, true);
+        
+        if (quality >= HIGH)
+            phaseModulation.setTable(wavetables.getHighResolutionTables().sine);
+        else
+            phaseModulation.setTable(wavetables.getSineTable());
+    }
+    
+    /** Cheap to call every block. */
+    void setPhaseModulation(const PhaseModulationSettings& settings) noexcept
+    {
+        phaseModulation.setSettings(settings);
+    }
+    
+    /** Cheap to call every block. ratio is the synced wave's frequency over the note's. */
+    void setHardSync(bool shouldSync, float ratio) noexcept
+    {
+        hardSync.setSync(shouldSync, ratio);
+    }
+    
+    /** The table startNote() looks each note's frequency up in. Without one, notes use 12-TET. */
+    void setTuning(const TuningTable::Frequencies* newTuning) noexcept
+    {
+        tuning = newTuning;
+    }
+    
+    void setVoiceIndex(int newIndex, EventTracer* newTracer)
+    {
+        voiceIndex = newIndex;
+        tracer = newTracer;
+    }
+    
+    int getVoiceIndex() const noexcept
+    {
+        return voiceIndex;
+    }
+    
+    /** The MIDI channel (1-16) of the note this voice is playing, or last played. */
+    int getMidiChannel() const noexcept
+    {
+        return midiChannel;
+    }
+    
     bool canPlaySound(juce::SynthesiserSound* sound) override
     {
         return dynamic_cast<SineWaveSound*>(sound) != nullptr;
     }
     
-    void createSineWavetable()
+    void startNote(int midiNoteNumber, float newVelocity, juce::SynthesiserSound*, int currentPitchWheelPosition) override
     {
-        sineTable.setSize (1, (int) tableSize + 1);
-        sineTable.clear();
-        
-        auto* samples = sineTable.getWritePointer (0);
+        auto sampleRate = getSampleRate();
         
-        auto angleDelta = juce::MathConstants<double>::twoPi / (double) (tableSize);
-        auto currentAngle = 0.0;
-        for(unsigned int i = 0; i < tableSize; ++i)
+        for (int channel = 1; channel <= 16; ++channel)
         {
-            auto sample = std::sin(currentAngle);
-            samples[i] += (float) sample;
-            currentAngle += angleDelta;
+            if (isPlayingChannel(channel))
+            {
+                midiChannel = channel;
+                break;
+            }
         }
-        samples[tableSize] = samples[0];
         
+        baseFrequency = currentFrequency = tuning != nullptr ? (*tuning)[(size_t) midiNoteNumber]
+                                                             : (float)juce::MidiMessage::getMidiNoteInHertz(midiNoteNumber);
+        setWaveType(waveType,true);
+        
+        velocity = newVelocity;
+        
+        // The synth applies any pressure and slide already sent on this channel after the note starts
+        targetExpression = Expression();
+        targetExpression.bend = pitchWheelToBend(currentPitchWheelPosition);
+        expression = targetExpression;
+        currentSemitones = 0.0f;
+        oscillator->setFrequency(baseFrequency, (float)sampleRate);
+        phaseModulation.setFrequency(baseFrequency, (float)sampleRate);
+        phaseModulation.reset();
+        hardSync.setFrequency(baseFrequency, (float)sampleRate);
+        hardSync.reset();
         
+        lowpassState = 0.0f;
+        currentBrightness = -1.0f;
+        
+        adsr.noteOn();
+        
+        updatePanGains();
+        updateExpression();
+        currentGains[0] = targetGains[0];
+        currentGains[1] = targetGains[1];
+        
+        if (tracer != nullptr)
+            tracer->record(EventTracer::EventType::voiceStart, midiChannel, midiNoteNumber, voiceIndex, newVelocity);
     }
     
-    void createSawWavetable()
+    void stopNote(float /*velocity*/, bool allowTailOff) override
     {
-        sawTable.setSize(1, (int)tableSize + 1);
-        sawTable.clear();
-        
-        auto* samples = sawTable.getWritePointer(0);
+        adsr.noteOff();
         
-        auto angleDelta = 1.0 / (double)(tableSize);
-        auto currentAngle = 0.0;
-        for (unsigned int i = 0; i < tableSize; ++i)
+        if (!allowTailOff || !adsr.isActive())
         {
-            auto sample = 2.0 * (currentAngle - floor(0.5 + currentAngle));
-            samples[i] += (float)sample;
-            currentAngle += angleDelta;
+            freeVoice();
         }
-        samples[tableSize] = samples[0];
+    }
+    
+    void freeVoice()
+    {
+        if (tracer != nullptr)
+            tracer->record(EventTracer::EventType::voiceFree, midiChannel, getCurrentlyPlayingNote(), voiceIndex);
         
+        clearCurrentNote();
+    }
+    
+    void prepareToPlay(double sampleRate)
+    {
+        reset();
+        
+        sampleRate = getSampleRate();
+        adsr.setSampleRate(sampleRate);
         
+        // Expression settles with a ~5 ms time constant, stepped once per chunk
+        expressionCoefficient = 1.0f - std::exp(-(float)scratchSize / (0.005f * (float)sampleRate));
+    }
+    
+    void setVolume(float theMasterVolume)
+    {
+        masterVolume = theMasterVolume;
     }
     
-    void createSquareWavetable()
+    /** Pan is -1 (left) to 1 (right). Spread (0-1) additionally places notes
+        across the stereo field by pitch, lower notes to the left.
+    */
+    void setPan(float newPan, float newSpread)
     {
-        squareTable.setSize(1, (int)tableSize + 1);
-        squareTable.clear();
+        if (newPan == pan && newSpread == spread)
+            return;
         
-        auto* samples = squareTable.getWritePointer(0);
+        pan = newPan;
+        spread = newSpread;
+        updatePanGains();
+    }
+    
+    void updatePanGains()
+    {
+        auto keyPosition = juce::jlimit(-1.0f, 1.0f, (float)(getCurrentlyPlayingNote() - 60) / 36.0f);
+        auto position = juce::jlimit(-1.0f, 1.0f, pan + spread * keyPosition);
         
-        auto angleDelta = 1.0 / (double)(tableSize);
-        auto currentAngle = 0.0;
-        for (unsigned int i = 0; i < tableSize; ++i)
+        // Balanced pan law (as juce::dsp::Panner), so centred voices keep full level on both sides
+        panGains[0] = juce::jmin(1.0f, 1.0f - position);
+        panGains[1] = juce::jmin(1.0f, 1.0f + position);
+    }
+    
+    /** In MPE mode each note's channel bend uses bendRangeSemitones and pressure
+        scales the level by up to pressureDepth; otherwise bends span 2 semitones
+        and pressure and slide are ignored.
+    */
+    void setExpressionSettings(bool shouldUseMPE, float bendRangeSemitones, float newPressureDepth)
+    {
+        mpeEnabled = shouldUseMPE;
+        bendRange = bendRangeSemitones;
+        pressureDepth = newPressureDepth;
+    }
+    
+    /** cutoffAmount (0-1) is how far the cutoff curve can close the voice's lowpass at low velocities. */
+    void setVelocityCurves(VelocityCurve newAmplitudeCurve, VelocityCurve newCutoffCurve, float cutoffAmount)
+    {
+        amplitudeCurve = newAmplitudeCurve;
+        cutoffCurve = newCutoffCurve;
+        cutoffVelocity = cutoffAmount;
+    }
+    
+    static float applyVelocityCurve(VelocityCurve curve, float value) noexcept
+    {
+        switch (curve)
         {
-            auto sample = 2.0 * (2.0 * floor(currentAngle) - floor(2.0 * currentAngle)) + 1.0;
-            samples[i] += (float)sample;
-            currentAngle += angleDelta;
+            case SOFT:  return std::sqrt(value);
+            case HARD:  return value * value;
+            case FIXED: return 1.0f;
+            case LINEAR:
+            default:    return value;
         }
-        samples[tableSize] = samples[0];
-        
+    }
+    
+    static float pitchWheelToBend(int wheelValue) noexcept
+    {
+        return juce::jlimit(-1.0f, 1.0f, (float)(wheelValue - 8192) / 8192.0f);
+    }
+    
+    /** MPE master-channel bend, which applies to every note on top of its own. */
+    void setMasterPitchWheel(int wheelValue, float rangeSemitones) noexcept
+    {
+        masterBend = pitchWheelToBend(wheelValue) * rangeSemitones;
+    }
+    
+    /** Applies pressure and slide that arrived on the note's channel before the note itself. */
+    void setInitialExpression(float pressure, float slide) noexcept
+    {
+        targetExpression.pressure = expression.pressure = pressure;
+        targetExpression.slide = expression.slide = slide;
         
+        updateExpression();
+        currentGains[0] = targetGains[0];
+        currentGains[1] = targetGains[1];
     }
     
-    void createTriWavetable()
+    void updateExpression() noexcept
     {
-        triTable.setSize(1, (int)tableSize + 1);
-        triTable.clear();
+        expression.bend += expressionCoefficient * (targetExpression.bend - expression.bend);
+        expression.pressure += expressionCoefficient * (targetExpression.pressure - expression.pressure);
+        expression.slide += expressionCoefficient * (targetExpression.slide - expression.slide);
         
-        auto* samples = triTable.getWritePointer(0);
+        auto semitones = expression.bend * (mpeEnabled ? bendRange : 2.0f) + masterBend;
         
-        auto angleDelta = 1.0 / (double)(tableSize);
-        auto currentAngle = 0.0;
-        for (unsigned int i = 0; i < tableSize; ++i)
+        if (std::abs(semitones - currentSemitones) > 1.0e-4f)
         {
-            auto sample = 4.0 * abs(currentAngle - floor(currentAngle + 0.75) + 0.25) - 1.0;
-            samples[i] += (float)sample;
-            currentAngle += angleDelta;
+            currentSemitones = semitones;
+            currentFrequency = baseFrequency * std::exp2(semitones / 12.0f);
+            oscillator->setFrequency(currentFrequency, (float)getSampleRate());
+            phaseModulation.setFrequency(currentFrequency, (float)getSampleRate());
+            hardSync.setFrequency(currentFrequency, (float)getSampleRate());
         }
-        samples[tableSize] = samples[0];
         
+        // Level rides on the pan gains, so it is ramped per chunk rather than per sample
+        auto level = applyVelocityCurve(amplitudeCurve, velocity);
         
-    }
-    
-    void startNote(int midiNoteNumber, float velocity, juce::SynthesiserSound*, int /*currentPitchWheelPosition*/) override
-    {
-        auto sampleRate = getSampleRate();
+        if (mpeEnabled)
+            level *= 1.0f - pressureDepth + pressureDepth * expression.pressure;
         
-        setWaveType(waveType,true);
+        targetGains[0] = panGains[0] * level;
+        targetGains[1] = panGains[1] * level;
         
-        auto frequency = juce::MidiMessage::getMidiNoteInHertz(midiNoteNumber);
+        auto brightness = 1.0f - cutoffVelocity * (1.0f - applyVelocityCurve(cutoffCurve, velocity));
         
-        oscillator->setFrequency((float)frequency, (float)sampleRate);
+        if (mpeEnabled)
+            brightness = juce::jlimit(0.0f, 1.0f, brightness + expression.slide - 0.5f);
         
-        adsr.noteOn();
+        if (brightness != currentBrightness)
+        {
+            currentBrightness = brightness;
+            lowpassActive = brightness < 0.999f;
+            
+            // 80 Hz to 20 kHz, exponentially
+            auto cutoff = 80.0f * std::pow(250.0f, brightness);
+            lowpassCoefficient = 1.0f - std::exp(-juce::MathConstants<float>::twoPi * cutoff / (float)getSampleRate());
+        }
     }
     
-    void stopNote(float /*velocity*/, bool allowTailOff) override
+    void renderNextBlock(juce::AudioSampleBuffer& outputBuffer, int startSample, int numSamples) override
     {
-        adsr.noteOff();
+        if (!isVoiceActive())
+            return;
         
-        if (!allowTailOff || !adsr.isActive())
+        while(numSamples > 0)
         {
-            clearCurrentNote();
+            auto numThisTime = juce::jmin(numSamples, scratchSize);
+            
+            updateExpression();
+            
+            // Custom tables can be republished between blocks, and the mip level follows the pitch, synced or not
+            if (waveType == CUSTOM && customTable != nullptr)
+                oscillator->setWavetable(customTable->getTable(currentFrequency * hardSync.getFrequencyRatio(), getSampleRate()));
+            
+            if (phaseModulation.isEnabled())
+            {
+                renderPhaseModulation(numThisTime);
+            }
+            else if (hardSync.isEnabled())
+            {
+                renderHardSync(numThisTime);
+            }
+            else
+            {
+                switch (quality)
+                {
+                    case ECO:       renderOscillator(WavetableOscillator::Interpolation::nearest, numThisTime); break;
+                    case HIGH:
+                    case OFFLINE:   renderOscillator(WavetableOscillator::Interpolation::hermite, numThisTime); break;
+                    case STANDARD:
+                    default:        renderOscillator(WavetableOscillator::Interpolation::linear, numThisTime); break;
+                }
+            }
+            
+            if (lowpassActive)
+            {
+                for (int i = 0; i < numThisTime; ++i)
+                {
+                    lowpassState += lowpassCoefficient * (scratch[i] - lowpassState);
+                    scratch[i] = lowpassState;
+                }
+            }
+            
+            mixScratchInto(outputBuffer, startSample, numThisTime);
+            
+            startSample += numThisTime;
+            numSamples -= numThisTime;
         }
+
+        // Hand the voice back to the synth once its release has finished
+        if (!adsr.isActive())
+            freeVoice();
     }
     
-    void prepareToPlay(double sampleRate)
+    void renderOscillator(WavetableOscillator::Interpolation interpolation, int numSamples) noexcept
     {
-        reset();
+        oscillator->render(interpolation, scratch, numSamples);
         
-        sampleRate = getSampleRate();
-        adsr.setSampleRate(sampleRate);
+        // The envelope is a recurrence, so it stays sample by sample
+        for (int i = 0; i < numSamples; ++i)
+            scratch[i] *= masterVolume * adsr.getNextSample();
     }
     
-    void setVolume(float theMasterVolume)
+    void renderPhaseModulation(int numSamples) noexcept
     {
-        masterVolume = theMasterVolume;
+        phaseModulation.process(scratch, numSamples);
+        
+        for (int i = 0; i < numSamples; ++i)
+            scratch[i] *= masterVolume * adsr.getNextSample();
     }
     
-    void renderNextBlock(juce::AudioSampleBuffer& outputBuffer, int startSample, int numSamples) override
+    void renderHardSync(int numSamples) noexcept
     {
+        // The basic shapes' tables are band-limited for the note, not for the slave above it,
+        // so those read the level picked for the slave's own frequency
+        if (waveType == TRIANGLE || waveType == SAW || waveType == SQUARE)
+        {
+            auto& sync = wavetables.getSyncTables();
+            auto& levels = waveType == SAW ? sync.saw : (waveType == SQUARE ? sync.square : sync.triangle);
+            auto& table = BasicWaveforms::SyncTables::select(levels, currentFrequency * hardSync.getFrequencyRatio(), getSampleRate());
+            hardSync.setTable(table.data(), (int) table.size());
+        }
+        else
+        {
+            hardSync.setTable(oscillator->getTable(), oscillator->getTableSize() + 1);
+        }
+        hardSync.process(scratch, numSamples);
         
-        while(--numSamples >= 0)
+        for (int i = 0; i < numSamples; ++i)
+            scratch[i] *= masterVolume * adsr.getNextSample();
+    }
+    
+    void mixScratchInto(juce::AudioSampleBuffer& outputBuffer, int startSample, int numSamples)
+    {
+        auto numChannels = outputBuffer.getNumChannels();
+        
+        if (numChannels == 1)
         {
-            auto oscillatorOutput = 0.0f;
-            
-            oscillatorOutput+= oscillator->getNextSample();
-            auto currentSample = oscillatorOutput * masterVolume * adsr.getNextSample();
-            
-            
-            for( auto i = outputBuffer.getNumChannels(); --i >= 0;)outputBuffer.addSample(i, startSample, currentSample);
-            ++startSample;
+            // The pan law keeps the louder side at full level, so that side's gain is the voice's level without the pan
+            kernels.mixInto(outputBuffer.getWritePointer(0, startSample), scratch,
+                            juce::jmax(currentGains[0], currentGains[1]), juce::jmax(targetGains[0], targetGains[1]), numSamples);
+        }
+        else
+        {
+            for (int ch = 0; ch < numChannels; ++ch)
+            {
+                auto side = juce::jmin(ch, 1);
+                kernels.mixInto(outputBuffer.getWritePointer(ch, startSample), scratch, currentGains[side], targetGains[side], numSamples);
+            }
         }
-
         
+        currentGains[0] = targetGains[0];
+        currentGains[1] = targetGains[1];
+    }
+    
+    void pitchWheelMoved(int newPitchWheelValue) override
+    {
+        targetExpression.bend = pitchWheelToBend(newPitchWheelValue);
     }
     
-    void pitchWheelMoved(int) override {}
-    void controllerMoved(int, int) override {}
+    void controllerMoved(int controllerNumber, int newControllerValue) override
+    {
+        if (controllerNumber == 74)
+            targetExpression.slide = (float)newControllerValue / 127.0f;
+    }
+    
+    void channelPressureChanged(int newChannelPressureValue) override
+    {
+        targetExpression.pressure = (float)newChannelPressureValue / 127.0f;
+    }
+    
+    void aftertouchChanged(int newAftertouchValue) override
+    {
+        targetExpression.pressure = (float)newAftertouchValue / 127.0f;
+    }
     
     void reset()
     {
@@ -311,53 +888,263 @@ public:
     
 };
 
-class SynthAudioSource  : public juce::AudioSource
+class SineWaveSynthesiser : public juce::Synthesiser
 {
 public:
-    SynthAudioSource(juce::MidiKeyboardState& keyState)
-    : keyboardState(keyState)
+    static constexpr int numMidiChannels = 16;
+    
+    /** In multi-timbral mode each voice renders into the bus of its MIDI channel
+        instead of the output, so every channel can be filtered separately.
+    */
+    void setMultiTimbral(bool shouldBeMultiTimbral)
+    {
+        multiTimbral = shouldBeMultiTimbral;
+    }
+    
+    bool isMultiTimbral() const noexcept
+    {
+        return multiTimbral;
+    }
+    
+    /** In MPE mode channel 1 is the master channel: its pitch bend moves every
+        note, while channels 2-16 carry per-note bend, pressure and slide.
+    */
+    void setMPE(bool shouldUseMPE, float masterBendRangeSemitones = 2.0f)
+    {
+        mpeEnabled = shouldUseMPE;
+        masterBendRange = masterBendRangeSemitones;
+    }
+    
+    void prepareChannelBuses(int numChannels, int maximumBlockSize)
+    {
+        for (auto& bus : channelBuses)
+            bus.setSize(numChannels, maximumBlockSize);
+        
+        busActive.fill(false);
+    }
+    
+    /** Call before rendering each block so that buses are only cleared when first used.
+        The buses hold just this block, with its first sample at index 0.
+    */
+    void beginBlock(int startSample, int numSamples) noexcept
+    {
+        currentBlockStart = startSample;
+        currentBlockSize = numSamples;
+        busActive.fill(false);
+    }
+    
+    /** Returns the bus for a channel (0-15) if any voice rendered into it this block. */
+    juce::AudioBuffer<float>* getActiveChannelBus(int channelIndex) noexcept
     {
-        for (auto i = 0; i < 10; ++i)synth.addVoice(new SineWaveVoice());
-        synth.addSound(new SineWaveSound());
+        return busActive[(size_t) channelIndex] ? &channelBuses[(size_t) channelIndex] : nullptr;
     }
     
-    void setUsingSineWaveSound()
+    /** Keys with no frequency in the table don't play. */
+    void setTuning(const TuningTable::Frequencies* newTuning) noexcept
     {
-        synth.clearSounds();
+        tuning = newTuning;
     }
     
-    void prepareToPlay(int /*samplesPerBlock*/, double sampleRate) override
+    void setEventTracer(EventTracer* newTracer)
     {
-        synth.setCurrentPlaybackSampleRate(sampleRate);
-        midiCollector.reset(sampleRate);
+        tracer = newTracer;
         
+        for (int i = 0; i < getNumVoices(); ++i)
+            if (auto voice = dynamic_cast<SineWaveVoice*>(getVoice(i)))
+                voice->setVoiceIndex(i, newTracer);
     }
     
-    void releaseResources() override{}
+    void noteOn(int midiChannel, int midiNoteNumber, float velocity) override
+    {
+        if (tracer != nullptr)
+            tracer->record(EventTracer::EventType::noteOn, midiChannel, midiNoteNumber, -1, velocity);
+        
+        if (tuning != nullptr && (*tuning)[(size_t) midiNoteNumber] <= 0.0f)
+            return;
+        
+        juce::Synthesiser::noteOn(midiChannel, midiNoteNumber, velocity);
+        
+        auto& channel = channelExpression[(size_t) juce::jlimit(1, numMidiChannels, midiChannel) - 1];
+        
+        if (channel.pressure != 0.0f || channel.slide != 0.5f)
+            for (auto* voice : voices)
+                if (voice->getCurrentlyPlayingNote() == midiNoteNumber && voice->isPlayingChannel(midiChannel) && voice->isKeyDown())
+                    static_cast<SineWaveVoice*>(voice)->setInitialExpression(channel.pressure, channel.slide);
+    }
     
-    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override
+    void handlePitchWheel(int midiChannel, int wheelValue) override
     {
+        if (!(mpeEnabled && midiChannel == 1))
+        {
+            juce::Synthesiser::handlePitchWheel(midiChannel, wheelValue);
+            return;
+        }
         
+        // Idle voices keep it too, so notes that start later pick it up
+        for (auto* voice : voices)
+            static_cast<SineWaveVoice*>(voice)->setMasterPitchWheel(wheelValue, masterBendRange);
+    }
+    
+    void handleChannelPressure(int midiChannel, int channelPressureValue) override
+    {
+        if (midiChannel >= 1 && midiChannel <= numMidiChannels)
+            channelExpression[(size_t) midiChannel - 1].pressure = (float)channelPressureValue / 127.0f;
+        
+        juce::Synthesiser::handleChannelPressure(midiChannel, channelPressureValue);
+    }
+    
+    void handleController(int midiChannel, int controllerNumber, int controllerValue) override
+    {
+        if (controllerNumber == 74 && midiChannel >= 1 && midiChannel <= numMidiChannels)
+            channelExpression[(size_t) midiChannel - 1].slide = (float)controllerValue / 127.0f;
         
-        juce::MidiBuffer incomingMidi;
-        midiCollector.removeNextBlockOfMessages(incomingMidi, bufferToFill.numSamples);
+        juce::Synthesiser::handleController(midiChannel, controllerNumber, controllerValue);
+    }
+    
+    void noteOff(int midiChannel, int midiNoteNumber, float velocity, bool allowTailOff) override
+    {
+        if (tracer != nullptr)
+            tracer->record(EventTracer::EventType::noteOff, midiChannel, midiNoteNumber, -1, velocity);
         
-        keyboardState.processNextMidiBuffer(incomingMidi, bufferToFill.startSample, bufferToFill.numSamples, true);
+        juce::Synthesiser::noteOff(midiChannel, midiNoteNumber, velocity, allowTailOff);
+    }
+    
+protected:
+    using juce::Synthesiser::renderVoices;
+    
+    void renderVoices(juce::AudioBuffer<float>& outputAudio, int startSample, int numSamples) override
+    {
+        if (!multiTimbral)
+        {
+            juce::Synthesiser::renderVoices(outputAudio, startSample, numSamples);
+            return;
+        }
         
-        synth.renderNextBlock(*bufferToFill.buffer, incomingMidi, bufferToFill.startSample, bufferToFill.numSamples);
+        for (auto* voice : voices)
+        {
+            if (!voice->isVoiceActive())
+                continue;
+            
+            // Every voice in this synth is a SineWaveVoice
+            auto channelIndex = (size_t) static_cast<SineWaveVoice*>(voice)->getMidiChannel() - 1;
+            auto& bus = channelBuses[channelIndex];
+            
+            if (!busActive[channelIndex])
+            {
+                bus.clear(0, currentBlockSize);
+                busActive[channelIndex] = true;
+            }
+            
+            voice->renderNextBlock(bus, startSample - currentBlockStart, numSamples);
+        }
     }
     
-    juce::MidiMessageCollector* getMidiCollector()
+    juce::SynthesiserVoice* findVoiceToSteal(juce::SynthesiserSound* soundToPlay, int midiChannel, int midiNoteNumber) const override
     {
-        return &midiCollector;
+        auto stolenVoice = juce::Synthesiser::findVoiceToSteal(soundToPlay, midiChannel, midiNoteNumber);
+        
+        if (tracer != nullptr)
+            if (auto voice = dynamic_cast<SineWaveVoice*>(stolenVoice))
+                tracer->record(EventTracer::EventType::voiceSteal, midiChannel, midiNoteNumber, voice->getVoiceIndex());
+        
+        return stolenVoice;
     }
     
 private:
-    juce::MidiKeyboardState& keyboardState;
-    juce::Synthesiser synth;
+    EventTracer* tracer = nullptr;
+    const TuningTable::Frequencies* tuning = nullptr;
     
-    juce::MidiMessageCollector midiCollector;
+    bool multiTimbral = false;
+    bool mpeEnabled = false;
+    float masterBendRange = 2.0f;
     
+    // The last pressure and slide on each channel, for notes that start after them
+    struct ChannelExpression { float pressure = 0.0f, slide = 0.5f; };
+    std::array<ChannelExpression, numMidiChannels> channelExpression;
+    
+    std::array<juce::AudioBuffer<float>, numMidiChannels> channelBuses;
+    std::array<bool, numMidiChannels> busActive {};
+    int currentBlockStart = 0, currentBlockSize = 0;
+};
+
+/** A snapshot of the sound settings for one MIDI channel. */
+struct PatchSettings
+{
+    SineWaveVoice::WaveType waveType = SineWaveVoice::SINE;
+    float attack = 0.1f, decay = 0.1f, sustain = 1.0f, release = 0.1f;
+    float volume = 1.0f;
+    
+    bool ladderEnabled = false;
+    int ladderMode = 0;
+    float ladderCutoff = 200.0f, ladderResonance = 0.1f, ladderDrive = 1.0f;
+    
+    float pan = 0.0f, spread = 0.0f;
+    
+    SineWaveVoice::VelocityCurve velocityCurve = SineWaveVoice::LINEAR, cutoffCurve = SineWaveVoice::LINEAR;
+    float cutoffVelocity = 0.0f;
+    
+    PhaseModulationSettings phaseModulation;
+    
+    bool syncEnabled = false;
+    float syncRatio = 2.0f;
+};
+
+/** Caches the parameters that make up one channel's patch, so the audio thread
+    doesn't have to look them up by name.
+*/
+class ChannelParameters
+{
+public:
+    void attach(juce::AudioProcessorValueTreeState& state, int midiChannel);
+    PatchSettings read() const;
+    
+private:
+    juce::RangedAudioParameter* waveType = nullptr;
+    juce::RangedAudioParameter* attack = nullptr;
+    juce::RangedAudioParameter* decay = nullptr;
+    juce::RangedAudioParameter* sustain = nullptr;
+    juce::RangedAudioParameter* release = nullptr;
+    juce::RangedAudioParameter* volume = nullptr;
+    juce::RangedAudioParameter* ladderButton = nullptr;
+    juce::RangedAudioParameter* ladderMode = nullptr;
+    juce::RangedAudioParameter* ladderCutoff = nullptr;
+    juce::RangedAudioParameter* ladderResonance = nullptr;
+    juce::RangedAudioParameter* ladderDrive = nullptr;
+    juce::RangedAudioParameter* pan = nullptr;
+    juce::RangedAudioParameter* spread = nullptr;
+    juce::RangedAudioParameter* velocityCurve = nullptr;
+    juce::RangedAudioParameter* cutoffCurve = nullptr;
+    juce::RangedAudioParameter* cutoffVelocity = nullptr;
+    juce::RangedAudioParameter* fmOperators = nullptr;
+    std::array<juce::RangedAudioParameter*, PhaseModulationSettings::maxOperators> fmRatios {}, fmIndices {};
+    juce::RangedAudioParameter* fmFeedback = nullptr;
+    juce::RangedAudioParameter* syncButton = nullptr;
+    juce::RangedAudioParameter* syncRatio = nullptr;
+};
+
+/** The effects chain's counterpart to ChannelParameters. */
+class EffectsParameters
+{
+public:
+    void attach(juce::AudioProcessorValueTreeState& state);
+    EffectsSettings read() const;
+    
+private:
+    juce::RangedAudioParameter* chorusButton = nullptr;
+    juce::RangedAudioParameter* chorusRate = nullptr;
+    juce::RangedAudioParameter* chorusDepth = nullptr;
+    juce::RangedAudioParameter* chorusMix = nullptr;
+    juce::RangedAudioParameter* delayButton = nullptr;
+    juce::RangedAudioParameter* delayTime = nullptr;
+    juce::RangedAudioParameter* delayFeedback = nullptr;
+    juce::RangedAudioParameter* delayMix = nullptr;
+    juce::RangedAudioParameter* reverbButton = nullptr;
+    juce::RangedAudioParameter* reverbSize = nullptr;
+    juce::RangedAudioParameter* reverbDamping = nullptr;
+    juce::RangedAudioParameter* reverbWidth = nullptr;
+    juce::RangedAudioParameter* reverbMix = nullptr;
+    juce::RangedAudioParameter* convolutionButton = nullptr;
+    juce::RangedAudioParameter* convolutionMix = nullptr;
 };
 
 class MysynthpracAudioProcessor  : public juce::AudioProcessor, private juce::Timer
@@ -403,19 +1190,162 @@ public:
     void getStateInformation (juce::MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
     
+    static constexpr int numMidiChannels = SineWaveSynthesiser::numMidiChannels;
+    static constexpr int numVoices = 127;
+    
+    /** The engine renders in blocks of this size whatever the host's buffer size, so voice
+        state and scratch buffers stay in cache. MIDI is applied at these boundaries.
+    */
+    static constexpr int microBlockSize = 64;
+    
+    /** Channel 1 uses the plain parameter IDs, which also drive every channel
+        when multi-timbral mode is off. Channels 2-16 add a "_chN" suffix.
+    */
+    static juce::String getChannelParameterID(const juce::String& baseID, int midiChannel);
+    static juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
+    
     juce::AudioProcessorValueTreeState state;
     juce::AudioBuffer<float> cachedBuffer;
 
-    void setLadderFilter();
+    void setLadderFilter(StereoLadderFilter& filter, const PatchSettings& patch);
+    
+    EventTracer& getEventTracer() { return eventTracer; }
+    
+    /** Loads a WAV impulse response for the convolution reverb, in the background. */
+    void loadImpulseResponse(const juce::File& file);
+
+    /** For offline rendering: blocks until the reverb's IR is loaded and built for the
+        current prepareToPlay() settings, so the first block already has it.
+    */
+    void waitForImpulseResponse() { effects.getConvolver().waitUntilReady(); }
+    
+    /** Call from the message thread; the audio thread picks the pattern up without locking. */
+    void setArpPattern(const ArpPattern& pattern);
+    ArpPattern getArpPattern() const { return arpeggiator.getPattern(); }
+    
+    /** The harmonics of the CUSTOM wave type. Call from the message thread. */
+    void setHarmonics(const HarmonicWavetable::Harmonics& harmonics);
+    HarmonicWavetable::Harmonics getHarmonics() const { return harmonicTable.getHarmonics(); }
+    
+    /** Renders the voices a couple of blocks ahead on a background thread, so heavy patches can
+        play back at small buffer sizes. Adds that latency, which is reported to the host.
+        Call from the message thread.
+    */
+    void setAnticipativeRendering(bool shouldRenderAhead);
+    bool isAnticipativeRendering() const;
+
+    /** How often the background render has fallen behind and the audio thread output silence. */
+    int getNumAnticipativeUnderruns() const noexcept { return anticipativeRenderer.getNumUnderruns(); }
+    
+    /** Gives the master limiter 1.5 ms of lookahead, reported to the host as latency.
+        Call from the message thread.
+    */
+    void setLimiterLookahead(bool shouldLookAhead);
+    bool isLimiterLookahead() const;
+    
+    /** Retunes every note from a Scala scale and optional keyboard mapping. The files' text
+        is saved with the session, so it doesn't depend on them afterwards. On failure the
+        current tuning is kept. Call from the message thread.
+    */
+    juce::Result loadTuning(const juce::File& scaleFile, const juce::File& mappingFile = {});
+    void resetTuning();
+    juce::String getTuningDescription() const { return tuning.getDescription(); }
+
+    /** MIDI played live into the standalone app, placed in each block by arrival time.
+        Feed it from the input devices' callback, then enable it, which also adds the
+        jitter buffer to the latency reported to the host. It is shared, so a callback
+        can keep it after the processor has gone. Call from the message thread.
+    */
+    std::shared_ptr<LiveMidiInput> getLiveMidiInput() const { return liveMidiInput; }
+    void setLiveMidiInputEnabled(bool shouldBeEnabled);
+    bool isLiveMidiInputEnabled() const noexcept { return liveMidiEnabled.load(); }
+
+    /** Trades latency for timing accuracy on live MIDI; see LiveMidiInput. Saved with the state. */
+    void setLiveMidiJitterBufferMs(double newJitterBufferMs);
+    double getLiveMidiJitterBufferMs() const;
 
 private:
     //==============================================================================
     juce::MidiKeyboardState keyboardState;
-    //SynthAudioSource synthAudioSource;
     //juce::MidiKeyboardComponent keyboardComponent;
-    juce::Synthesiser synth;
+    WavetableBank wavetables;
+    HarmonicWavetable harmonicTable;
+    SineWaveSynthesiser synth;
+    
+    // filters[0] is the post-mix filter; in multi-timbral mode there is one per channel
+    std::array<StereoLadderFilter, numMidiChannels> filters;
+    std::array<ChannelParameters, numMidiChannels> channelParameters;
+    std::array<bool, numMidiChannels> channelWasActive {};
+    juce::AudioParameterBool* multiTimbralParam = nullptr;
+    juce::AudioParameterBool* mpeParam = nullptr;
+    juce::RangedAudioParameter* mpeBendRangeParam = nullptr;
+    juce::RangedAudioParameter* pressureDepthParam = nullptr;
+    juce::RangedAudioParameter* qualityParam = nullptr;
+    
+    EffectsChain effects;
+    EffectsParameters effectsParameters;
+    
+    MasterLimiter limiter;
+    juce::AudioParameterBool* limiterButtonParam = nullptr;
+    juce::RangedAudioParameter* limiterThresholdParam = nullptr;
+    juce::RangedAudioParameter* limiterReleaseParam = nullptr;
+    static inline const juce::Identifier limiterLookaheadProperty { "limiterlookahead" };
+    void updateLimiterLookahead();
+    void updateLatency();
+    static inline const juce::Identifier impulseResponseProperty { "impulseresponse" };
+    
+    Arpeggiator arpeggiator;
+    juce::AudioParameterBool* arpButtonParam = nullptr;
+    juce::RangedAudioParameter* arpModeParam = nullptr;
+    juce::RangedAudioParameter* arpRateParam = nullptr;
+    juce::RangedAudioParameter* arpGateParam = nullptr;
+    juce::RangedAudioParameter* arpOctavesParam = nullptr;
+    static inline const juce::Identifier arpPatternProperty { "arppattern" };
+    static inline const juce::Identifier harmonicsProperty { "harmonics" };
+    
+    TuningTable tuning;
+    static inline const juce::Identifier tuningScaleProperty { "tuningscale" };
+    static inline const juce::Identifier tuningMappingProperty { "tuningmapping" };
+    
+    struct VoiceSettings
+    {
+        bool mpe = false, multiTimbral = false;
+        float mpeBendRange = 48.0f, pressureDepth = 0.5f;
+        SineWaveVoice::Quality quality = SineWaveVoice::STANDARD;
+    };
+    
+    // Read on the audio thread; the voices only ever render from a copy, which in
+    // anticipative mode travels to the render thread with its block's MIDI
+    struct RenderSettings
+    {
+        VoiceSettings voice;
+        std::array<PatchSettings, numMidiChannels> patches;
+    };
+    
+    RenderSettings renderSettings;
+    void readRenderSettings();
+    void renderVoices(juce::AudioBuffer<float>& buffer, const juce::MidiBuffer& midi, int numSamples, const RenderSettings& settings);
+    
+    AnticipativeRenderer<RenderSettings> anticipativeRenderer;
+    static constexpr int anticipativeBlocksAhead = 2;
+    int preparedBlockSize = 0;
+    static inline const juce::Identifier anticipativeProperty { "anticipative" };
+    void updateAnticipativeRendering();
+    void startAnticipativeRendering();
+    
+    juce::MidiBuffer microBlockMidi;
+    void renderMicroBlock(juce::AudioBuffer<float>& buffer, const juce::MidiBuffer& midi, int startSample, int numSamples, const RenderSettings& settings);
+    
+    Arpeggiator::Settings readArpSettings() const;
+    Arpeggiator::Transport readTransport() const;
+    
+    EventTracer eventTracer;
+    juce::Array<float> lastParameterValues;
     
-    juce::dsp::LadderFilter<float> filter;
+    std::shared_ptr<LiveMidiInput> liveMidiInput { std::make_shared<LiveMidiInput>() };
+    std::atomic<bool> liveMidiEnabled { false };
+    juce::MidiBuffer liveMidi;
+    static inline const juce::Identifier liveMidiJitterProperty { "livemidijitter" };
     
     //MIDI inputs
     juce::ComboBox midiInputList;
@@ -0,0 +1,354 @@
+/*
+  ==============================================================================
+
+    RealtimeSafetyChecker.cpp
+
+  ==============================================================================
+*/
+
+#include "RealtimeSafetyChecker.h"
+
+#if MYSYNTH_REALTIME_CHECKS
+
+#include <new>
+#include <cstdlib>
+
+#if JUCE_LINUX
+ #include <cerrno>
+ #include <dlfcn.h>
+ #include <pthread.h>
+ #include <unistd.h>
+ #include <time.h>
+
+// glibc's own allocator, which the malloc family below forwards to. dlsym can't be
+// used to find it, because dlsym itself allocates
+extern "C"
+{
+    void* __libc_malloc (size_t);
+    void* __libc_calloc (size_t, size_t);
+    void* __libc_realloc (void*, size_t);
+    void* __libc_memalign (size_t, size_t);
+    void __libc_free (void*);
+}
+#endif
+
+namespace
+{
+    // Plain PODs, so touching them never allocates
+    thread_local int realtimeDepth = 0;
+    thread_local int permitDepth = 0;
+    thread_local bool isReporting = false;
+
+    std::atomic<int> numViolations { 0 };
+    std::atomic<bool> abortOnViolation { false };
+    std::atomic<bool> strictLockChecking { false };
+
+    // operator new and delete go straight to the allocator, so each is flagged once rather
+    // than again as malloc or free
+   #if JUCE_LINUX
+    void* allocate (std::size_t size) noexcept                      { return __libc_malloc (size); }
+    void* allocateAligned (std::size_t align, std::size_t size) noexcept { return __libc_memalign (align, size); }
+    void release (void* p) noexcept                                 { __libc_free (p); }
+   #else
+    void* allocate (std::size_t size) noexcept                      { return std::malloc (size); }
+    void* allocateAligned (std::size_t align, std::size_t size) noexcept { return std::aligned_alloc (align, (size + align - 1) / align * align); }
+    void release (void* p) noexcept                                 { std::free (p); }
+   #endif
+}
+
+RealtimeSafetyChecker::ScopedRealtimeSection::ScopedRealtimeSection() noexcept   { ++realtimeDepth; }
+RealtimeSafetyChecker::ScopedRealtimeSection::~ScopedRealtimeSection() noexcept  { --realtimeDepth; }
+
+RealtimeSafetyChecker::ScopedPermit::ScopedPermit() noexcept    { ++permitDepth; }
+RealtimeSafetyChecker::ScopedPermit::~ScopedPermit() noexcept   { --permitDepth; }
+
+bool RealtimeSafetyChecker::isInRealtimeSection() noexcept
+{
+    return realtimeDepth > 0 && permitDepth == 0 && ! isReporting;
+}
+
+void RealtimeSafetyChecker::reportViolation (const char* description) noexcept
+{
+    if (! isInRealtimeSection())
+        return;
+
+    isReporting = true;
+    numViolations.fetch_add (1);
+
+    juce::Logger::writeToLog ("Real-time safety violation: " + juce::String (description) + "\n"
+                              + juce::SystemStats::getStackBacktrace());
+
+    if (abortOnViolation.load())
+        std::abort();
+
+    isReporting = false;
+}
+
+#else
+
+bool RealtimeSafetyChecker::isInRealtimeSection() noexcept         { return false; }
+void RealtimeSafetyChecker::reportViolation (const char*) noexcept  {}
+
+#endif
+
+int RealtimeSafetyChecker::getNumViolations() noexcept
+{
+   #if MYSYNTH_REALTIME_CHECKS
+    return numViolations.load();
+   #else
+    return 0;
+   #endif
+}
+
+void RealtimeSafetyChecker::resetViolations() noexcept
+{
+   #if MYSYNTH_REALTIME_CHECKS
+    numViolations = 0;
+   #endif
+}
+
+void RealtimeSafetyChecker::setAbortOnViolation (bool shouldAbort) noexcept
+{
+   #if MYSYNTH_REALTIME_CHECKS
+    abortOnViolation = shouldAbort;
+   #else
+    juce::ignoreUnused (shouldAbort);
+   #endif
+}
+
+void RealtimeSafetyChecker::setStrictLockChecking (bool shouldFlagEveryLock) noexcept
+{
+   #if MYSYNTH_REALTIME_CHECKS
+    strictLockChecking = shouldFlagEveryLock;
+   #else
+    juce::ignoreUnused (shouldFlagEveryLock);
+   #endif
+}
+
+bool RealtimeSafetyChecker::isStrictLockChecking() noexcept
+{
+   #if MYSYNTH_REALTIME_CHECKS
+    return strictLockChecking.load();
+   #else
+    return false;
+   #endif
+}
+
+//==============================================================================
+#if MYSYNTH_REALTIME_CHECKS && ! JUCE_WINDOWS
+
+void* operator new (std::size_t size)
+{
+    RealtimeSafetyChecker::reportViolation ("operator new");
+
+    if (auto* p = allocate (size == 0 ? 1 : size))
+        return p;
+
+    throw std::bad_alloc();
+}
+
+void* operator new[] (std::size_t size)
+{
+    RealtimeSafetyChecker::reportViolation ("operator new[]");
+
+    if (auto* p = allocate (size == 0 ? 1 : size))
+        return p;
+
+    throw std::bad_alloc();
+}
+
+void* operator new (std::size_t size, const std::nothrow_t&) noexcept
+{
+    RealtimeSafetyChecker::reportViolation ("operator new");
+    return allocate (size == 0 ? 1 : size);
+}
+
+void* operator new[] (std::size_t size, const std::nothrow_t&) noexcept
+{
+    RealtimeSafetyChecker::reportViolation ("operator new[]");
+    return allocate (size == 0 ? 1 : size);
+}
+
+void* operator new (std::size_t size, std::align_val_t alignment)
+{
+    RealtimeSafetyChecker::reportViolation ("aligned operator new");
+    auto align = (std::size_t) alignment;
+
+    if (auto* p = allocateAligned (align, size == 0 ? align : size))
+        return p;
+
+    throw std::bad_alloc();
+}
+
+void* operator new[] (std::size_t size, std::align_val_t alignment)
+{
+    return operator new (size, alignment);
+}
+
+void operator delete (void* p) noexcept                                 { if (p != nullptr) RealtimeSafetyChecker::reportViolation ("operator delete"); release (p); }
+void operator delete[] (void* p) noexcept                               { if (p != nullptr) RealtimeSafetyChecker::reportViolation ("operator delete[]"); release (p); }
+void operator delete (void* p, std::size_t) noexcept                    { operator delete (p); }
+void operator delete[] (void* p, std::size_t) noexcept                  { operator delete[] (p); }
+void operator delete (void* p, const std::nothrow_t&) noexcept          { operator delete (p); }
+void operator delete[] (void* p, const std::nothrow_t&) noexcept        { operator delete[] (p); }
+void operator delete (void* p, std::align_val_t) noexcept               { operator delete (p); }
+void operator delete[] (void* p, std::align_val_t) noexcept             { operator delete[] (p); }
+void operator delete (void* p, std::size_t, std::align_val_t) noexcept  { operator delete (p); }
+void operator delete[] (void* p, std::size_t, std::align_val_t) noexcept { operator delete[] (p); }
+
+#endif
+
+//==============================================================================
+#if MYSYNTH_REALTIME_CHECKS && JUCE_LINUX
+
+namespace
+{
+    // Each interposer caches its symbol in a function-local static std::atomic<void*>.
+    // Initialised with nullptr, it is constant-initialised, so unlike a static holding
+    // the dlsym() result it never takes the static-init guard (which may itself lock)
+    template <typename FunctionType>
+    FunctionType findNextSymbol (std::atomic<void*>& cache, const char* name) noexcept
+    {
+        auto* symbol = cache.load (std::memory_order_acquire);
+
+        if (symbol == nullptr)
+        {
+            symbol = dlsym (RTLD_NEXT, name);
+            cache.store (symbol, std::memory_order_release);
+        }
+
+        return reinterpret_cast<FunctionType> (symbol);
+    }
+}
+
+extern "C"
+{
+    void* malloc (size_t size)
+    {
+        RealtimeSafetyChecker::reportViolation ("malloc");
+        return __libc_malloc (size);
+    }
+
+    void* calloc (size_t count, size_t size)
+    {
+        RealtimeSafetyChecker::reportViolation ("calloc");
+        return __libc_calloc (count, size);
+    }
+
+    void* realloc (void* p, size_t size)
+    {
+        RealtimeSafetyChecker::reportViolation ("realloc");
+        return __libc_realloc (p, size);
+    }
+
+    void free (void* p)
+    {
+        if (p != nullptr)
+            RealtimeSafetyChecker::reportViolation ("free");
+
+        __libc_free (p);
+    }
+
+    void* aligned_alloc (size_t alignment, size_t size)
+    {
+        RealtimeSafetyChecker::reportViolation ("aligned_alloc");
+        return __libc_memalign (alignment, size);
+    }
+
+    int posix_memalign (void** result, size_t alignment, size_t size)
+    {
+        RealtimeSafetyChecker::reportViolation ("posix_memalign");
+
+        if (alignment % sizeof (void*) != 0 || ! juce::isPowerOfTwo (alignment))
+            return EINVAL;
+
+        *result = __libc_memalign (alignment, size);
+        return *result != nullptr ? 0 : ENOMEM;
+    }
+
+    int pthread_mutex_lock (pthread_mutex_t* mutex)
+    {
+        using Fn = int (*) (pthread_mutex_t*);
+        static std::atomic<void*> realLockSymbol { nullptr };
+        const auto realLock = findNextSymbol<Fn> (realLockSymbol, "pthread_mutex_lock");
+        static std::atomic<void*> realTryLockSymbol { nullptr };
+        const auto realTryLock = findNextSymbol<Fn> (realTryLockSymbol, "pthread_mutex_trylock");
+
+        if (RealtimeSafetyChecker::isInRealtimeSection())
+        {
+            if (realTryLock (mutex) == 0)
+            {
+                if (RealtimeSafetyChecker::isStrictLockChecking())
+                    RealtimeSafetyChecker::reportViolation ("pthread_mutex_lock (uncontended)");
+
+                return 0;
+            }
+
+            RealtimeSafetyChecker::reportViolation ("pthread_mutex_lock (had to wait)");
+        }
+
+        return realLock (mutex);
+    }
+
+    int pthread_cond_wait (pthread_cond_t* cond, pthread_mutex_t* mutex)
+    {
+        using Fn = int (*) (pthread_cond_t*, pthread_mutex_t*);
+        static std::atomic<void*> realWaitSymbol { nullptr };
+        const auto realWait = findNextSymbol<Fn> (realWaitSymbol, "pthread_cond_wait");
+
+        RealtimeSafetyChecker::reportViolation ("pthread_cond_wait");
+        return realWait (cond, mutex);
+    }
+
+    int pthread_cond_timedwait (pthread_cond_t* cond, pthread_mutex_t* mutex, const struct timespec* abstime)
+    {
+        using Fn = int (*) (pthread_cond_t*, pthread_mutex_t*, const struct timespec*);
+        static std::atomic<void*> realWaitSymbol { nullptr };
+        const auto realWait = findNextSymbol<Fn> (realWaitSymbol, "pthread_cond_timedwait");
+
+        RealtimeSafetyChecker::reportViolation ("pthread_cond_timedwait");
+        return realWait (cond, mutex, abstime);
+    }
+
+    int nanosleep (const struct timespec* duration, struct timespec* remaining)
+    {
+        using Fn = int (*) (const struct timespec*, struct timespec*);
+        static std::atomic<void*> realSleepSymbol { nullptr };
+        const auto realSleep = findNextSymbol<Fn> (realSleepSymbol, "nanosleep");
+
+        RealtimeSafetyChecker::reportViolation ("nanosleep");
+        return realSleep (duration, remaining);
+    }
+
+    int usleep (useconds_t microseconds)
+    {
+        using Fn = int (*) (useconds_t);
+        static std::atomic<void*> realSleepSymbol { nullptr };
+        const auto realSleep = findNextSymbol<Fn> (realSleepSymbol, "usleep");
+
+        RealtimeSafetyChecker::reportViolation ("usleep");
+        return realSleep (microseconds);
+    }
+
+    ssize_t read (int fd, void* buffer, size_t count)
+    {
+        using Fn = ssize_t (*) (int, void*, size_t);
+        static std::atomic<void*> realReadSymbol { nullptr };
+        const auto realRead = findNextSymbol<Fn> (realReadSymbol, "read");
+
+        RealtimeSafetyChecker::reportViolation ("read");
+        return realRead (fd, buffer, count);
+    }
+
+    ssize_t write (int fd, const void* buffer, size_t count)
+    {
+        using Fn = ssize_t (*) (int, const void*, size_t);
+        static std::atomic<void*> realWriteSymbol { nullptr };
+        const auto realWrite = findNextSymbol<Fn> (realWriteSymbol, "write");
+
+        RealtimeSafetyChecker::reportViolation ("write");
+        return realWrite (fd, buffer, count);
+    }
+}
+
+#endif
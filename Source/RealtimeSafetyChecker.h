@@ -0,0 +1,80 @@
+/*
+  ==============================================================================
+
+    RealtimeSafetyChecker.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/** Build with MYSYNTH_REALTIME_CHECKS=1 (e.g. in the exporter's extra
+    preprocessor definitions) to turn on the checker. Otherwise every part of
+    it compiles away.
+*/
+#ifndef MYSYNTH_REALTIME_CHECKS
+ #define MYSYNTH_REALTIME_CHECKS 0
+#endif
+
+//==============================================================================
+/**
+    Catches work that is not real-time safe while a thread is inside a
+    ScopedRealtimeSection, i.e. while it is running processBlock.
+
+    When enabled it:
+    - replaces global operator new/delete and flags any allocation or free
+    - on Linux, also intercepts malloc, calloc, realloc, free and the aligned
+      allocators, pthread mutex and condition waits, sleeps, and read/write
+      calls, and flags them
+
+    Each violation is logged with a stack trace and counted. A harness can
+    check getNumViolations() after a run, or call setAbortOnViolation() to
+    stop at the first one. The standalone app's --realtime-check mode does
+    the latter over the stress scenarios; see OfflineRenderer::runRealtimeCheck().
+
+    Interception works by defining the symbols in the final binary, so it is
+    reliable in the Standalone build and in test executables. A host normally
+    resolves these symbols before the plugin is loaded. By default, mutex
+    locks are only flagged if they actually have to wait, because
+    juce::Synthesiser takes an uncontended lock every block. Call
+    setStrictLockChecking(true) to flag every lock.
+*/
+class RealtimeSafetyChecker
+{
+public:
+   #if MYSYNTH_REALTIME_CHECKS
+    struct ScopedRealtimeSection
+    {
+        ScopedRealtimeSection() noexcept;
+        ~ScopedRealtimeSection() noexcept;
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedRealtimeSection)
+    };
+
+    /** Temporarily lifts the checks, for code that is allowed to block (e.g. diagnostics). */
+    struct ScopedPermit
+    {
+        ScopedPermit() noexcept;
+        ~ScopedPermit() noexcept;
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedPermit)
+    };
+   #else
+    struct ScopedRealtimeSection    { ScopedRealtimeSection() noexcept {} };
+    struct ScopedPermit             { ScopedPermit() noexcept {} };
+   #endif
+
+    static bool isInRealtimeSection() noexcept;
+
+    /** Logs a violation with a stack trace. Does nothing outside a real-time section. */
+    static void reportViolation (const char* description) noexcept;
+
+    static int getNumViolations() noexcept;
+    static void resetViolations() noexcept;
+
+    static void setAbortOnViolation (bool shouldAbort) noexcept;
+    static void setStrictLockChecking (bool shouldFlagEveryLock) noexcept;
+    static bool isStrictLockChecking() noexcept;
+};
@@ -0,0 +1,324 @@
+/*
+  ==============================================================================
+
+    SampleExporter.cpp
+
+  ==============================================================================
+*/
+
+#include "SampleExporter.h"
+#include "PluginProcessor.h"
+#include "OfflineRenderer.h"
+#include <iostream>
+
+namespace
+{
+    double secondsSince(juce::int64 startTicks)
+    {
+        return juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+    }
+
+    // One past the last sample of the block above the threshold, or 0 if none is
+    int findEndOfSound(const juce::AudioBuffer<float>& block, float threshold)
+    {
+        auto end = 0;
+
+        for (int ch = 0; ch < block.getNumChannels(); ++ch)
+        {
+            auto* samples = block.getReadPointer(ch);
+
+            for (int i = block.getNumSamples(); i > end; --i)
+            {
+                if (std::abs(samples[i - 1]) > threshold)
+                {
+                    end = i;
+                    break;
+                }
+            }
+        }
+
+        return end;
+    }
+
+    juce::String getFileName(int note, int velocity)
+    {
+        // Note number first, so the files sort by pitch
+        return juce::String(note).paddedLeft('0', 3) + "_" + juce::MidiMessage::getMidiNoteName(note, true, true, 4)
+                 + "_v" + juce::String(velocity).paddedLeft('0', 3) + ".wav";
+    }
+}
+
+//==============================================================================
+class SampleExporter::RenderJob  : public juce::ThreadPoolJob
+{
+public:
+    RenderJob(const juce::MemoryBlock& s, const Options& o, const juce::File& d, Sample& result)
+        : juce::ThreadPoolJob("Sample export"), state(s), options(o), directory(d), sample(result)
+    {
+    }
+
+    JobStatus runJob() override
+    {
+        auto startTicks = juce::Time::getHighResolutionTicks();
+
+        MysynthpracAudioProcessor processor;
+
+        if (state.getSize() > 0)
+            processor.setStateInformation(state.getData(), (int) state.getSize());
+
+        auto audio = renderNote(processor, options, sample.note, sample.velocity);
+        sample.lengthInSamples = audio.getNumSamples();
+
+        if (sample.lengthInSamples > 0)
+        {
+            sample.peak = audio.getMagnitude(0, sample.lengthInSamples);
+            sample.written = OfflineRenderer::writeWav(directory.getChildFile(sample.fileName), audio,
+                                                       options.sampleRate, options.bitsPerSample);
+        }
+
+        sample.renderSeconds = secondsSince(startTicks);
+        return jobHasFinished;
+    }
+
+private:
+    const juce::MemoryBlock& state;
+    const Options& options;
+    const juce::File directory;
+    Sample& sample;
+
+    JUCE_DECLARE_NON_COPYABLE (RenderJob)
+};
+
+//==============================================================================
+juce::AudioBuffer<float> SampleExporter::renderNote(MysynthpracAudioProcessor& processor, const Options& options, int note, int velocity)
+{
+    // Non-realtime, so the voices render at the offline quality tier
+    processor.setNonRealtime(true);
+    processor.setRateAndBufferSizeDetails(options.sampleRate, options.blockSize);
+    processor.prepareToPlay(options.sampleRate, options.blockSize);
+
+    // prepareToPlay() drops the reverb's engine and rebuilds it in the background, which
+    // a render running faster than real time would otherwise start without
+    processor.waitForImpulseResponse();
+
+    const auto numChannels = processor.getTotalNumOutputChannels();
+    const auto latency = processor.getLatencySamples();
+
+    // The MIDI goes in at the plugin's input time; only the output, which arrives latency samples late, is shifted
+    const auto noteOffSample = juce::roundToInt(options.holdSeconds * options.sampleRate);
+    const auto maxLength = latency + noteOffSample + juce::roundToInt(options.maxTailSeconds * options.sampleRate);
+    const auto silenceLength = juce::roundToInt(options.silenceSeconds * options.sampleRate);
+    const auto threshold = juce::Decibels::decibelsToGain(options.tailThresholdDb);
+
+    juce::AudioBuffer<float> output(numChannels, maxLength);
+    juce::MidiBuffer midi;
+    auto position = 0, endOfSound = 0;
+
+    while (position < maxLength)
+    {
+        auto numSamples = juce::jmin(options.blockSize, maxLength - position);
+
+        midi.clear();
+
+        if (position == 0)
+            midi.addEvent(juce::MidiMessage::noteOn(options.midiChannel, note, (juce::uint8) velocity), 0);
+
+        if (noteOffSample >= position && noteOffSample < position + numSamples)
+            midi.addEvent(juce::MidiMessage::noteOff(options.midiChannel, note), noteOffSample - position);
+
+        juce::AudioBuffer<float> block(output.getArrayOfWritePointers(), numChannels, position, numSamples);
+        block.clear();
+        processor.processBlock(block, midi);
+
+        if (auto end = findEndOfSound(block, threshold); end > 0)
+            endOfSound = position + end;
+
+        position += numSamples;
+
+        // Once the note is released, the render ends when the tail has been quiet for long enough
+        if (position > latency + noteOffSample && position - endOfSound >= silenceLength)
+            break;
+    }
+
+    processor.releaseResources();
+
+    // The file starts at the note-on and ends where the sound does
+    const auto length = juce::jmax(0, endOfSound - latency);
+    juce::AudioBuffer<float> sample(numChannels, length);
+
+    for (int ch = 0; ch < numChannels; ++ch)
+        sample.copyFrom(ch, 0, output, ch, latency, length);
+
+    // A few milliseconds of fade so the cut is never a click
+    auto fadeLength = juce::jmin(length, juce::roundToInt(0.005 * options.sampleRate));
+    sample.applyGainRamp(length - fadeLength, fadeLength, 1.0f, 0.0f);
+
+    return sample;
+}
+
+SampleExporter::Report SampleExporter::exportSamples(const juce::MemoryBlock& state, const juce::File& directory, const Options& options)
+{
+    Report report;
+    directory.createDirectory();
+
+    const auto lowestNote = juce::jlimit(0, 127, options.lowestNote);
+    const auto highestNote = juce::jlimit(lowestNote, 127, options.highestNote);
+    const auto noteStep = juce::jmax(1, options.noteStep);
+    const auto numLayers = juce::jlimit(1, 127, options.numVelocityLayers);
+
+    for (int note = lowestNote; note <= highestNote; note += noteStep)
+    {
+        for (int layer = 0; layer < numLayers; ++layer)
+        {
+            // Each layer is rendered at the top of its velocity range
+            Sample sample;
+            sample.note = note;
+            sample.lowNote = note;
+            sample.highNote = juce::jmin(highestNote, note + noteStep - 1);
+            sample.lowVelocity = 1 + layer * 127 / numLayers;
+            sample.highVelocity = (layer + 1) * 127 / numLayers;
+            sample.velocity = sample.highVelocity;
+            sample.fileName = getFileName(note, sample.velocity);
+            report.samples.push_back(sample);
+        }
+    }
+
+    // The last zone reaches the highest note even when the step doesn't land on it
+    if (! report.samples.empty())
+        for (auto it = report.samples.rbegin(); it != report.samples.rend() && it->note == report.samples.back().note; ++it)
+            it->highNote = highestNote;
+
+    report.numThreads = options.numThreads > 0 ? options.numThreads : juce::SystemStats::getNumCpus();
+
+    auto startTicks = juce::Time::getHighResolutionTicks();
+
+    {
+        juce::ThreadPool pool(report.numThreads);
+        std::vector<std::unique_ptr<RenderJob>> jobs;
+
+        for (auto& sample : report.samples)
+        {
+            jobs.push_back(std::make_unique<RenderJob>(state, options, directory, sample));
+            pool.addJob(jobs.back().get(), false);
+        }
+
+        for (auto& job : jobs)
+            pool.waitForJobToFinish(job.get(), -1);
+    }
+
+    report.wallSeconds = secondsSince(startTicks);
+
+    auto* manifest = new juce::DynamicObject();
+    juce::var manifestData(manifest);
+    juce::Array<juce::var> entries;
+
+    manifest->setProperty("sampleRate", options.sampleRate);
+    manifest->setProperty("bitsPerSample", options.bitsPerSample);
+
+    for (auto& sample : report.samples)
+    {
+        if (! sample.written)
+            continue;
+
+        auto* entry = new juce::DynamicObject();
+        entry->setProperty("file", sample.fileName);
+        entry->setProperty("note", sample.note);
+        entry->setProperty("lowNote", sample.lowNote);
+        entry->setProperty("highNote", sample.highNote);
+        entry->setProperty("velocity", sample.velocity);
+        entry->setProperty("lowVelocity", sample.lowVelocity);
+        entry->setProperty("highVelocity", sample.highVelocity);
+        entry->setProperty("lengthInSamples", sample.lengthInSamples);
+        entry->setProperty("peakDb", (double) juce::Decibels::gainToDecibels(sample.peak));
+        entries.add(juce::var(entry));
+    }
+
+    manifest->setProperty("samples", entries);
+
+    report.manifest = directory.getChildFile("manifest.json");
+    report.manifest.replaceWithText(juce::JSON::toString(manifestData));
+
+    return report;
+}
+
+juce::String SampleExporter::describe(const Report& report)
+{
+    auto numWritten = 0, numSilent = 0;
+    auto renderSeconds = 0.0;
+    juce::String failures;
+
+    for (auto& sample : report.samples)
+    {
+        renderSeconds += sample.renderSeconds;
+
+        if (sample.written)
+            ++numWritten;
+        else if (sample.lengthInSamples == 0)
+            ++numSilent;
+        else
+            failures << "couldn't write " << sample.fileName << "\n";
+    }
+
+    juce::String text;
+    text << numWritten << " of " << (int) report.samples.size() << " samples written";
+
+    if (numSilent > 0)
+        text << " (" << numSilent << " silent)";
+
+    text << " in " << juce::String(report.wallSeconds, 2) << " s on " << report.numThreads << " threads";
+
+    if (report.wallSeconds > 0.0)
+        text << ", " << juce::String(renderSeconds / report.wallSeconds, 1) << "x one thread";
+
+    return text << "\n" << failures << "manifest: " << report.manifest.getFullPathName() << "\n";
+}
+
+int SampleExporter::runFromCommandLine(const juce::String& commandLine)
+{
+    Options options;
+    juce::File directory, stateFile;
+
+    for (auto& argument : juce::StringArray::fromTokens(commandLine, true))
+    {
+        auto value = argument.fromFirstOccurrenceOf("=", false, false);
+
+        if (argument.startsWith("--export-samples="))     directory = juce::File(value.unquoted());
+        else if (argument.startsWith("--state="))         stateFile = juce::File(value.unquoted());
+        else if (argument.startsWith("--notes="))
+        {
+            options.lowestNote = value.upToFirstOccurrenceOf("-", false, false).getIntValue();
+            options.highestNote = value.containsChar('-') ? value.fromFirstOccurrenceOf("-", false, false).getIntValue() : options.lowestNote;
+        }
+        else if (argument.startsWith("--note-step="))     options.noteStep = juce::jmax(1, value.getIntValue());
+        else if (argument.startsWith("--velocities="))    options.numVelocityLayers = juce::jlimit(1, 127, value.getIntValue());
+        else if (argument.startsWith("--hold="))          options.holdSeconds = juce::jmax(0.01, value.getDoubleValue());
+        else if (argument.startsWith("--max-tail="))      options.maxTailSeconds = juce::jmax(0.0, value.getDoubleValue());
+        else if (argument.startsWith("--threshold-db="))  options.tailThresholdDb = (float) value.getDoubleValue();
+        else if (argument.startsWith("--sample-rate="))   options.sampleRate = juce::jmax(8000.0, value.getDoubleValue());
+        else if (argument.startsWith("--bit-depth="))     options.bitsPerSample = value.getIntValue();
+        else if (argument.startsWith("--threads="))       options.numThreads = juce::jmax(0, value.getIntValue());
+    }
+
+    if (directory == juce::File() || (options.bitsPerSample != 16 && options.bitsPerSample != 24 && options.bitsPerSample != 32))
+    {
+        std::cout << "Usage: --export-samples=<directory> [--state=<file>] [--bit-depth=16|24|32], see SampleExporter.h\n" << std::flush;
+        return 1;
+    }
+
+    juce::MemoryBlock state;
+
+    if (stateFile != juce::File() && ! stateFile.loadFileAsData(state))
+    {
+        std::cout << "Couldn't read " << stateFile.getFullPathName() << "\n" << std::flush;
+        return 1;
+    }
+
+    auto report = exportSamples(state, directory, options);
+    std::cout << describe(report) << std::flush;
+
+    for (auto& sample : report.samples)
+        if (! sample.written && sample.lengthInSamples > 0)
+            return 1;
+
+    return 0;
+}
@@ -0,0 +1,90 @@
+/*
+  ==============================================================================
+
+    SampleExporter.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+class MysynthpracAudioProcessor;
+
+//==============================================================================
+/**
+    Renders a saved plugin state as a multisampled instrument: one WAV for every
+    note and velocity layer, plus a manifest.json describing the key and
+    velocity range each file covers, for samplers on machines that can't run
+    the synth.
+
+    Every render gets a fresh processor restored from the state, so nothing
+    carries over from one note to the next, and the renders are spread across
+    a thread pool with one thread per core. Each file starts at the note-on,
+    with any plugin latency removed, and ends where the tail falls below the
+    threshold, with a short fade.
+
+    Start the standalone app with --export-samples=<directory> to run it; see
+    runFromCommandLine() for the options.
+*/
+class SampleExporter
+{
+public:
+    struct Options
+    {
+        int lowestNote = 21, highestNote = 108;
+        int noteStep = 1;                   // render every Nth note; each file covers the keys up to the next one
+        int numVelocityLayers = 4;
+        int midiChannel = 1;
+
+        double sampleRate = 48000.0;
+        int blockSize = 512;
+        int bitsPerSample = 24;
+
+        double holdSeconds = 2.0;
+        double maxTailSeconds = 10.0;       // after the note-off
+        double silenceSeconds = 0.5;        // how long the output must stay quiet to count as finished
+        float tailThresholdDb = -80.0f;
+
+        int numThreads = 0;                 // 0 for one per core
+    };
+
+    struct Sample
+    {
+        int note = 0, lowNote = 0, highNote = 0;
+        int velocity = 0, lowVelocity = 0, highVelocity = 0;
+        juce::String fileName;
+        int lengthInSamples = 0;
+        float peak = 0.0f;
+        double renderSeconds = 0.0;
+        bool written = false;
+    };
+
+    struct Report
+    {
+        std::vector<Sample> samples;
+        juce::File manifest;
+        int numThreads = 0;
+        double wallSeconds = 0.0;
+    };
+
+    /** Renders one note with a processor that already has its state, trimmed as it would be exported. */
+    static juce::AudioBuffer<float> renderNote(MysynthpracAudioProcessor& processor, const Options& options, int note, int velocity);
+
+    /** Renders every note and layer of the state into the directory, and blocks until they are all written.
+        An empty state exports the default patch. Notes that make no sound are left out.
+    */
+    static Report exportSamples(const juce::MemoryBlock& state, const juce::File& directory, const Options& options);
+
+    static juce::String describe(const Report& report);
+
+    /** Options: --export-samples=dir --state=file --notes=21-108 --note-step=N --velocities=N
+        --hold=s --max-tail=s --threshold-db=X --sample-rate=X --bit-depth=16|24|32 --threads=N.
+        The state file is one saved from the standalone app's options menu. Returns the process exit code.
+    */
+    static int runFromCommandLine(const juce::String& commandLine);
+
+private:
+    class RenderJob;
+};
@@ -0,0 +1,90 @@
+/*
+  ==============================================================================
+
+    SharedResources.cpp
+
+  ==============================================================================
+*/
+
+#include "SharedResources.h"
+#include "RealtimeSafetyChecker.h"
+
+SharedResources::SharedResources()
+    // Background jobs are short, so a couple of threads are plenty however many instances there are
+    : workerPool(juce::jlimit(1, 2, juce::SystemStats::getNumCpus() / 2))
+{
+}
+
+SharedResources::~SharedResources()
+{
+    workerPool.removeAllJobs(true, 2000);
+}
+
+const juce::dsp::FFT& SharedResources::getFFT(int order)
+{
+    jassert(order >= 0 && order <= maxFFTOrder);
+
+    const juce::ScopedLock sl(fftLock);
+    auto& fft = ffts[(size_t) juce::jlimit(0, maxFFTOrder, order)];
+
+    if (fft == nullptr)
+        fft = std::make_unique<juce::dsp::FFT>(order);
+
+    return *fft;
+}
+
+//==============================================================================
+SharedResources::StreamingWorker::StreamingWorker()
+    : juce::Thread("Streaming worker")
+{
+}
+
+SharedResources::StreamingWorker::~StreamingWorker()
+{
+    jassert(clients.isEmpty());
+    stopThread(2000);
+}
+
+void SharedResources::StreamingWorker::addClient(Client& client)
+{
+    const juce::ScopedLock sl(lock);
+    clients.addIfNotAlreadyThere(&client);
+
+    if (! isThreadRunning())
+        startThread(juce::Thread::Priority::high);
+
+    notify();
+}
+
+void SharedResources::StreamingWorker::removeClient(Client& client)
+{
+    // The worker holds the lock for a whole pass, so once this has it the client is out of use
+    const juce::ScopedLock sl(lock);
+    clients.removeFirstMatchingValue(&client);
+}
+
+void SharedResources::StreamingWorker::wake() noexcept
+{
+    // The event's mutex is only ever held for a signal or the start and end of a wait
+    RealtimeSafetyChecker::ScopedPermit briefLock;
+    notify();
+}
+
+void SharedResources::StreamingWorker::run()
+{
+    while (! threadShouldExit())
+    {
+        auto didWork = false;
+
+        {
+            const juce::ScopedLock sl(lock);
+
+            for (auto* client : clients)
+                didWork = client->processNext() || didWork;
+        }
+
+        // A wake() that came during the pass leaves the event signalled, so nothing is missed
+        if (! didWork)
+            wait(-1);
+    }
+}
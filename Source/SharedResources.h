@@ -0,0 +1,96 @@
+/*
+  ==============================================================================
+
+    SharedResources.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    What every plugin instance in the host process can share. Hold it through a
+    juce::SharedResourcePointer<SharedResources>: it is created with the first
+    instance and deleted with the last, so a session with fifty instances still
+    has one worker pool and one set of FFT plans.
+
+    Nothing here may be used from the audio thread, apart from
+    StreamingWorker::wake(), which may briefly take a lock; see its comment.
+*/
+class SharedResources
+{
+public:
+    //==============================================================================
+    /**
+        One high-priority thread for work that has to keep up with the audio
+        threads, such as convolution tails, shared by every client so fifty
+        reverbs don't mean fifty threads. It goes round the clients doing one
+        unit of work from each until none has any left, then sleeps until woken.
+    */
+    class StreamingWorker  : private juce::Thread
+    {
+    public:
+        struct Client
+        {
+            virtual ~Client() = default;
+
+            /** Does one unit of work if there is any, and returns false if there wasn't. Called on the worker thread. */
+            virtual bool processNext() noexcept = 0;
+        };
+
+        StreamingWorker();
+        ~StreamingWorker() override;
+
+        /** The thread is started with the first client. */
+        void addClient(Client& client);
+
+        /** Blocks until the worker has finished with the client, so call it before deleting one. */
+        void removeClient(Client& client);
+
+        /** Tells the worker there is new work. Called from the audio thread.
+
+            Signalling the worker's event briefly takes the mutex it sleeps on, so this can
+            wait for the few instructions the worker spends going into or out of its sleep.
+            That lock is never held across any work, and the real-time checker allows it.
+        */
+        void wake() noexcept;
+
+    private:
+        void run() override;
+
+        juce::CriticalSection lock;
+        juce::Array<Client*> clients;
+
+        JUCE_DECLARE_NON_COPYABLE (StreamingWorker)
+    };
+
+    //==============================================================================
+    SharedResources();
+    ~SharedResources();
+
+    /** A small pool for background work such as rebuilding wavetables. Jobs must not
+        outlive their owners: remove them with removeAllJobs() and a JobSelector.
+    */
+    juce::ThreadPool& getWorkerPool() noexcept     { return workerPool; }
+
+    StreamingWorker& getStreamingWorker() noexcept  { return streamingWorker; }
+
+    /** FFT plans are read-only once made, so one per size serves every instance.
+        Created on first use.
+    */
+    const juce::dsp::FFT& getFFT(int order);
+
+private:
+    static constexpr int maxFFTOrder = 16;
+
+    juce::ThreadPool workerPool;
+    StreamingWorker streamingWorker;
+
+    juce::CriticalSection fftLock;
+    std::array<std::unique_ptr<juce::dsp::FFT>, maxFFTOrder + 1> ffts;
+
+    JUCE_DECLARE_NON_COPYABLE (SharedResources)
+};
@@ -0,0 +1,417 @@
+/*
+  ==============================================================================
+
+    SimdKernels.cpp
+
+  ==============================================================================
+*/
+
+#include "SimdKernels.h"
+#include <iostream>
+
+#if JUCE_INTEL && (JUCE_GCC || JUCE_CLANG)
+ #define MYSYNTH_ISA_VARIANTS 1
+ #define MYSYNTH_TARGET_AVX2     __attribute__ ((target ("avx2,fma")))
+ #define MYSYNTH_TARGET_AVX512   __attribute__ ((target ("avx512f,avx512vl,avx2,fma")))
+#else
+ #define MYSYNTH_ISA_VARIANTS 0
+#endif
+
+namespace SimdKernels
+{
+namespace
+{
+    // Positions are worked out a chunk at a time into these, then the table is read
+    constexpr int chunkSize = 64;
+
+    //==============================================================================
+    template <Interpolation interpolation>
+    forcedinline float renderWavetable (const float* table, int tableSize, float index, float delta, float* output, int numSamples) noexcept
+    {
+        const auto mask = tableSize - 1;
+        alignas (64) int indices[chunkSize];
+        alignas (64) float fractions[chunkSize];
+
+        for (int start = 0; start < numSamples; start += chunkSize)
+        {
+            const auto numThisTime = juce::jmin (chunkSize, numSamples - start);
+            auto* out = output + start;
+
+            for (int i = 0; i < numThisTime; ++i)
+            {
+                auto position = index + (float) i * delta;
+
+                if constexpr (interpolation == Interpolation::nearest)
+                {
+                    indices[i] = (int) (position + 0.5f) & mask;
+                }
+                else
+                {
+                    auto whole = (int) position;
+                    fractions[i] = position - (float) whole;
+                    indices[i] = whole & mask;
+                }
+            }
+
+            for (int i = 0; i < numThisTime; ++i)
+            {
+                const auto index0 = indices[i];
+
+                if constexpr (interpolation == Interpolation::nearest)
+                {
+                    out[i] = table[index0];
+                }
+                else if constexpr (interpolation == Interpolation::linear)
+                {
+                    // The guard sample covers index0 + 1
+                    out[i] = table[index0] + fractions[i] * (table[index0 + 1] - table[index0]);
+                }
+                else
+                {
+                    // 4-point, 3rd-order Hermite
+                    auto frac = fractions[i];
+                    auto ym1 = table[(index0 - 1) & mask];
+                    auto y0 = table[index0];
+                    auto y1 = table[index0 + 1];
+                    auto y2 = table[(index0 + 2) & mask];
+
+                    auto c1 = 0.5f * (y1 - ym1);
+                    auto c2 = ym1 - 2.5f * y0 + 2.0f * y1 - 0.5f * y2;
+                    auto c3 = 0.5f * (y2 - ym1) + 1.5f * (y0 - y1);
+
+                    out[i] = ((c3 * frac + c2) * frac + c1) * frac + y0;
+                }
+            }
+
+            auto next = index + (float) numThisTime * delta;
+            auto whole = (int) next;
+            index = (float) (whole & mask) + (next - (float) whole);
+        }
+
+        return index;
+    }
+
+    template <bool modulated>
+    forcedinline void renderPhaseOperatorChunk (const float* table, int tableSize, float phase, float increment,
+                                                const float* modulation, float* output, int numSamples) noexcept
+    {
+        const auto mask = tableSize - 1;
+        const auto size = (float) tableSize;
+        alignas (64) int indices[chunkSize];
+        alignas (64) float fractions[chunkSize];
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            auto p = phase + (float) i * increment;
+
+            if constexpr (modulated)
+                p += modulation[i];
+
+            // Phases can be anywhere after modulation; truncation and a correction wraps them into 0-1
+            p -= (float) (int) p;
+            p += p < 0.0f ? 1.0f : 0.0f;
+
+            // A phase that rounded up to exactly 1 reads sample 0 with a fraction of 0
+            auto position = p * size;
+            auto whole = (int) position;
+            fractions[i] = position - (float) whole;
+            indices[i] = whole & mask;
+        }
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            auto y0 = table[indices[i]];
+            auto y1 = table[indices[i] + 1];
+            output[i] = y0 + fractions[i] * (y1 - y0);
+        }
+    }
+
+    forcedinline void renderPhaseOperator (const float* table, int tableSize, float phase, float increment,
+                                           const float* modulation, float* output, int numSamples) noexcept
+    {
+        for (int start = 0; start < numSamples; start += chunkSize)
+        {
+            const auto numThisTime = juce::jmin (chunkSize, numSamples - start);
+            const auto chunkPhase = phase + (float) start * increment;
+
+            if (modulation != nullptr)
+                renderPhaseOperatorChunk<true> (table, tableSize, chunkPhase, increment, modulation + start, output + start, numThisTime);
+            else
+                renderPhaseOperatorChunk<false> (table, tableSize, chunkPhase, increment, nullptr, output + start, numThisTime);
+        }
+    }
+
+    forcedinline void mixInto (float* destination, const float* source, float startGain, float endGain, int numSamples) noexcept
+    {
+        if (startGain == endGain)
+        {
+            for (int i = 0; i < numSamples; ++i)
+                destination[i] += source[i] * startGain;
+
+            return;
+        }
+
+        // As AudioBuffer::addFromWithRamp: the first sample gets startGain
+        const auto step = (endGain - startGain) / (float) numSamples;
+
+        for (int i = 0; i < numSamples; ++i)
+            destination[i] += source[i] * (startGain + (float) i * step);
+    }
+
+    //==============================================================================
+    // Stamps out one copy of every kernel, compiled for the given target
+    #define MYSYNTH_DEFINE_KERNELS(name, isaValue, target) \
+        namespace name \
+        { \
+            target float wavetableNearest (const float* t, int size, float index, float delta, float* out, int n) noexcept   { return renderWavetable<Interpolation::nearest> (t, size, index, delta, out, n); } \
+            target float wavetableLinear (const float* t, int size, float index, float delta, float* out, int n) noexcept    { return renderWavetable<Interpolation::linear> (t, size, index, delta, out, n); } \
+            target float wavetableHermite (const float* t, int size, float index, float delta, float* out, int n) noexcept   { return renderWavetable<Interpolation::hermite> (t, size, index, delta, out, n); } \
+            target void phaseOperator (const float* t, int size, float phase, float increment, const float* modulation, float* out, int n) noexcept \
+                { renderPhaseOperator (t, size, phase, increment, modulation, out, n); } \
+            target void mix (float* destination, const float* source, float startGain, float endGain, int n) noexcept \
+                { mixInto (destination, source, startGain, endGain, n); } \
+            \
+            const Kernels kernels { isaValue, { wavetableNearest, wavetableLinear, wavetableHermite }, phaseOperator, mix }; \
+        }
+
+    MYSYNTH_DEFINE_KERNELS (baseline, Isa::baseline, )
+
+   #if MYSYNTH_ISA_VARIANTS
+    MYSYNTH_DEFINE_KERNELS (avx2, Isa::avx2, MYSYNTH_TARGET_AVX2)
+    MYSYNTH_DEFINE_KERNELS (avx512, Isa::avx512, MYSYNTH_TARGET_AVX512)
+   #endif
+
+    #undef MYSYNTH_DEFINE_KERNELS
+
+    Isa getBestIsa() noexcept
+    {
+        for (auto isa : { Isa::avx512, Isa::avx2 })
+            if (isSupported (isa))
+                return isa;
+
+        return Isa::baseline;
+    }
+
+    // Why the active kernels are what they are, when MYSYNTH_FORCE_ISA had a say
+    juce::String selectionNote;
+
+    void reportForcedIsa (const juce::String& message)
+    {
+        selectionNote = message;
+
+        // The logger may not be set up yet this early, so it goes to stderr too
+        juce::Logger::writeToLog (message);
+        std::cerr << message << std::endl;
+    }
+
+    Isa chooseIsa()
+    {
+        auto best = getBestIsa();
+        auto forced = juce::SystemStats::getEnvironmentVariable ("MYSYNTH_FORCE_ISA", {}).trim().toLowerCase();
+
+        if (forced.isEmpty())
+            return best;
+
+        for (int i = 0; i < numIsas; ++i)
+        {
+            auto isa = (Isa) i;
+
+            if (forced == getName (isa).toLowerCase().removeCharacters ("-") || (forced == "baseline" && isa == Isa::baseline))
+            {
+                if (isSupported (isa))
+                {
+                    selectionNote = "forced by MYSYNTH_FORCE_ISA=" + forced;
+                    return isa;
+                }
+
+                reportForcedIsa ("MYSYNTH_FORCE_ISA=" + forced + " isn't supported on this CPU, using " + getName (best));
+                return best;
+            }
+        }
+
+        reportForcedIsa ("Unknown MYSYNTH_FORCE_ISA=" + forced + ", using " + getName (best));
+        return best;
+    }
+}
+
+//==============================================================================
+const Kernels& get()
+{
+    static const Kernels& chosen = *getKernels (chooseIsa());
+    return chosen;
+}
+
+const Kernels* getKernels (Isa isa) noexcept
+{
+    if (! isSupported (isa))
+        return nullptr;
+
+    switch (isa)
+    {
+       #if MYSYNTH_ISA_VARIANTS
+        case Isa::avx2:     return &avx2::kernels;
+        case Isa::avx512:   return &avx512::kernels;
+       #endif
+        case Isa::baseline:
+        default:            return &baseline::kernels;
+    }
+}
+
+bool isSupported (Isa isa) noexcept
+{
+    switch (isa)
+    {
+       #if MYSYNTH_ISA_VARIANTS
+        case Isa::avx2:     return juce::SystemStats::hasAVX2() && juce::SystemStats::hasFMA3();
+        case Isa::avx512:   return juce::SystemStats::hasAVX512F() && juce::SystemStats::hasAVX512VL()
+                                    && juce::SystemStats::hasAVX2() && juce::SystemStats::hasFMA3();
+       #endif
+        case Isa::baseline: return true;
+        default:            return false;
+    }
+}
+
+juce::String getName (Isa isa)
+{
+    switch (isa)
+    {
+        case Isa::avx2:     return "AVX2";
+        case Isa::avx512:   return "AVX-512";
+        case Isa::baseline:
+        default:
+           #if JUCE_INTEL
+            return "SSE2";
+           #elif JUCE_ARM
+            return "NEON";
+           #else
+            return "generic";
+           #endif
+    }
+}
+
+//==============================================================================
+std::vector<BenchmarkResult> runBenchmark()
+{
+    constexpr int tableSize = 2048, blockSize = chunkSize, numBlocks = 20000, numRuns = 5, numCheckedBlocks = 64;
+
+    std::vector<float> table ((size_t) tableSize + 1);
+    for (int i = 0; i <= tableSize; ++i)
+        table[(size_t) i] = (float) std::sin (juce::MathConstants<double>::twoPi * (i % tableSize) / tableSize);
+
+    std::vector<float> modulation ((size_t) blockSize);
+    for (int i = 0; i < blockSize; ++i)
+        modulation[(size_t) i] = 0.3f * table[(size_t) (i * 37) % (size_t) tableSize];
+
+    const auto delta = 440.0f * (float) tableSize / 48000.0f;
+    const auto increment = 440.0f / 48000.0f;
+
+    // Each case renders numBlocks blocks from the same starting state, moving the
+    // output on by outputStride samples per block
+    using RenderFunction = std::function<void (const Kernels&, float* output, int numBlocks, int outputStride)>;
+
+    auto wavetableCase = [&] (Interpolation interpolation)
+    {
+        return RenderFunction ([&, interpolation] (const Kernels& k, float* output, int blocks, int stride)
+        {
+            auto index = 0.0f;
+            for (int b = 0; b < blocks; ++b)
+                index = k.renderWavetable[(size_t) interpolation] (table.data(), tableSize, index, delta, output + b * stride, blockSize);
+        });
+    };
+
+    std::vector<std::pair<juce::String, RenderFunction>> cases
+    {
+        { "wavetable nearest", wavetableCase (Interpolation::nearest) },
+        { "wavetable linear",  wavetableCase (Interpolation::linear) },
+        { "wavetable hermite", wavetableCase (Interpolation::hermite) },
+        { "phase operator", [&] (const Kernels& k, float* output, int blocks, int stride)
+            {
+                auto phase = 0.0f;
+                for (int b = 0; b < blocks; ++b)
+                {
+                    k.renderPhaseOperator (table.data(), tableSize, phase, increment, modulation.data(), output + b * stride, blockSize);
+                    phase += (float) blockSize * increment;
+                    phase -= (float) (int) phase;
+                }
+            } },
+        { "voice mix", [&] (const Kernels& k, float* output, int blocks, int stride)
+            {
+                for (int b = 0; b < blocks; ++b)
+                    k.mixInto (output + b * stride, table.data() + (b * 29) % (tableSize - blockSize), 0.5f, (b % 2) == 0 ? 0.5f : 0.7f, blockSize);
+            } }
+    };
+
+    std::vector<BenchmarkResult> results;
+    std::vector<float> reference ((size_t) (numCheckedBlocks * blockSize)), checked (reference.size()), timed ((size_t) blockSize);
+
+    for (auto& [name, render] : cases)
+    {
+        std::fill (reference.begin(), reference.end(), 0.0f);
+        render (*getKernels (Isa::baseline), reference.data(), numCheckedBlocks, blockSize);
+
+        for (int i = 0; i < numIsas; ++i)
+        {
+            auto* kernels = getKernels ((Isa) i);
+
+            if (kernels == nullptr)
+                continue;
+
+            BenchmarkResult result;
+            result.kernel = name;
+            result.isa = kernels->isa;
+
+            std::fill (checked.begin(), checked.end(), 0.0f);
+            render (*kernels, checked.data(), numCheckedBlocks, blockSize);
+
+            for (size_t s = 0; s < checked.size(); ++s)
+                result.maxDifference = juce::jmax (result.maxDifference, std::abs (checked[s] - reference[s]));
+
+            // The best of several runs, rendering into one block as a voice's scratch
+            auto bestSeconds = std::numeric_limits<double>::max();
+
+            for (int run = 0; run < numRuns; ++run)
+            {
+                std::fill (timed.begin(), timed.end(), 0.0f);
+                auto startTicks = juce::Time::getHighResolutionTicks();
+                render (*kernels, timed.data(), numBlocks, 0);
+                bestSeconds = juce::jmin (bestSeconds, juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - startTicks));
+            }
+
+            result.nanosecondsPerSample = bestSeconds * 1.0e9 / (double) (numBlocks * blockSize);
+            results.push_back (result);
+        }
+    }
+
+    return results;
+}
+
+juce::String describe (const std::vector<BenchmarkResult>& results)
+{
+    juce::String text;
+    text << "Active kernels: " << getName (get().isa);
+
+    if (selectionNote.isNotEmpty())
+        text << " (" << selectionNote << ")";
+
+    text << ", best supported: " << getName (getBestIsa()) << "\n";
+
+    auto baselineTime = 0.0;
+
+    for (auto& result : results)
+    {
+        if (result.isa == Isa::baseline)
+            baselineTime = result.nanosecondsPerSample;
+
+        text << result.kernel << " [" << getName (result.isa) << "]: "
+             << juce::String (result.nanosecondsPerSample, 3) << " ns/sample";
+
+        if (result.isa != Isa::baseline && result.nanosecondsPerSample > 0.0)
+            text << ", " << juce::String (baselineTime / result.nanosecondsPerSample, 2) << "x baseline"
+                 << ", max difference " << juce::String (result.maxDifference, 8);
+
+        text << "\n";
+    }
+
+    return text;
+}
+}
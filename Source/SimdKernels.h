@@ -0,0 +1,88 @@
+/*
+  ==============================================================================
+
+    SimdKernels.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    The engine's hot inner loops, compiled once for each instruction set and
+    bound to the best one the CPU supports when first used. The build itself
+    still targets the lowest common denominator, so one binary runs everywhere.
+
+    Each kernel is written once as plain loops with no dependencies between
+    samples; the per-ISA copies only differ in what the compiler is allowed to
+    vectorise them with. Per-function targets need GCC or Clang on x86, so other
+    builds only have the baseline.
+
+    Set MYSYNTH_FORCE_ISA to sse2, avx2 or avx512 to override the choice for
+    testing. An ISA the CPU can't run is ignored.
+*/
+namespace SimdKernels
+{
+    enum class Isa
+    {
+        baseline = 0,   // SSE2 on x86-64
+        avx2,
+        avx512
+    };
+
+    constexpr int numIsas = 3;
+
+    /** How a wavetable is read between its samples. */
+    enum class Interpolation
+    {
+        nearest = 0,
+        linear,
+        hermite
+    };
+
+    /** Reads a table whose size (without the guard sample) is a power of two, starting at
+        index and moving delta samples each step. Returns the index to carry on from.
+    */
+    using WavetableFunction = float (*) (const float* table, int tableSize, float index, float delta, float* output, int numSamples);
+
+    /** One sine operator with phases in cycles, linearly interpolated. modulation is added
+        to each sample's phase, and may be nullptr. The output may be the modulation buffer.
+    */
+    using PhaseOperatorFunction = void (*) (const float* table, int tableSize, float phase, float increment,
+                                            const float* modulation, float* output, int numSamples);
+
+    /** Adds source into destination, with the gain ramped from startGain towards endGain. */
+    using MixFunction = void (*) (float* destination, const float* source, float startGain, float endGain, int numSamples);
+
+    struct Kernels
+    {
+        Isa isa;
+        std::array<WavetableFunction, 3> renderWavetable;   // indexed by Interpolation
+        PhaseOperatorFunction renderPhaseOperator;
+        MixFunction mixInto;
+    };
+
+    /** The kernels for this machine, chosen on the first call, which should not be on the audio thread. */
+    const Kernels& get();
+
+    /** The kernels for one ISA, or nullptr if this build or CPU can't run them. */
+    const Kernels* getKernels (Isa isa) noexcept;
+
+    bool isSupported (Isa isa) noexcept;
+    juce::String getName (Isa isa);
+
+    struct BenchmarkResult
+    {
+        juce::String kernel;
+        Isa isa = Isa::baseline;
+        double nanosecondsPerSample = 0.0;
+        float maxDifference = 0.0f;     // from the baseline's output
+    };
+
+    /** Times every kernel with every ISA this machine supports, in 64-sample blocks as the voices run them. */
+    std::vector<BenchmarkResult> runBenchmark();
+    juce::String describe (const std::vector<BenchmarkResult>& results);
+}
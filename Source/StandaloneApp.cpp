@@ -0,0 +1,209 @@
+/*
+  ==============================================================================
+
+    StandaloneApp.cpp
+
+    JUCE's standalone application, plus headless modes for measuring the
+    engine without a window or audio hardware:
+    --latency-test  MIDI-to-sound latency through a dummy audio device
+    --stress-test   worst-case block times under adversarial MIDI
+    --realtime-check  the stress MIDI with the real-time safety checker aborting
+                    on any violation (needs MYSYNTH_REALTIME_CHECKS=1)
+    --regression-test[=update]  the golden renders in Regression, or rewrites them
+    --kernel-benchmark  every SIMD kernel with every ISA this CPU supports
+    --instantiation-benchmark[=N]  creating N processors side by side, 100 by default
+    --export-samples=dir  a multisampled WAV library of a saved state
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+
+#if JucePlugin_Build_Standalone && JUCE_USE_CUSTOM_PLUGIN_STANDALONE_APP
+
+#include <juce_audio_plugin_client/Standalone/juce_StandaloneFilterWindow.h>
+#include <iostream>
+#include "LatencyTest.h"
+#include "OfflineRenderer.h"
+#include "SimdKernels.h"
+#include "SampleExporter.h"
+#include "PluginProcessor.h"
+
+//==============================================================================
+// Live MIDI reaches the processor through its LiveMidiInput instead of the player's
+// collector, so notes keep their timing within a block. The window can replace the
+// processor at any time (e.g. "Reset to default state"), so the input is held as a
+// shared pointer and a timer picks up the current one
+class LiveMidiRouter  : public juce::MidiInputCallback, private juce::Timer
+{
+public:
+    explicit LiveMidiRouter(juce::StandalonePluginHolder& h)
+        : holder(h)
+    {
+        holder.deviceManager.removeMidiInputDeviceCallback({}, &holder.player);
+        holder.deviceManager.addMidiInputDeviceCallback({}, this);
+
+        timerCallback();
+        startTimer(500);
+    }
+
+    ~LiveMidiRouter() override
+    {
+        holder.deviceManager.removeMidiInputDeviceCallback({}, this);
+    }
+
+    void handleIncomingMidiMessage(juce::MidiInput*, const juce::MidiMessage& message) override
+    {
+        const juce::ScopedLock sl(lock);
+
+        if (input != nullptr)
+            input->addMessage(message);
+    }
+
+private:
+    void timerCallback() override
+    {
+        auto* processor = dynamic_cast<MysynthpracAudioProcessor*>(holder.processor.get());
+        auto newInput = processor != nullptr ? processor->getLiveMidiInput() : nullptr;
+
+        if (newInput == input)
+            return;
+
+        if (processor != nullptr)
+            processor->setLiveMidiInputEnabled(true);
+
+        const juce::ScopedLock sl(lock);
+        input = newInput;
+    }
+
+    juce::StandalonePluginHolder& holder;
+    juce::CriticalSection lock;
+    std::shared_ptr<LiveMidiInput> input;
+};
+
+class MysynthpracStandaloneApp  : public juce::JUCEApplication
+{
+public:
+    MysynthpracStandaloneApp()
+    {
+        juce::PropertiesFile::Options options;
+
+        options.applicationName     = getApplicationName();
+        options.filenameSuffix      = ".settings";
+        options.osxLibrarySubFolder = "Application Support";
+       #if JUCE_LINUX || JUCE_BSD
+        options.folderName          = "~/.config";
+       #else
+        options.folderName          = "";
+       #endif
+
+        appProperties.setStorageParameters(options);
+    }
+
+    const juce::String getApplicationName() override      { return JucePlugin_Name; }
+    const juce::String getApplicationVersion() override   { return JucePlugin_VersionString; }
+    bool moreThanOneInstanceAllowed() override            { return true; }
+    void anotherInstanceStarted(const juce::String&) override {}
+
+    void initialise(const juce::String& commandLine) override
+    {
+        if (commandLine.contains("--latency-test"))
+        {
+            setApplicationReturnValue(LatencyTest::runFromCommandLine(commandLine));
+            quit();
+            return;
+        }
+
+        if (commandLine.contains("--stress-test"))
+        {
+            auto reports = OfflineRenderer::runStressSuite();
+            std::cout << OfflineRenderer::describe(reports) << std::flush;
+
+            setApplicationReturnValue(OfflineRenderer::allPassed(reports) ? 0 : 1);
+            quit();
+            return;
+        }
+
+        if (commandLine.contains("--regression-test"))
+        {
+            setApplicationReturnValue(OfflineRenderer::runRegressionFromCommandLine(commandLine));
+            quit();
+            return;
+        }
+
+        if (commandLine.contains("--realtime-check"))
+        {
+            setApplicationReturnValue(OfflineRenderer::runRealtimeCheck());
+            quit();
+            return;
+        }
+
+        if (commandLine.contains("--kernel-benchmark"))
+        {
+            std::cout << SimdKernels::describe(SimdKernels::runBenchmark()) << std::flush;
+            quit();
+            return;
+        }
+
+        if (commandLine.contains("--instantiation-benchmark"))
+        {
+            auto numInstances = 100;
+
+            for (auto& argument : juce::StringArray::fromTokens(commandLine, true))
+                if (argument.startsWith("--instantiation-benchmark="))
+                    numInstances = juce::jmax(1, argument.fromFirstOccurrenceOf("=", false, false).getIntValue());
+
+            std::cout << OfflineRenderer::describe(OfflineRenderer::measureInstantiation(numInstances)) << std::flush;
+            quit();
+            return;
+        }
+
+        if (commandLine.contains("--export-samples"))
+        {
+            setApplicationReturnValue(SampleExporter::runFromCommandLine(commandLine));
+            quit();
+            return;
+        }
+
+        mainWindow.reset(new juce::StandaloneFilterWindow(getApplicationName(),
+                                                          juce::LookAndFeel::getDefaultLookAndFeel().findColour(juce::ResizableWindow::backgroundColourId),
+                                                          appProperties.getUserSettings(),
+                                                          false));
+        mainWindow->setVisible(true);
+
+        if (auto* holder = mainWindow->getPluginHolder())
+            liveMidiRouter = std::make_unique<LiveMidiRouter>(*holder);
+    }
+
+    void shutdown() override
+    {
+        liveMidiRouter = nullptr;
+        mainWindow = nullptr;
+        appProperties.saveIfNeeded();
+    }
+
+    void systemRequestedQuit() override
+    {
+        if (mainWindow != nullptr)
+            mainWindow->pluginHolder->savePluginState();
+
+        if (juce::ModalComponentManager::getInstance()->cancelAllModalComponents())
+            juce::Timer::callAfterDelay(100, []
+            {
+                if (auto app = juce::JUCEApplicationBase::getInstance())
+                    app->systemRequestedQuit();
+            });
+        else
+            quit();
+    }
+
+private:
+    juce::ApplicationProperties appProperties;
+    std::unique_ptr<juce::StandaloneFilterWindow> mainWindow;
+    std::unique_ptr<LiveMidiRouter> liveMidiRouter;
+};
+
+juce::JUCEApplicationBase* juce_CreateApplication();
+juce::JUCEApplicationBase* juce_CreateApplication()   { return new MysynthpracStandaloneApp(); }
+
+#endif
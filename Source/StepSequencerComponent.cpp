@@ -0,0 +1,87 @@
+/*
+  ==============================================================================
+
+    StepSequencerComponent.cpp
+
+  ==============================================================================
+*/
+
+#include "StepSequencerComponent.h"
+
+StepSequencerComponent::StepSequencerComponent(MysynthpracAudioProcessor& p)
+    : audioProcessor(p), pattern(p.getArpPattern())
+{
+}
+
+void StepSequencerComponent::refresh()
+{
+    auto current = audioProcessor.getArpPattern();
+
+    if (Arpeggiator::patternToString(current) != Arpeggiator::patternToString(pattern))
+    {
+        pattern = current;
+        repaint();
+    }
+}
+
+void StepSequencerComponent::paint(juce::Graphics& g)
+{
+    const auto stepWidth = (float) getWidth() / (float) ArpPattern::maxSteps;
+
+    for (int i = 0; i < pattern.numSteps; ++i)
+    {
+        auto& step = pattern.steps[(size_t) i];
+        auto cell = juce::Rectangle<float>(i * stepWidth, 0.0f, stepWidth, (float) getHeight()).reduced(1.0f);
+
+        g.setColour(juce::Colour::fromRGB(58, 58, 58));
+        g.fillRect(cell);
+
+        if (step.active)
+        {
+            g.setColour(juce::Colours::green);
+            g.fillRect(cell.withTrimmedTop(cell.getHeight() * (1.0f - step.velocity)));
+        }
+    }
+}
+
+int StepSequencerComponent::getStepAt(int x) const
+{
+    return juce::jlimit(0, pattern.numSteps - 1, x * ArpPattern::maxSteps / juce::jmax(1, getWidth()));
+}
+
+float StepSequencerComponent::getVelocityAt(int y) const
+{
+    return juce::jlimit(0.05f, 1.0f, 1.0f - (float) y / (float) juce::jmax(1, getHeight()));
+}
+
+void StepSequencerComponent::mouseDown(const juce::MouseEvent& e)
+{
+    draggingStep = getStepAt(e.x);
+    dragged = false;
+
+    auto& step = pattern.steps[(size_t) draggingStep];
+    step.active = !step.active;
+
+    audioProcessor.setArpPattern(pattern);
+    repaint();
+}
+
+void StepSequencerComponent::mouseDrag(const juce::MouseEvent& e)
+{
+    if (draggingStep < 0 || e.getDistanceFromDragStartY() == 0)
+        return;
+
+    // A drag sets the velocity instead, so undo the toggle from mouseDown
+    auto& step = pattern.steps[(size_t) draggingStep];
+
+    if (!dragged)
+    {
+        step.active = true;
+        dragged = true;
+    }
+
+    step.velocity = getVelocityAt(e.y);
+
+    audioProcessor.setArpPattern(pattern);
+    repaint();
+}
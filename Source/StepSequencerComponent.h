@@ -0,0 +1,42 @@
+/*
+  ==============================================================================
+
+    StepSequencerComponent.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+
+//==============================================================================
+/**
+    A row of arpeggiator steps. Click a step to mute or unmute it, drag up and
+    down to set its velocity. Edits are handed to the processor, which passes
+    them to the audio thread without locking.
+*/
+class StepSequencerComponent  : public juce::Component
+{
+public:
+    explicit StepSequencerComponent(MysynthpracAudioProcessor& p);
+
+    void paint(juce::Graphics& g) override;
+    void mouseDown(const juce::MouseEvent& e) override;
+    void mouseDrag(const juce::MouseEvent& e) override;
+
+    /** Picks up a pattern that changed underneath the editor, e.g. after loading a preset. */
+    void refresh();
+
+private:
+    int getStepAt(int x) const;
+    float getVelocityAt(int y) const;
+
+    MysynthpracAudioProcessor& audioProcessor;
+    ArpPattern pattern;
+    int draggingStep = -1;
+    bool dragged = false;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (StepSequencerComponent)
+};
@@ -0,0 +1,217 @@
+/*
+  ==============================================================================
+
+    StereoLadderFilter.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    A drop-in replacement for juce::dsp::LadderFilter<float> tuned for the
+    post-mix stage.
+
+    - Setters only recompute coefficients when the value actually changes, so
+      they can be called every block.
+    - Cutoff and resonance smoothing runs at a control rate rather than per sample.
+    - Saturation uses a clamped rational tanh approximation.
+    - Both channels run in lockstep with the state stored [stage][channel], so
+      the pair maps onto SIMD lanes.
+*/
+class StereoLadderFilter
+{
+public:
+    using Mode = juce::dsp::LadderFilterMode;
+
+    StereoLadderFilter()
+    {
+        setMode (Mode::LPF12, true);
+        setDrive (1.0f);
+        setResonance (0.0f);
+    }
+
+    void prepare (const juce::dsp::ProcessSpec& spec)
+    {
+        jassert (spec.numChannels <= maxChannels);
+
+        sampleRate = (float) spec.sampleRate;
+        cutoffFreqScaler = -juce::MathConstants<float>::twoPi / sampleRate;
+
+        cutoffTransformSmoother.reset (spec.sampleRate, smootherRampTimeSec);
+        scaledResonanceSmoother.reset (spec.sampleRate, smootherRampTimeSec);
+        cutoffTransformSmoother.setCurrentAndTargetValue (std::exp (cutoffFreqHz * cutoffFreqScaler));
+
+        reset();
+    }
+
+    void reset() noexcept
+    {
+        for (auto& stage : state)
+            stage.fill (0.0f);
+
+        cutoffTransformSmoother.setCurrentAndTargetValue (cutoffTransformSmoother.getTargetValue());
+        scaledResonanceSmoother.setCurrentAndTargetValue (scaledResonanceSmoother.getTargetValue());
+        cutoffTransformValue = cutoffTransformSmoother.getCurrentValue();
+        scaledResonanceValue = scaledResonanceSmoother.getCurrentValue();
+    }
+
+    void setEnabled (bool isEnabled) noexcept       { enabled = isEnabled; }
+
+    void setMode (Mode newMode, bool force = false) noexcept
+    {
+        if (newMode == mode && ! force)
+            return;
+
+        switch (newMode)
+        {
+            case Mode::LPF12:   A = {{ 0.0f, 0.0f,  1.0f,  0.0f, 0.0f }}; comp = 0.5f; break;
+            case Mode::HPF12:   A = {{ 1.0f, -2.0f, 1.0f,  0.0f, 0.0f }}; comp = 0.0f; break;
+            case Mode::BPF12:   A = {{ 0.0f, 0.0f, -1.0f,  1.0f, 0.0f }}; comp = 0.5f; break;
+            case Mode::LPF24:   A = {{ 0.0f, 0.0f,  0.0f,  0.0f, 1.0f }}; comp = 0.5f; break;
+            case Mode::HPF24:   A = {{ 1.0f, -4.0f, 6.0f, -4.0f, 1.0f }}; comp = 0.0f; break;
+            case Mode::BPF24:   A = {{ 0.0f, 0.0f,  1.0f, -2.0f, 1.0f }}; comp = 0.5f; break;
+            default:            jassertfalse; break;
+        }
+
+        for (auto& a : A)
+            a *= outputGain;
+
+        // Every mode shares the same stages and only taps them differently, so the state carries
+        // straight over; clearing it here would click whenever the mode is changed mid-note
+        mode = newMode;
+    }
+
+    void setCutoffFrequencyHz (float newCutoff) noexcept
+    {
+        jassert (newCutoff > 0.0f);
+
+        if (newCutoff == cutoffFreqHz)
+            return;
+
+        cutoffFreqHz = newCutoff;
+        cutoffTransformSmoother.setTargetValue (std::exp (cutoffFreqHz * cutoffFreqScaler));
+    }
+
+    void setResonance (float newResonance) noexcept
+    {
+        jassert (newResonance >= 0.0f && newResonance <= 1.0f);
+
+        if (newResonance == resonance)
+            return;
+
+        resonance = newResonance;
+        scaledResonanceSmoother.setTargetValue (juce::jmap (resonance, 0.1f, 1.0f));
+    }
+
+    void setDrive (float newDrive) noexcept
+    {
+        jassert (newDrive >= 1.0f);
+
+        if (newDrive == drive)
+            return;
+
+        drive = newDrive;
+        gain = std::pow (drive, -2.642f) * 0.6103f + 0.3903f;
+        drive2 = drive * 0.04f + 0.96f;
+        gain2 = std::pow (drive2, -2.642f) * 0.6103f + 0.3903f;
+    }
+
+    void process (const juce::dsp::ProcessContextReplacing<float>& context) noexcept
+    {
+        if (! enabled || context.isBypassed)
+            return;
+
+        auto& block = context.getOutputBlock();
+        auto numSamples = (int) block.getNumSamples();
+
+        if (block.getNumChannels() >= 2)
+        {
+            float* channels[] = { block.getChannelPointer (0), block.getChannelPointer (1) };
+            processSamples<2> (channels, numSamples);
+        }
+        else if (block.getNumChannels() == 1)
+        {
+            float* channels[] = { block.getChannelPointer (0) };
+            processSamples<1> (channels, numSamples);
+        }
+    }
+
+private:
+    static constexpr size_t maxChannels = 2;
+    static constexpr int controlInterval = 16;
+    static constexpr float outputGain = 1.2f;
+    static constexpr double smootherRampTimeSec = 0.05;
+
+    static forcedinline float saturate (float x) noexcept
+    {
+        // The Pade approximation is accurate to within 1e-4 over this range, tanh is flat beyond it
+        return juce::dsp::FastMathApproximations::tanh (juce::jlimit (-5.0f, 5.0f, x));
+    }
+
+    template <int NumChannels>
+    void processSamples (float* const* channels, int numSamples) noexcept
+    {
+        for (int start = 0; start < numSamples; start += controlInterval)
+        {
+            auto end = juce::jmin (start + controlInterval, numSamples);
+
+            if (cutoffTransformSmoother.isSmoothing())
+                cutoffTransformValue = cutoffTransformSmoother.skip (end - start);
+
+            if (scaledResonanceSmoother.isSmoothing())
+                scaledResonanceValue = scaledResonanceSmoother.skip (end - start);
+
+            const auto a1 = cutoffTransformValue;
+            const auto g = 1.0f - a1;
+            const auto b0 = g * 0.76923076923f;
+            const auto b1 = g * 0.23076923076f;
+            const auto k = scaledResonanceValue * -4.0f;
+
+            for (int n = start; n < end; ++n)
+            {
+                for (int ch = 0; ch < NumChannels; ++ch)
+                {
+                    auto& s0 = state[0][(size_t) ch];
+                    auto& s1 = state[1][(size_t) ch];
+                    auto& s2 = state[2][(size_t) ch];
+                    auto& s3 = state[3][(size_t) ch];
+                    auto& s4 = state[4][(size_t) ch];
+
+                    const auto dx = gain * saturate (drive * channels[ch][n]);
+                    const auto a = dx + k * (gain2 * saturate (drive2 * s4) - dx * comp);
+
+                    const auto b = b1 * s0 + a1 * s1 + b0 * a;
+                    const auto c = b1 * s1 + a1 * s2 + b0 * b;
+                    const auto d = b1 * s2 + a1 * s3 + b0 * c;
+                    const auto e = b1 * s3 + a1 * s4 + b0 * d;
+
+                    s0 = a;
+                    s1 = b;
+                    s2 = c;
+                    s3 = d;
+                    s4 = e;
+
+                    channels[ch][n] = a * A[0] + b * A[1] + c * A[2] + d * A[3] + e * A[4];
+                }
+            }
+        }
+    }
+
+    std::array<std::array<float, maxChannels>, 5> state {};
+    std::array<float, 5> A {};
+
+    juce::SmoothedValue<float> cutoffTransformSmoother, scaledResonanceSmoother;
+    float cutoffTransformValue = 0.0f, scaledResonanceValue = 0.0f;
+
+    float sampleRate = 44100.0f;
+    float cutoffFreqScaler = -juce::MathConstants<float>::twoPi / 44100.0f;
+    float cutoffFreqHz = 200.0f, resonance = -1.0f, drive = 0.0f;
+    float gain = 1.0f, drive2 = 1.0f, gain2 = 1.0f, comp = 0.0f;
+
+    Mode mode = Mode::LPF12;
+    bool enabled = true;
+};
@@ -0,0 +1,45 @@
+/*
+  ==============================================================================
+
+    TripleBuffer.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Hands a value from one writer thread to the audio thread without locks or
+    allocation. The writer fills a spare buffer and swaps it in; the reader
+    picks up the newest one at its next read().
+*/
+template <typename ValueType>
+class TripleBuffer
+{
+public:
+    /** Single writer. */
+    void write(const ValueType& newValue) noexcept
+    {
+        buffers[(size_t) writeIndex] = newValue;
+        writeIndex = shared.exchange(writeIndex | dirtyBit, std::memory_order_acq_rel) & indexMask;
+    }
+
+    /** Single reader (the audio thread). */
+    const ValueType& read() noexcept
+    {
+        if ((shared.load(std::memory_order_relaxed) & dirtyBit) != 0)
+            readIndex = shared.exchange(readIndex, std::memory_order_acq_rel) & indexMask;
+
+        return buffers[(size_t) readIndex];
+    }
+
+private:
+    static constexpr int dirtyBit = 4, indexMask = 3;
+
+    std::array<ValueType, 3> buffers {};
+    int writeIndex = 0, readIndex = 1;
+    std::atomic<int> shared { 2 };
+};
@@ -0,0 +1,226 @@
+/*
+  ==============================================================================
+
+    TuningTable.cpp
+
+  ==============================================================================
+*/
+
+#include "TuningTable.h"
+
+namespace
+{
+    /** The file's lines with comments ("!") dropped. Blank lines are kept, as a
+        Scala description may be empty.
+    */
+    juce::StringArray getDataLines(const juce::String& text)
+    {
+        juce::StringArray lines;
+
+        for (auto& line : juce::StringArray::fromLines(text))
+            if (! line.trimStart().startsWithChar('!'))
+                lines.add(line.trim());
+
+        return lines;
+    }
+
+    juce::String firstToken(const juce::String& line)
+    {
+        return line.upToFirstOccurrenceOf(" ", false, false).upToFirstOccurrenceOf("\t", false, false);
+    }
+
+    int floorDivide(int value, int divisor) noexcept
+    {
+        return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+    }
+
+    /** Cents above degree 0 of any degree, counting whole periods for those past the end. */
+    double getDegreeCents(const TuningTable::Scale& scale, int degree) noexcept
+    {
+        const auto size = (int) scale.cents.size();
+        const auto periods = floorDivide(degree, size);
+        const auto step = degree - periods * size;
+
+        return periods * scale.cents.back() + (step == 0 ? 0.0 : scale.cents[(size_t) step - 1]);
+    }
+
+    /** Cents of a note above degree 0, or false if the mapping leaves it out. */
+    bool getNoteCents(const TuningTable::Scale& scale, const TuningTable::KeyboardMapping& mapping, int note, double& cents) noexcept
+    {
+        if (note < mapping.firstNote || note > mapping.lastNote)
+            return false;
+
+        const auto offset = note - mapping.middleNote;
+
+        if (mapping.mapSize == 0)
+        {
+            cents = getDegreeCents(scale, offset);
+            return true;
+        }
+
+        const auto repeats = floorDivide(offset, mapping.mapSize);
+        const auto degree = mapping.degrees[(size_t) (offset - repeats * mapping.mapSize)];
+
+        if (degree < 0)
+            return false;
+
+        const auto octaveDegree = mapping.octaveDegree > 0 ? mapping.octaveDegree : (int) scale.cents.size();
+        cents = repeats * getDegreeCents(scale, octaveDegree) + getDegreeCents(scale, degree);
+        return true;
+    }
+}
+
+//==============================================================================
+TuningTable::TuningTable()
+{
+    setEqualTemperament();
+}
+
+juce::Result TuningTable::parseScale(const juce::String& text, Scale& scale)
+{
+    auto lines = getDataLines(text);
+
+    // The description is the first line that isn't a comment, even if it's blank
+    if (lines.size() < 2)
+        return juce::Result::fail("The scale has no note count");
+
+    scale.description = lines[0];
+    scale.cents.clear();
+
+    auto count = firstToken(lines[1]).getIntValue();
+
+    if (count < 1)
+        return juce::Result::fail("The scale has no notes");
+
+    // Blank lines aren't allowed among the pitches
+    lines.removeEmptyStrings();
+
+    for (int i = 0; i < count; ++i)
+    {
+        auto lineIndex = i + (scale.description.isEmpty() ? 1 : 2);
+
+        if (lineIndex >= lines.size())
+            return juce::Result::fail("The scale lists " + juce::String(i) + " of its " + juce::String(count) + " pitches");
+
+        auto pitch = firstToken(lines[lineIndex]);
+
+        // Anything with a period is in cents, anything else is a ratio or a whole number
+        if (pitch.containsChar('.'))
+        {
+            scale.cents.push_back(pitch.getDoubleValue());
+            continue;
+        }
+
+        auto numerator = pitch.upToFirstOccurrenceOf("/", false, false).getLargeIntValue();
+        auto denominator = pitch.containsChar('/') ? pitch.fromFirstOccurrenceOf("/", false, false).getLargeIntValue() : 1;
+
+        if (numerator <= 0 || denominator <= 0)
+            return juce::Result::fail("Pitch " + juce::String(i + 1) + " isn't a valid ratio: " + pitch);
+
+        scale.cents.push_back(1200.0 * std::log2((double) numerator / (double) denominator));
+    }
+
+    if (scale.cents.back() <= 0.0)
+        return juce::Result::fail("The scale's period must be above 1/1");
+
+    return juce::Result::ok();
+}
+
+juce::Result TuningTable::parseKeyboardMapping(const juce::String& text, KeyboardMapping& mapping)
+{
+    auto lines = getDataLines(text);
+    lines.removeEmptyStrings();
+
+    if (lines.size() < 7)
+        return juce::Result::fail("The keyboard mapping needs at least 7 lines");
+
+    mapping.mapSize = firstToken(lines[0]).getIntValue();
+    mapping.firstNote = juce::jlimit(0, numNotes - 1, firstToken(lines[1]).getIntValue());
+    mapping.lastNote = juce::jlimit(0, numNotes - 1, firstToken(lines[2]).getIntValue());
+    mapping.middleNote = firstToken(lines[3]).getIntValue();
+    mapping.referenceNote = firstToken(lines[4]).getIntValue();
+    mapping.referenceFrequency = firstToken(lines[5]).getDoubleValue();
+    mapping.octaveDegree = firstToken(lines[6]).getIntValue();
+    mapping.degrees.clear();
+
+    if (mapping.mapSize < 0 || mapping.referenceFrequency <= 0.0 || mapping.referenceNote < 0 || mapping.referenceNote >= numNotes)
+        return juce::Result::fail("The keyboard mapping's header isn't valid");
+
+    // A short mapping leaves its last keys unmapped
+    for (int i = 0; i < mapping.mapSize; ++i)
+    {
+        auto entry = 7 + i < lines.size() ? firstToken(lines[7 + i]) : juce::String("x");
+        mapping.degrees.push_back(entry.equalsIgnoreCase("x") ? -1 : juce::jmax(0, entry.getIntValue()));
+    }
+
+    return juce::Result::ok();
+}
+
+TuningTable::Frequencies TuningTable::build(const Scale& scale, const KeyboardMapping& mapping)
+{
+    Frequencies frequencies {};
+    auto referenceCents = 0.0;
+
+    // An unmapped reference key is placed as if the mapping were linear
+    if (! getNoteCents(scale, mapping, mapping.referenceNote, referenceCents))
+        referenceCents = getDegreeCents(scale, mapping.referenceNote - mapping.middleNote);
+
+    for (int note = 0; note < numNotes; ++note)
+    {
+        auto cents = 0.0;
+
+        if (getNoteCents(scale, mapping, note, cents))
+            frequencies[(size_t) note] = (float) (mapping.referenceFrequency * std::exp2((cents - referenceCents) / 1200.0));
+    }
+
+    return frequencies;
+}
+
+TuningTable::Frequencies TuningTable::createEqualTemperament()
+{
+    Frequencies frequencies {};
+
+    for (int note = 0; note < numNotes; ++note)
+        frequencies[(size_t) note] = (float) juce::MidiMessage::getMidiNoteInHertz(note);
+
+    return frequencies;
+}
+
+juce::Result TuningTable::setTuning(const juce::String& scaleText, const juce::String& mappingText)
+{
+    Scale scale;
+    auto result = parseScale(scaleText, scale);
+
+    if (result.failed())
+        return result;
+
+    KeyboardMapping mapping;
+
+    if (mappingText.isNotEmpty())
+    {
+        result = parseKeyboardMapping(mappingText, mapping);
+
+        if (result.failed())
+            return result;
+    }
+
+    auto frequencies = build(scale, mapping);
+
+    const juce::SpinLock::ScopedLockType sl(writerLock);
+    description = scale.description.isNotEmpty() ? scale.description : juce::String("Scala tuning");
+    tables.write(frequencies);
+    return juce::Result::ok();
+}
+
+void TuningTable::setEqualTemperament()
+{
+    const juce::SpinLock::ScopedLockType sl(writerLock);
+    description = "12-TET";
+    tables.write(createEqualTemperament());
+}
+
+juce::String TuningTable::getDescription() const
+{
+    const juce::SpinLock::ScopedLockType sl(writerLock);
+    return description;
+}
@@ -0,0 +1,74 @@
+/*
+  ==============================================================================
+
+    TuningTable.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "TripleBuffer.h"
+
+//==============================================================================
+/**
+    The frequency of every MIDI note, from a Scala scale(.scl) and optional
+    keyboard mapping(.kbm), or 12-TET until one is loaded.
+
+    The 128-entry table is built on the message thread and handed to the audio
+    thread through a TripleBuffer, so a note-on is a lookup rather than a pow()
+    and a new tuning never blocks the audio thread. Keys the mapping leaves out
+    have a frequency of 0 and don't play.
+*/
+class TuningTable
+{
+public:
+    static constexpr int numNotes = 128;
+    using Frequencies = std::array<float, numNotes>;
+
+    struct Scale
+    {
+        juce::String description;
+
+        // Degrees 1 to N in cents; the last one is the period the scale repeats at
+        std::vector<double> cents;
+    };
+
+    struct KeyboardMapping
+    {
+        int mapSize = 0;            // 0 maps the scale's degrees straight onto consecutive keys
+        int firstNote = 0, lastNote = numNotes - 1;
+        int middleNote = 60;        // where degree 0 of the mapping goes
+        int referenceNote = 69;
+        double referenceFrequency = 440.0;
+        int octaveDegree = 0;       // the degree each repeat of the mapping moves by; 0 means the scale's period
+        std::vector<int> degrees;   // -1 for unmapped keys
+    };
+
+    TuningTable();
+
+    static juce::Result parseScale(const juce::String& text, Scale& scale);
+    static juce::Result parseKeyboardMapping(const juce::String& text, KeyboardMapping& mapping);
+
+    static Frequencies build(const Scale& scale, const KeyboardMapping& mapping);
+    static Frequencies createEqualTemperament();
+
+    /** Call from the message thread. An empty mapping uses the default: middle C on
+        degree 0, and A4 at 440 Hz. On failure the current tuning is kept.
+    */
+    juce::Result setTuning(const juce::String& scaleText, const juce::String& mappingText = {});
+    void setEqualTemperament();
+
+    /** The description line of the loaded scale, or "12-TET". */
+    juce::String getDescription() const;
+
+    /** The audio thread's copy, which stays valid until its next call. Single reader. */
+    const Frequencies& getFrequencies() noexcept    { return tables.read(); }
+
+private:
+    TripleBuffer<Frequencies> tables;
+
+    juce::SpinLock writerLock;
+    juce::String description;
+};